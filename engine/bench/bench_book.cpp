@@ -0,0 +1,85 @@
+// Order book top-of-book paths.
+//
+// A deep two-sided book is built, then: reading the best prices (as mark
+// pricing, risk and the publishers do), taking out the best level so the
+// next one becomes best, resting and cancelling away from the touch, and
+// sweeping ten levels with and without aggregated aggressor fills.
+
+#include "bench_common.h"
+#include "mmg/order_book.h"
+#include <cstdlib>
+
+using namespace mmg;
+
+int main(int argc, char** argv) {
+    int levels = argc > 1 ? std::atoi(argv[1]) : 500;
+
+    OrderBook book(1);
+    OrderId next_id = 1;
+    auto make = [&](Side side, Price price, Quantity qty, TimeInForce tif = TimeInForce::GFD) {
+        auto order = std::make_shared<Order>();
+        order->id = next_id++;
+        order->user_id = 1;
+        order->instrument_id = 1;
+        order->side = side;
+        order->price = price;
+        order->quantity = qty;
+        order->tif = tif;
+        return order;
+    };
+    for (int i = 0; i < levels; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            book.add_order(make(Side::BUY, 10000 - i, 5));
+            book.add_order(make(Side::SELL, 10001 + i, 5));
+        }
+    }
+    std::printf("levels=%d per side\n", levels);
+
+    bench::print_header();
+
+    // 1000 reads per sample; the clock would swamp a single one
+    volatile Price sink = 0;
+    bench::print(bench::run("book/best_bid_ask_x1000", 20000, [&] {
+        Price sum = 0;
+        for (int i = 0; i < 1000; ++i) sum += book.get_best_bid() + book.get_best_ask();
+        sink = sum;
+    }));
+    bench::print(bench::run("book/top_of_book_x1000", 20000, [&] {
+        Price sum = 0;
+        for (int i = 0; i < 1000; ++i) {
+            TopOfBook tob = book.get_top_of_book();
+            sum += tob.bid + tob.ask + tob.bid_size;
+        }
+        sink = sum;
+    }));
+
+    // Empty the best ask level with one IOC, then restore it
+    bench::print(bench::run("book/take_level_and_restore", 100000, [&] {
+        book.add_order(make(Side::BUY, 10001, 20, TimeInForce::IOC));
+        for (int k = 0; k < 4; ++k) book.add_order(make(Side::SELL, 10001, 5));
+    }));
+
+    // Rest and cancel away from the touch
+    bench::print(bench::run("book/add_cancel_deep", 100000, [&] {
+        auto order = make(Side::BUY, 10000 - levels / 2, 3);
+        book.add_order(order);
+        book.cancel_order(order->id);
+    }));
+
+    // Sweep ten levels of four orders with one IOC, then restore them
+    for (bool aggregate : {false, true}) {
+        book.set_aggregate_fills(aggregate);
+        size_t fills = 0;
+        auto r = bench::run(aggregate ? "book/sweep_10_levels_aggregated" : "book/sweep_10_levels",
+                            20000, [&] {
+            fills = book.add_order(make(Side::BUY, 10010, 200, TimeInForce::IOC)).size();
+            for (int i = 0; i < 10; ++i) {
+                for (int k = 0; k < 4; ++k) book.add_order(make(Side::SELL, 10001 + i, 5));
+            }
+        });
+        bench::print(r);
+        std::printf("  %zu fills per sweep\n", fills);
+    }
+    (void)sink;
+    return 0;
+}
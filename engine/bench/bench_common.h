@@ -0,0 +1,197 @@
+#pragma once
+
+// Minimal timing harness for the engine micro-benchmarks
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace mmg {
+namespace bench {
+
+enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES, NUM_COUNTERS };
+
+inline const char* counter_name(int c) {
+    static const char* names[NUM_COUNTERS] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"};
+    return names[c];
+}
+
+// Counts per operation; events the CPU or kernel refused stay invalid
+struct Counters {
+    bool valid[NUM_COUNTERS] = {};
+    double per_op[NUM_COUNTERS] = {};
+};
+
+// Hardware counters around each measured loop, enabled by MMG_BENCH_PERF=1.
+// Events are opened one by one rather than as a group so that those the PMU
+// cannot fit are multiplexed (and scaled) instead of never being scheduled.
+// Without perf_event_open access every event is invalid and only timings
+// are reported.
+class PerfCounters {
+public:
+    static PerfCounters& instance() {
+        static PerfCounters counters;
+        return counters;
+    }
+
+    bool enabled() const { return enabled_; }
+
+#ifdef __linux__
+    void start() {
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    Counters stop(size_t ops) {
+        Counters counters;
+        for (int fd : fds_) {
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int c = 0; c < NUM_COUNTERS; ++c) {
+            uint64_t values[3];  // value, time enabled, time running
+            if (fds_[c] < 0 || read(fds_[c], values, sizeof(values)) != sizeof(values)) continue;
+            if (values[2] == 0 || ops == 0) continue;
+            counters.valid[c] = true;
+            counters.per_op[c] = double(values[0]) * values[1] / values[2] / ops;
+        }
+        return counters;
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+    }
+#else
+    void start() {}
+    Counters stop(size_t) { return Counters(); }
+#endif
+
+private:
+    PerfCounters() {
+        const char* env = std::getenv("MMG_BENCH_PERF");
+        if (!env || std::strcmp(env, "0") == 0) return;
+
+#ifdef __linux__
+        auto cache = [](uint64_t cache_id) {
+            return cache_id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        const uint32_t types[NUM_COUNTERS] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+        const uint64_t configs[NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, cache(PERF_COUNT_HW_CACHE_L1D),
+            cache(PERF_COUNT_HW_CACHE_LL), PERF_COUNT_HW_BRANCH_MISSES, cache(PERF_COUNT_HW_CACHE_DTLB)};
+
+        int error = 0;
+        for (int c = 0; c < NUM_COUNTERS; ++c) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[c];
+            attr.config = configs[c];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;  // Allowed at perf_event_paranoid 2
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[c] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[c] < 0) {
+                error = errno;
+            } else {
+                enabled_ = true;
+            }
+        }
+        if (!enabled_) {
+            std::fprintf(stderr, "perf counters unavailable (%s); reporting timings only\n", std::strerror(error));
+        }
+#else
+        std::fprintf(stderr, "perf counters need Linux; reporting timings only\n");
+#endif
+    }
+
+#ifdef __linux__
+    int fds_[NUM_COUNTERS] = {-1, -1, -1, -1, -1, -1};
+#endif
+    bool enabled_ = false;
+};
+
+struct Result {
+    const char* name;
+    size_t samples;
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+    Counters counters;  // Per sample, including the clock reads
+};
+
+// Times `op` once per sample after a warmup; `op` is one unit of work
+template <typename Op>
+Result run(const char* name, size_t samples, Op&& op, size_t warmup = 100) {
+    for (size_t i = 0; i < warmup; ++i) op();
+
+    std::vector<double> times;
+    times.reserve(samples);
+    PerfCounters& perf = PerfCounters::instance();
+    if (perf.enabled()) perf.start();
+    for (size_t i = 0; i < samples; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        op();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    Counters counters;
+    if (perf.enabled()) counters = perf.stop(samples);
+
+    double total = 0.0;
+    for (double t : times) total += t;
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.name = name;
+    result.samples = samples;
+    result.mean_ns = total / samples;
+    result.p50_ns = times[samples / 2];
+    result.p99_ns = times[std::min(samples - 1, samples * 99 / 100)];
+    result.counters = counters;
+    return result;
+}
+
+inline void print_header() {
+    std::printf("%-40s %10s %12s %12s %12s\n", "benchmark", "samples", "mean ns", "p50 ns", "p99 ns");
+}
+
+inline void print(const Result& r) {
+    std::printf("%-40s %10zu %12.0f %12.0f %12.0f\n", r.name, r.samples, r.mean_ns, r.p50_ns, r.p99_ns);
+
+    // Counters go on their own line as name=value per operation
+    const Counters& c = r.counters;
+    bool any = false;
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+        if (!c.valid[i]) continue;
+        std::printf(any ? " %s=%.1f" : "  %s=%.1f", counter_name(i), c.per_op[i]);
+        any = true;
+    }
+    if (c.valid[CYCLES] && c.valid[INSTRUCTIONS] && c.per_op[CYCLES] > 0) {
+        std::printf(" ipc=%.2f", c.per_op[INSTRUCTIONS] / c.per_op[CYCLES]);
+    }
+    if (any) std::printf("\n");
+}
+
+}  // namespace bench
+}  // namespace mmg
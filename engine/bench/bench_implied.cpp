@@ -0,0 +1,128 @@
+// Chain-wide requote storms against a book of call spreads and butterflies.
+//
+// Every sample requotes all strikes of an option chain (cancel and replace
+// both sides), which dirties every combo. Compares the engine's incremental
+// path with recomputing every combo's implied quote from scratch.
+
+#include "bench_common.h"
+#include "mmg/engine.h"
+#include <cstdlib>
+
+using namespace mmg;
+
+namespace {
+
+constexpr InstrumentId kUnderlying = 1;
+constexpr InstrumentId kFirstStrike = 100;
+constexpr InstrumentId kFirstCombo = 1000;
+
+struct Chain {
+    Engine engine;
+    std::vector<InstrumentId> strikes;
+    std::vector<std::vector<ComboLeg>> combos;
+    std::vector<OrderId> quotes;
+    Price shift = 0;
+};
+
+void build_chain(Chain& chain, int num_strikes) {
+    InstrumentSpec underlying;
+    underlying.id = kUnderlying;
+    underlying.symbol = "UND";
+    chain.engine.add_instrument(underlying);
+
+    for (int i = 0; i < num_strikes; ++i) {
+        InstrumentSpec call;
+        call.id = kFirstStrike + i;
+        call.symbol = "C" + std::to_string(i);
+        call.type = InstrumentType::CALL;
+        call.reference_id = kUnderlying;
+        call.strike = 5000 + i * 100;
+        chain.engine.add_instrument(call);
+        chain.strikes.push_back(call.id);
+    }
+
+    // Adjacent call spreads and butterflies
+    InstrumentId next = kFirstCombo;
+    for (int i = 0; i + 1 < num_strikes; ++i) {
+        chain.combos.push_back({ComboLeg(kFirstStrike + i, 1), ComboLeg(kFirstStrike + i + 1, -1)});
+    }
+    for (int i = 0; i + 2 < num_strikes; ++i) {
+        chain.combos.push_back({ComboLeg(kFirstStrike + i, 1), ComboLeg(kFirstStrike + i + 1, -2),
+                                ComboLeg(kFirstStrike + i + 2, 1)});
+    }
+    for (const auto& legs : chain.combos) {
+        InstrumentSpec combo;
+        combo.id = next++;
+        combo.symbol = "X" + std::to_string(combo.id);
+        combo.type = InstrumentType::COMBO;
+        combo.legs = legs;
+        chain.engine.add_instrument(combo);
+    }
+}
+
+// One requote of every strike, kept uncrossed so nothing trades
+void requote(Chain& chain) {
+    for (OrderId id : chain.quotes) {
+        chain.engine.cancel_order(id, 1);
+    }
+    chain.quotes.clear();
+
+    chain.shift = (chain.shift + 1) % 10;
+    for (size_t i = 0; i < chain.strikes.size(); ++i) {
+        Price fair = 5000 - static_cast<Price>(i) * 80 + chain.shift;
+        OrderRequest req;
+        req.user_id = 1;
+        req.instrument_id = chain.strikes[i];
+        req.quantity = 10;
+        req.side = Side::BUY;
+        req.price = fair - 20;
+        chain.quotes.push_back(chain.engine.submit_order(req).order_id);
+        req.side = Side::SELL;
+        req.price = fair + 20;
+        chain.quotes.push_back(chain.engine.submit_order(req).order_id);
+    }
+}
+
+// Baseline without dirty tracking: every combo recomputed after every book change
+void full_recompute(Chain& chain) {
+    auto tob = [&chain](InstrumentId id) {
+        auto snapshot = chain.engine.get_snapshot(id);
+        TopOfBook t;
+        if (!snapshot.bids.empty()) {
+            t.bid = snapshot.bids[0].price;
+            t.bid_size = snapshot.bids[0].size;
+        }
+        if (!snapshot.asks.empty()) {
+            t.ask = snapshot.asks[0].price;
+            t.ask_size = snapshot.asks[0].size;
+        }
+        return t;
+    };
+    volatile Price sink = 0;
+    for (size_t change = 0; change < chain.strikes.size() * 4; ++change) {
+        for (const auto& legs : chain.combos) {
+            sink = sink + ImpliedEngine::implied_in(legs, tob).bid;
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int num_strikes = argc > 1 ? std::atoi(argv[1]) : 40;
+    size_t samples = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+
+    Chain chain;
+    build_chain(chain, num_strikes);
+    std::printf("strikes=%d combos=%zu\n", num_strikes, chain.combos.size());
+
+    bench::print_header();
+    bench::print(bench::run("requote_storm/incremental_implied", samples, [&] { requote(chain); }));
+    bench::print(bench::run("requote_storm/full_recompute_only", samples / 10,
+                            [&] { full_recompute(chain); }, 10));
+
+    auto quote = chain.engine.get_implied_quote(kFirstCombo);
+    std::printf("spread implied %lld/%lld\n", static_cast<long long>(quote.bid),
+                static_cast<long long>(quote.ask));
+    return 0;
+}
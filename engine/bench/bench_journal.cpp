@@ -0,0 +1,63 @@
+// Book reconstruction from the journal.
+//
+// A long session is played into an engine, then books are rebuilt at targets
+// early, midway and at the end. Each rebuild loads the nearest checkpoint
+// and replays the gap, so latency should not grow with the target's seq.
+
+#include "bench_common.h"
+#include "mmg/engine.h"
+#include <cstdlib>
+#include <random>
+
+using namespace mmg;
+
+int main(int argc, char** argv) {
+    int num_instruments = argc > 1 ? std::atoi(argv[1]) : 10;
+    size_t num_orders = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+    Engine engine;
+    for (int i = 1; i <= num_instruments; ++i) {
+        InstrumentSpec spec;
+        spec.id = i;
+        spec.symbol = "J" + std::to_string(i);
+        engine.add_instrument(spec);
+    }
+
+    // Random resting flow with occasional crosses and cancels
+    std::mt19937_64 rng(42);
+    OrderRequest req;
+    req.tif = TimeInForce::GFD;
+    std::vector<std::pair<OrderId, UserId>> resting;
+    for (size_t i = 0; i < num_orders; ++i) {
+        req.user_id = 1 + rng() % 20;
+        req.instrument_id = 1 + rng() % num_instruments;
+        req.side = rng() % 2 ? Side::BUY : Side::SELL;
+        req.price = req.side == Side::BUY ? 9900 + rng() % 110 : 9990 + rng() % 110;
+        req.quantity = 1 + rng() % 10;
+        auto result = engine.submit_order(req);
+        if (result.success) resting.emplace_back(result.order_id, req.user_id);
+        if (resting.size() > 5000) {
+            size_t pick = rng() % resting.size();
+            engine.cancel_order(resting[pick].first, resting[pick].second);
+            resting[pick] = resting.back();
+            resting.pop_back();
+        }
+    }
+
+    uint64_t last = engine.last_seq();
+    std::printf("instruments=%d orders=%zu events=%llu\n", num_instruments, num_orders,
+                static_cast<unsigned long long>(last));
+
+    bench::print_header();
+    for (uint64_t target : {last / 100, last / 2, last}) {
+        std::string name = "journal/reconstruct_at_seq_" + std::to_string(target);
+        bench::print(bench::run(name.c_str(), 200, [&] { engine.reconstruct_at_seq(target); }, 10));
+    }
+    bench::print(bench::run("journal/reconstruct_at_now", 200, [&] {
+        engine.reconstruct_at(std::chrono::system_clock::now());
+    }, 10));
+
+    auto stats = engine.get_memory_stats();
+    std::printf("history used %.1f MB\n", stats.history.used / 1e6);
+    return 0;
+}
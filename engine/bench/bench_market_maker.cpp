@@ -0,0 +1,70 @@
+// Built-in market maker requote latency.
+//
+// Each sample is one taker order that trades with the bot, so it includes
+// matching plus the bot's in-engine requote (cancel and replace both sides
+// through mass_quote). A fair-value step with a requote of every bot is
+// timed separately.
+
+#include "bench_common.h"
+#include "mmg/engine.h"
+#include <cstdlib>
+
+using namespace mmg;
+
+namespace {
+
+constexpr UserId kHouse = 1000;
+constexpr UserId kTaker = 1;
+
+void add_bot(Engine& engine, InstrumentId id) {
+    InstrumentSpec spec;
+    spec.id = id;
+    spec.symbol = "MM" + std::to_string(id);
+    engine.add_instrument(spec);
+
+    MarketMakerConfig config;
+    config.instrument_id = id;
+    config.user_id = kHouse;
+    config.fair_value = 10000;
+    config.half_spread = 10;
+    config.size = 5;
+    config.max_inventory = 50;
+    config.skew = 0.5;
+    config.fair_step_ticks = 2;
+    config.seed = id;
+    engine.enable_market_maker(config);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int num_bots = argc > 1 ? std::atoi(argv[1]) : 20;
+    size_t samples = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+
+    Engine engine;
+    for (int i = 1; i <= num_bots; ++i) add_bot(engine, i);
+    std::printf("bots=%d\n", num_bots);
+
+    // Alternate sides so the bot's inventory oscillates instead of pinning at the limit
+    OrderRequest req;
+    req.user_id = kTaker;
+    req.instrument_id = 1;
+    req.quantity = 1;
+    req.tif = TimeInForce::IOC;
+    bool buy = true;
+    auto hit = [&] {
+        auto tob = engine.get_snapshot(1, 1);
+        req.side = buy ? Side::BUY : Side::SELL;
+        req.price = buy ? tob.asks[0].price : tob.bids[0].price;
+        engine.submit_order(req);
+        buy = !buy;
+    };
+
+    bench::print_header();
+    bench::print(bench::run("market_maker/hit_and_requote", samples, hit));
+    bench::print(bench::run("market_maker/step_all_bots", samples / 10,
+                            [&] { engine.step_market_makers(); }));
+
+    std::printf("fair %lld\n", static_cast<long long>(engine.get_market_maker(1)->fair_value()));
+    return 0;
+}
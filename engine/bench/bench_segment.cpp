@@ -0,0 +1,104 @@
+// Segment codec: encode/decode speed and compression ratio.
+//
+// A synthetic session is played into an engine, then its fill history and
+// book journal are encoded with and without LZ. Sizes are compared with the
+// in-memory structs and with the CSV the gateway exports.
+
+#include "bench_common.h"
+#include "mmg/engine.h"
+#include "mmg/segment.h"
+#include <cstdlib>
+#include <random>
+
+using namespace mmg;
+
+namespace {
+
+size_t csv_bytes(const std::vector<Fill>& fills) {
+    size_t total = 0;
+    char line[160];
+    for (const auto& fill : fills) {
+        total += std::snprintf(line, sizeof(line), "%lld,%llu,%u,%u,%s,%lld,%lld\n",
+                               static_cast<long long>(fill.timestamp_ns),
+                               static_cast<unsigned long long>(fill.order_id), fill.user_id,
+                               fill.instrument_id, fill.side == Side::BUY ? "BUY" : "SELL",
+                               static_cast<long long>(fill.price),
+                               static_cast<long long>(fill.quantity));
+    }
+    return total;
+}
+
+template <typename Rows, typename Encode, typename Decode>
+void report(const char* name, const Rows& rows, size_t raw_bytes, Encode encode, Decode decode) {
+    std::string label(name);
+    for (auto compression : {segment::Compression::NONE, segment::Compression::LZ}) {
+        const char* suffix = compression == segment::Compression::LZ ? "_lz" : "_columns";
+        auto bytes = encode(rows, compression);
+        std::string enc_name = label + "/encode" + suffix;
+        std::string dec_name = label + "/decode" + suffix;
+        auto enc = bench::run(enc_name.c_str(), 10, [&] { encode(rows, compression); }, 2);
+        auto dec = bench::run(dec_name.c_str(), 10, [&] { decode(bytes); }, 2);
+        bench::print(enc);
+        bench::print(dec);
+        std::printf("  %zu rows, %zu -> %zu bytes (%.1fx), %.2f B/row, encode %.0f MB/s\n",
+                    rows.size(), raw_bytes, bytes.size(),
+                    static_cast<double>(raw_bytes) / bytes.size(),
+                    static_cast<double>(bytes.size()) / rows.size(),
+                    raw_bytes / (enc.mean_ns / 1e3));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int num_instruments = argc > 1 ? std::atoi(argv[1]) : 10;
+    size_t num_orders = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500000;
+
+    Engine engine;
+    for (int i = 1; i <= num_instruments; ++i) {
+        InstrumentSpec spec;
+        spec.id = i;
+        spec.symbol = "S" + std::to_string(i);
+        engine.add_instrument(spec);
+    }
+
+    // 20 traders around a drifting mid
+    std::mt19937_64 rng(42);
+    OrderRequest req;
+    req.tif = TimeInForce::GFD;
+    for (size_t i = 0; i < num_orders; ++i) {
+        req.user_id = 1 + rng() % 20;
+        req.instrument_id = 1 + rng() % num_instruments;
+        req.side = rng() % 2 ? Side::BUY : Side::SELL;
+        Price mid = 10000 + static_cast<Price>(i / 5000) % 200;
+        req.price = mid + (req.side == Side::BUY ? -1 : 1) * static_cast<Price>(rng() % 40) +
+                    (rng() % 8 == 0 ? (req.side == Side::BUY ? 30 : -30) : 0);
+        req.quantity = 1 + rng() % 10;
+        engine.submit_order(req);
+    }
+
+    const auto& fills = engine.get_fill_history();
+    const auto& records = engine.get_journal().records();
+    std::printf("instruments=%d orders=%zu fills=%zu journal=%zu\n", num_instruments, num_orders,
+                fills.size(), records.size());
+    std::printf("fills as CSV: %zu bytes\n", csv_bytes(fills));
+
+    bench::print_header();
+    report("segment/fills", fills, fills.size() * sizeof(Fill),
+           [](const std::vector<Fill>& rows, segment::Compression c) {
+               return segment::encode_fills(rows, c);
+           },
+           [](const std::vector<uint8_t>& bytes) {
+               std::vector<Fill> out;
+               segment::decode_fills(bytes.data(), bytes.size(), out);
+           });
+    report("segment/journal", records, records.size() * sizeof(JournalRecord),
+           [](const std::vector<JournalRecord>& rows, segment::Compression c) {
+               return segment::encode_journal(rows, c);
+           },
+           [](const std::vector<uint8_t>& bytes) {
+               std::vector<JournalRecord> out;
+               segment::decode_journal(bytes.data(), bytes.size(), out);
+           });
+    return 0;
+}
@@ -3,6 +3,10 @@
 #include <pybind11/chrono.h>
 #include "mmg/engine.h"
 #include "mmg/order_book.h"
+#include "mmg/segment.h"
+#ifndef _WIN32
+#include "mmg/replication.h"
+#endif
 
 namespace py = pybind11;
 using namespace mmg;
@@ -25,6 +29,7 @@ PYBIND11_MODULE(mmg_engine, m) {
         .value("SCALAR", InstrumentType::SCALAR)
         .value("CALL", InstrumentType::CALL)
         .value("PUT", InstrumentType::PUT)
+        .value("COMBO", InstrumentType::COMBO)
         .export_values();
     
     py::enum_<OrderStatus>(m, "OrderStatus")
@@ -35,7 +40,54 @@ PYBIND11_MODULE(mmg_engine, m) {
         .value("REJECTED", OrderStatus::REJECTED)
         .export_values();
     
+    py::enum_<MarkMethod>(m, "MarkMethod")
+        .value("LAST_OR_MID", MarkMethod::LAST_OR_MID)
+        .value("LAST", MarkMethod::LAST)
+        .value("MID", MarkMethod::MID)
+        .value("MICROPRICE", MarkMethod::MICROPRICE)
+        .value("EMA_MID", MarkMethod::EMA_MID)
+        .value("OPTION_MODEL", MarkMethod::OPTION_MODEL)
+        .export_values();
+    
+    py::enum_<TickPolicy>(m, "TickPolicy")
+        .value("CANCEL", TickPolicy::CANCEL)
+        .value("REPRICE", TickPolicy::REPRICE)
+        .export_values();
+    
+    py::enum_<EngineEventType>(m, "EngineEventType")
+        .value("BOOK_RESET", EngineEventType::BOOK_RESET)
+        .value("ORDERS_CANCELLED", EngineEventType::ORDERS_CANCELLED)
+        .value("ORDER_ACCEPTED", EngineEventType::ORDER_ACCEPTED)
+        .value("ORDER_CANCELLED", EngineEventType::ORDER_CANCELLED)
+        .value("FILL", EngineEventType::FILL)
+        .value("INSTRUMENT_HALTED", EngineEventType::INSTRUMENT_HALTED)
+        .value("INSTRUMENT_SETTLED", EngineEventType::INSTRUMENT_SETTLED)
+        .value("LEVEL_UPDATE", EngineEventType::LEVEL_UPDATE)
+        .export_values();
+    
+    py::enum_<L3EventType>(m, "L3EventType")
+        .value("ADD", L3EventType::ADD)
+        .value("MODIFY", L3EventType::MODIFY)
+        .value("EXECUTE", L3EventType::EXECUTE)
+        .value("DELETE", L3EventType::DELETE)
+        .export_values();
+    
+    py::enum_<AdminActionType>(m, "AdminActionType")
+        .value("HALT", AdminActionType::HALT)
+        .value("RESUME", AdminActionType::RESUME)
+        .value("SET_TICK", AdminActionType::SET_TICK)
+        .value("PULL_QUOTES", AdminActionType::PULL_QUOTES)
+        .value("SETTLE", AdminActionType::SETTLE)
+        .value("SETTLE_CHAIN", AdminActionType::SETTLE_CHAIN)
+        .export_values();
+    
     // Structs
+    py::class_<ComboLeg>(m, "ComboLeg")
+        .def(py::init<>())
+        .def(py::init<InstrumentId, int32_t>(), py::arg("instrument_id"), py::arg("ratio"))
+        .def_readwrite("instrument_id", &ComboLeg::instrument_id)
+        .def_readwrite("ratio", &ComboLeg::ratio);
+    
     py::class_<InstrumentSpec>(m, "InstrumentSpec")
         .def(py::init<>())
         .def_readwrite("id", &InstrumentSpec::id)
@@ -46,7 +98,11 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def_readwrite("tick_size", &InstrumentSpec::tick_size)
         .def_readwrite("lot_size", &InstrumentSpec::lot_size)
         .def_readwrite("tick_value", &InstrumentSpec::tick_value)
-        .def_readwrite("is_halted", &InstrumentSpec::is_halted);
+        .def_readwrite("is_halted", &InstrumentSpec::is_halted)
+        .def_readwrite("price_decimals", &InstrumentSpec::price_decimals)
+        .def_readonly("price_scale", &InstrumentSpec::price_scale)
+        .def_readwrite("legs", &InstrumentSpec::legs)
+        .def("to_decimal", &InstrumentSpec::to_decimal, py::arg("price"));
     
     py::class_<OrderRequest>(m, "OrderRequest")
         .def(py::init<>())
@@ -60,13 +116,19 @@ PYBIND11_MODULE(mmg_engine, m) {
     
     py::class_<Fill>(m, "Fill")
         .def(py::init<>())
+        .def_readonly("seq", &Fill::seq)
+        .def_readonly("timestamp_ns", &Fill::timestamp_ns)
         .def_readonly("order_id", &Fill::order_id)
         .def_readonly("user_id", &Fill::user_id)
         .def_readonly("instrument_id", &Fill::instrument_id)
         .def_readonly("side", &Fill::side)
+        .def_readonly("aggressor", &Fill::aggressor)
         .def_readonly("price", &Fill::price)
-        .def_readonly("quantity", &Fill::quantity)
-        .def_readonly("timestamp", &Fill::timestamp);
+        .def_readonly("quantity", &Fill::quantity);
+    
+    // struct formats of the raw records from get_*_history_bytes
+    m.attr("FILL_RECORD_FORMAT") = "=QqQqqIIB?6x";
+    m.attr("TRADE_RECORD_FORMAT") = "=QqQQqqIIIB3x";
     
     py::class_<Order, std::shared_ptr<Order>>(m, "Order")
         .def(py::init<>())
@@ -101,7 +163,8 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def_readonly("bids", &MarketSnapshot::bids)
         .def_readonly("asks", &MarketSnapshot::asks)
         .def_readonly("last_price", &MarketSnapshot::last_price)
-        .def_readonly("timestamp", &MarketSnapshot::timestamp);
+        .def_readonly("timestamp", &MarketSnapshot::timestamp)
+        .def_readonly("seq", &MarketSnapshot::seq);
     
     py::class_<RiskLimits>(m, "RiskLimits")
         .def(py::init<>())
@@ -109,22 +172,192 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def_readwrite("max_notional", &RiskLimits::max_notional)
         .def_readwrite("max_orders_per_sec", &RiskLimits::max_orders_per_sec);
     
+    py::class_<ImpliedQuote>(m, "ImpliedQuote")
+        .def(py::init<>())
+        .def_readonly("bid", &ImpliedQuote::bid)
+        .def_readonly("bid_size", &ImpliedQuote::bid_size)
+        .def_readonly("ask", &ImpliedQuote::ask)
+        .def_readonly("ask_size", &ImpliedQuote::ask_size);
+    
+    py::class_<MarkConfig>(m, "MarkConfig")
+        .def(py::init<>())
+        .def_readwrite("method", &MarkConfig::method)
+        .def_readwrite("ema_alpha", &MarkConfig::ema_alpha);
+    
+    py::class_<RiskParams>(m, "RiskParams")
+        .def(py::init<>())
+        .def_readwrite("volatility", &RiskParams::volatility)
+        .def_readwrite("time_to_expiry", &RiskParams::time_to_expiry)
+        .def_readwrite("rate", &RiskParams::rate)
+        .def_readwrite("scenario_moves", &RiskParams::scenario_moves);
+    
+    py::class_<UnderlyingRisk>(m, "UnderlyingRisk")
+        .def(py::init<>())
+        .def_readonly("underlying_id", &UnderlyingRisk::underlying_id)
+        .def_readonly("spot", &UnderlyingRisk::spot)
+        .def_readonly("delta", &UnderlyingRisk::delta)
+        .def_readonly("gamma", &UnderlyingRisk::gamma)
+        .def_readonly("vega", &UnderlyingRisk::vega)
+        .def_readonly("theta", &UnderlyingRisk::theta)
+        .def_readonly("scenario_spots", &UnderlyingRisk::scenario_spots)
+        .def_readonly("scenario_pnl", &UnderlyingRisk::scenario_pnl);
+    
+    py::class_<RiskReport>(m, "RiskReport")
+        .def(py::init<>())
+        .def_readonly("user_id", &RiskReport::user_id)
+        .def_readonly("underlyings", &RiskReport::underlyings);
+    
     py::class_<Engine::OrderResult>(m, "OrderResult")
         .def(py::init<>())
         .def_readonly("order_id", &Engine::OrderResult::order_id)
         .def_readonly("success", &Engine::OrderResult::success)
         .def_readonly("error_message", &Engine::OrderResult::error_message)
-        .def_readonly("fills", &Engine::OrderResult::fills);
+        .def_readonly("fills", &Engine::OrderResult::fills)
+        .def_readonly("seq", &Engine::OrderResult::seq);
+    
+    py::class_<Engine::PackageResult>(m, "PackageResult")
+        .def(py::init<>())
+        .def_readonly("success", &Engine::PackageResult::success)
+        .def_readonly("error_message", &Engine::PackageResult::error_message)
+        .def_readonly("order_ids", &Engine::PackageResult::order_ids)
+        .def_readonly("seqs", &Engine::PackageResult::seqs)
+        .def_readonly("fills", &Engine::PackageResult::fills);
+    
+    py::class_<Quote>(m, "Quote")
+        .def(py::init<>())
+        .def_readwrite("instrument_id", &Quote::instrument_id)
+        .def_readwrite("bid_price", &Quote::bid_price)
+        .def_readwrite("bid_size", &Quote::bid_size)
+        .def_readwrite("ask_price", &Quote::ask_price)
+        .def_readwrite("ask_size", &Quote::ask_size);
+    
+    py::class_<Engine::MassQuoteResult>(m, "MassQuoteResult")
+        .def(py::init<>())
+        .def_readonly("success", &Engine::MassQuoteResult::success)
+        .def_readonly("error_message", &Engine::MassQuoteResult::error_message)
+        .def_readonly("order_ids", &Engine::MassQuoteResult::order_ids)
+        .def_readonly("fills", &Engine::MassQuoteResult::fills);
+    
+    py::class_<MarketMakerConfig>(m, "MarketMakerConfig")
+        .def(py::init<>())
+        .def_readwrite("instrument_id", &MarketMakerConfig::instrument_id)
+        .def_readwrite("user_id", &MarketMakerConfig::user_id)
+        .def_readwrite("fair_value", &MarketMakerConfig::fair_value)
+        .def_readwrite("half_spread", &MarketMakerConfig::half_spread)
+        .def_readwrite("size", &MarketMakerConfig::size)
+        .def_readwrite("max_inventory", &MarketMakerConfig::max_inventory)
+        .def_readwrite("skew", &MarketMakerConfig::skew)
+        .def_readwrite("fair_step_ticks", &MarketMakerConfig::fair_step_ticks)
+        .def_readwrite("seed", &MarketMakerConfig::seed);
+    
+    py::class_<MarketMaker>(m, "MarketMaker")
+        .def_property_readonly("fair_value", &MarketMaker::fair_value)
+        .def_property_readonly("config", &MarketMaker::config);
+    
+    py::class_<AdminAction>(m, "AdminAction")
+        .def(py::init<>())
+        .def(py::init<AdminActionType, InstrumentId, Price, TickPolicy>(),
+             py::arg("type"), py::arg("instrument_id"), py::arg("value") = 0,
+             py::arg("tick_policy") = TickPolicy::CANCEL)
+        .def_readwrite("type", &AdminAction::type)
+        .def_readwrite("instrument_id", &AdminAction::instrument_id)
+        .def_readwrite("value", &AdminAction::value)
+        .def_readwrite("tick_policy", &AdminAction::tick_policy);
+    
+    py::class_<EngineEvent>(m, "EngineEvent")
+        .def_readonly("seq", &EngineEvent::seq)
+        .def_readonly("type", &EngineEvent::type)
+        .def_readonly("instrument_id", &EngineEvent::instrument_id)
+        .def_readonly("user_id", &EngineEvent::user_id)
+        .def_readonly("order_id", &EngineEvent::order_id)
+        .def_readonly("side", &EngineEvent::side)
+        .def_readonly("price", &EngineEvent::price)
+        .def_readonly("quantity", &EngineEvent::quantity)
+        .def_readonly("value", &EngineEvent::value)
+        .def_readonly("order_ids", &EngineEvent::order_ids);
+    
+    py::class_<JournalLevel>(m, "JournalLevel")
+        .def_readonly("instrument_id", &JournalLevel::instrument_id)
+        .def_readonly("side", &JournalLevel::side)
+        .def_readonly("price", &JournalLevel::price)
+        .def_readonly("size", &JournalLevel::size);
+    
+    py::class_<JournalRecord>(m, "JournalRecord")
+        .def_readonly("seq", &JournalRecord::seq)
+        .def_readonly("timestamp", &JournalRecord::timestamp)
+        .def_readonly("level", &JournalRecord::level);
+    
+    py::class_<L3Event>(m, "L3Event")
+        .def(py::init<>())
+        .def_readwrite("seq", &L3Event::seq)
+        .def_readwrite("instrument_id", &L3Event::instrument_id)
+        .def_readwrite("type", &L3Event::type)
+        .def_readwrite("order_id", &L3Event::order_id)
+        .def_readwrite("side", &L3Event::side)
+        .def_readwrite("price", &L3Event::price)
+        .def_readwrite("quantity", &L3Event::quantity)
+        .def_readwrite("position", &L3Event::position);
+    
+    py::class_<L3Order>(m, "L3Order")
+        .def_readonly("order_id", &L3Order::order_id)
+        .def_readonly("quantity", &L3Order::quantity);
+    
+    py::class_<L3Level>(m, "L3Level")
+        .def_readonly("price", &L3Level::price)
+        .def_readonly("orders", &L3Level::orders);
+    
+    py::class_<L3Snapshot>(m, "L3Snapshot")
+        .def_readonly("instrument_id", &L3Snapshot::instrument_id)
+        .def_readonly("seq", &L3Snapshot::seq)
+        .def_readonly("bids", &L3Snapshot::bids)
+        .def_readonly("asks", &L3Snapshot::asks);
+    
+    py::class_<MarketDataSubscription>(m, "MarketDataSubscription")
+        .def(py::init<>())
+        .def_readonly("client_id", &MarketDataSubscription::client_id)
+        .def_readonly("depth", &MarketDataSubscription::depth);
+    
+    py::class_<InstrumentStateChange>(m, "InstrumentStateChange")
+        .def_readonly("type", &InstrumentStateChange::type)
+        .def_readonly("instrument_id", &InstrumentStateChange::instrument_id)
+        .def_readonly("value", &InstrumentStateChange::value);
+    
+    py::class_<AdminResult>(m, "AdminResult")
+        .def(py::init<>())
+        .def_readonly("success", &AdminResult::success)
+        .def_readonly("error_message", &AdminResult::error_message)
+        .def_readonly("failed_index", &AdminResult::failed_index)
+        .def_readonly("changes", &AdminResult::changes)
+        .def_readonly("cancelled_orders", &AdminResult::cancelled_orders)
+        .def_readonly("settlement_pnl", &AdminResult::settlement_pnl);
+    
+    py::class_<MemoryUsage>(m, "MemoryUsage")
+        .def(py::init<>())
+        .def_readonly("used", &MemoryUsage::used)
+        .def_readonly("reserved", &MemoryUsage::reserved);
+    
+    py::class_<Engine::MemoryStats>(m, "MemoryStats")
+        .def(py::init<>())
+        .def_readonly("books", &Engine::MemoryStats::books)
+        .def_readonly("orders", &Engine::MemoryStats::orders)
+        .def_readonly("positions", &Engine::MemoryStats::positions)
+        .def_readonly("history", &Engine::MemoryStats::history)
+        .def_readonly("indexes", &Engine::MemoryStats::indexes)
+        .def_readonly("events", &Engine::MemoryStats::events)
+        .def("total", &Engine::MemoryStats::total);
     
     py::class_<Engine::Stats>(m, "Stats")
         .def(py::init<>())
         .def_readonly("total_orders", &Engine::Stats::total_orders)
         .def_readonly("total_fills", &Engine::Stats::total_fills)
         .def_readonly("total_cancels", &Engine::Stats::total_cancels)
-        .def_readonly("total_rejects", &Engine::Stats::total_rejects);
+        .def_readonly("total_rejects", &Engine::Stats::total_rejects)
+        .def_readonly("memory", &Engine::Stats::memory);
     
     py::class_<Engine::TradeRecord>(m, "TradeRecord")
         .def(py::init<>())
+        .def_readonly("seq", &Engine::TradeRecord::seq)
+        .def_readonly("timestamp_ns", &Engine::TradeRecord::timestamp_ns)
         .def_readonly("buy_order_id", &Engine::TradeRecord::buy_order_id)
         .def_readonly("sell_order_id", &Engine::TradeRecord::sell_order_id)
         .def_readonly("buyer_id", &Engine::TradeRecord::buyer_id)
@@ -132,17 +365,18 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def_readonly("instrument_id", &Engine::TradeRecord::instrument_id)
         .def_readonly("price", &Engine::TradeRecord::price)
         .def_readonly("quantity", &Engine::TradeRecord::quantity)
-        .def_readonly("timestamp", &Engine::TradeRecord::timestamp);
+        .def_readonly("aggressor_side", &Engine::TradeRecord::aggressor_side);
     
     // Engine class
     py::class_<Engine>(m, "Engine")
-        .def(py::init<>())
+        .def(py::init<size_t>(),
+             py::arg("retransmit_capacity") = Engine::kDefaultRetransmitCapacity)
         .def("add_instrument", &Engine::add_instrument,
              py::arg("spec"),
              "Add a new instrument to the engine")
         .def("halt_instrument", &Engine::halt_instrument,
-             py::arg("id"), py::arg("halted"),
-             "Halt or resume trading on an instrument")
+             py::arg("id"), py::arg("halted"), py::arg("cancel_orders") = false,
+             "Halt or resume trading on an instrument, optionally pulling all resting orders")
         .def("get_instrument", &Engine::get_instrument,
              py::arg("id"),
              py::return_value_policy::reference,
@@ -150,6 +384,44 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def("submit_order", &Engine::submit_order,
              py::arg("request"),
              "Submit a new order")
+        .def("submit_package",
+             [](Engine& engine, UserId user_id,
+                const std::vector<InstrumentId>& instrument_ids,
+                const std::vector<Side>& sides,
+                const std::vector<Price>& prices,
+                const std::vector<Quantity>& quantities,
+                TimeInForce tif) {
+                 size_t n = instrument_ids.size();
+                 if (sides.size() != n || prices.size() != n || quantities.size() != n) {
+                     throw py::value_error("Package arrays must have equal length");
+                 }
+                 std::vector<OrderRequest> legs(n);
+                 for (size_t i = 0; i < n; ++i) {
+                     legs[i].user_id = user_id;
+                     legs[i].instrument_id = instrument_ids[i];
+                     legs[i].side = sides[i];
+                     legs[i].price = prices[i];
+                     legs[i].quantity = quantities[i];
+                     legs[i].tif = tif;
+                 }
+                 return engine.submit_package(legs);
+             },
+             py::arg("user_id"), py::arg("instrument_ids"), py::arg("sides"),
+             py::arg("prices"), py::arg("quantities"), py::arg("tif") = TimeInForce::GFD,
+             "Submit orders across several instruments in one step (IOC is all-or-none)")
+        .def("mass_quote", &Engine::mass_quote,
+             py::arg("user_id"), py::arg("quotes"),
+             "Replace the user's quotes on each instrument in one validated step")
+        .def("enable_market_maker", &Engine::enable_market_maker,
+             py::arg("config"),
+             "Start (or reconfigure) the built-in market maker on an instrument")
+        .def("disable_market_maker", &Engine::disable_market_maker,
+             py::arg("instrument_id"))
+        .def("step_market_makers", &Engine::step_market_makers,
+             "Advance every bot's fair value and requote; returns the fills")
+        .def("get_market_maker", &Engine::get_market_maker,
+             py::arg("instrument_id"),
+             py::return_value_policy::reference_internal)
         .def("cancel_order", &Engine::cancel_order,
              py::arg("order_id"), py::arg("user_id"),
              "Cancel an order")
@@ -160,12 +432,56 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def("cancel_all", &Engine::cancel_all,
              py::arg("user_id"),
              "Cancel all orders for a user")
+        .def("set_aggregate_fills", &Engine::set_aggregate_fills,
+             py::arg("enabled"),
+             "One aggressor fill per price level swept instead of per resting order")
+        .def("aggregate_fills", &Engine::aggregate_fills,
+             "Whether sweeps report aggregated aggressor fills")
+        .def("set_cancel_on_disconnect", &Engine::set_cancel_on_disconnect,
+             py::arg("user_id"), py::arg("enabled"),
+             "Cancel the user's resting orders when they disconnect")
+        .def("user_disconnected", &Engine::user_disconnected,
+             py::arg("user_id"),
+             "Bulk-cancel a flagged user's orders; returns the cancelled ids")
         .def("get_snapshot", &Engine::get_snapshot,
+             py::arg("instrument_id"), py::arg("depth") = 10,
+             "Get a market data snapshot stamped with the engine event seq")
+        .def("subscribe_market_data", &Engine::subscribe_market_data,
+             py::arg("client_id"), py::arg("instrument_id"), py::arg("depth"),
+             "Subscribe a client to a book at a depth; resubscribing changes the depth")
+        .def("unsubscribe_market_data", &Engine::unsubscribe_market_data,
+             py::arg("client_id"), py::arg("instrument_id"))
+        .def("unsubscribe_all_market_data", &Engine::unsubscribe_all_market_data,
+             py::arg("client_id"))
+        .def("get_market_data_subscribers", &Engine::get_market_data_subscribers,
+             py::arg("instrument_id"))
+        .def("get_market_data_subscriptions", &Engine::get_market_data_subscriptions,
+             py::arg("client_id"))
+        .def("take_market_data_updates", &Engine::take_market_data_updates,
+             py::arg("client_id"),
+             "Subscribed books changed since the client's last call")
+        .def("subscribe_l3", &Engine::subscribe_l3,
+             py::arg("client_id"), py::arg("instrument_id"),
+             "Follow a book order by order")
+        .def("unsubscribe_l3", &Engine::unsubscribe_l3,
+             py::arg("client_id"), py::arg("instrument_id"))
+        .def("unsubscribe_all_l3", &Engine::unsubscribe_all_l3,
+             py::arg("client_id"))
+        .def("get_l3_subscribers", &Engine::get_l3_subscribers,
+             py::arg("instrument_id"))
+        .def("get_l3_subscriptions", &Engine::get_l3_subscriptions,
+             py::arg("client_id"))
+        .def("drain_l3_events", &Engine::drain_l3_events,
+             "Order-level events of subscribed books since the last drain")
+        .def("get_l3_snapshot", &Engine::get_l3_snapshot,
              py::arg("instrument_id"),
-             "Get market data snapshot")
+             "Every resting order by level, as of the snapshot's seq")
         .def("get_orders", &Engine::get_orders,
              py::arg("instrument_id"),
              "Get all active orders for an instrument")
+        .def("get_user_orders", &Engine::get_user_orders,
+             py::arg("user_id"),
+             "Get a user's open orders in arrival order")
         .def("get_positions", &Engine::get_positions,
              py::arg("user_id"),
              "Get positions for a user")
@@ -175,6 +491,34 @@ PYBIND11_MODULE(mmg_engine, m) {
         .def("settle_instrument", &Engine::settle_instrument,
              py::arg("instrument_id"), py::arg("settlement_value"),
              "Settle an instrument at a given value")
+        .def("set_tick_size", &Engine::set_tick_size,
+             py::arg("instrument_id"), py::arg("tick_size"), py::arg("policy"),
+             "Change tick size, cancelling or re-pricing resting orders")
+        .def("drain_events", [](Engine& engine) {
+                 std::vector<EngineEvent> events;
+                 bool complete = engine.drain_events(events);
+                 return py::make_tuple(complete, events);
+             },
+             "Sequenced engine events emitted since the last call as (complete, events); "
+             "complete is False when the retransmit ring overwrote some first")
+        .def_property_readonly("last_seq", &Engine::last_seq)
+        .def("replay_from", [](const Engine& engine, uint64_t from_seq) {
+                 std::vector<EngineEvent> events;
+                 bool complete = engine.replay_from(from_seq, events);
+                 return py::make_tuple(complete, events);
+             },
+             py::arg("from_seq"),
+             "Cached events with seq >= from_seq as (complete, events); "
+             "complete is False once from_seq has left the retransmit ring")
+        .def("reconstruct_at", &Engine::reconstruct_at,
+             py::arg("timestamp"),
+             "Every non-empty book at a past wall-clock time, full depth")
+        .def("reconstruct_at_seq", &Engine::reconstruct_at_seq,
+             py::arg("seq"),
+             "Every non-empty book as of a past event seq, full depth")
+        .def("apply_admin_batch", &Engine::apply_admin_batch,
+             py::arg("actions"),
+             "Validate and apply a list of admin actions in one step")
         .def("set_risk_limits", &Engine::set_risk_limits,
              py::arg("user_id"), py::arg("limits"),
              "Set risk limits for a user")
@@ -182,13 +526,133 @@ PYBIND11_MODULE(mmg_engine, m) {
              py::arg("user_id"), py::arg("instrument_id"),
              py::arg("side"), py::arg("quantity"),
              "Check if order passes risk limits")
+        .def("set_mark_config", &Engine::set_mark_config,
+             py::arg("instrument_id"), py::arg("config"),
+             "Select how an instrument's mark price is derived")
+        .def("get_implied_quote", &Engine::get_implied_quote,
+             py::arg("instrument_id"),
+             "Get implied-in (combo) or implied-out (leg) top of book")
+        .def("get_mark_price", &Engine::get_mark_price,
+             py::arg("instrument_id"),
+             "Get the cached mark price")
+        .def("set_risk_params", &Engine::set_risk_params,
+             py::arg("params"),
+             "Set volatility, expiry and scenario grid for portfolio risk")
+        .def("get_risk_params", &Engine::get_risk_params,
+             "Get portfolio risk parameters")
+        .def("get_user_risk", &Engine::get_user_risk,
+             py::arg("user_id"),
+             "Get greeks and scenario PnL for a user's option chains")
+        .def("get_room_risk", &Engine::get_room_risk,
+             "Get greeks and scenario PnL across all users")
         .def("get_stats", &Engine::get_stats,
              "Get engine statistics")
         .def("get_trade_history", &Engine::get_trade_history,
-             py::return_value_policy::reference,
              "Get trade history")
         .def("get_fill_history", &Engine::get_fill_history,
              py::return_value_policy::reference,
-             "Get fill history");
+             "Get fill history")
+        .def("get_trade_history_bytes", [](const Engine& engine) {
+                 auto trades = engine.get_trade_history();
+                 return py::bytes(reinterpret_cast<const char*>(trades.data()),
+                                  trades.size() * sizeof(Engine::TradeRecord));
+             },
+             "Trade history as raw records, see TRADE_RECORD_FORMAT")
+        .def("get_fill_history_bytes", [](const Engine& engine) {
+                 const auto& fills = engine.get_fill_history();
+                 return py::bytes(reinterpret_cast<const char*>(fills.data()),
+                                  fills.size() * sizeof(Fill));
+             },
+             "Fill history as raw records, see FILL_RECORD_FORMAT")
+        .def("get_user_fills", &Engine::get_user_fills,
+             py::arg("user_id"), py::arg("since") = 0, py::arg("limit") = SIZE_MAX,
+             "Get a user's fills, skipping the first `since` of them")
+        .def("export_fill_segment", [](const Engine& engine, bool compress) {
+                 auto bytes = segment::encode_fills(
+                     engine.get_fill_history(),
+                     compress ? segment::Compression::LZ : segment::Compression::NONE);
+                 return py::bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+             },
+             py::arg("compress") = true,
+             "Fill history as a columnar segment")
+        .def("export_journal_segment", [](const Engine& engine, bool compress) {
+                 auto bytes = segment::encode_journal(
+                     engine.get_journal().records(),
+                     compress ? segment::Compression::LZ : segment::Compression::NONE);
+                 return py::bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+             },
+             py::arg("compress") = true,
+             "Book journal as a columnar segment")
+        .def("command_count", &Engine::command_count,
+             "Number of state-changing commands run or applied")
+        .def("annotate", &Engine::annotate,
+             py::arg("data"),
+             "Send application data to replicas in order with the commands");
+
+#ifndef _WIN32
+    py::class_<ReplicationServer>(m, "ReplicationServer")
+        .def(py::init<std::string, size_t>(), py::arg("path"),
+             py::arg("log_limit") = ReplicationServer::kDefaultLogLimit)
+        .def("listening", &ReplicationServer::listening)
+        .def("attach", &ReplicationServer::attach,
+             py::arg("engine"), py::keep_alive<1, 2>(),
+             "Stream the engine's commands to replicas")
+        .def("flush", &ReplicationServer::flush,
+             "Accept new replicas and send pending commands")
+        .def("replicas", &ReplicationServer::replicas)
+        .def("log_size", &ReplicationServer::log_size)
+        .def("log_start", &ReplicationServer::log_start)
+        .def("memory_usage", &ReplicationServer::memory_usage);
+    
+    py::class_<ReplicationClient>(m, "ReplicationClient")
+        .def(py::init<Engine&, std::string>(),
+             py::arg("engine"), py::arg("path"), py::keep_alive<1, 2>())
+        .def("connect", &ReplicationClient::connect)
+        .def("connected", &ReplicationClient::connected)
+        .def("poll", &ReplicationClient::poll,
+             py::arg("timeout_ms") = 0, py::call_guard<py::gil_scoped_release>(),
+             "Apply arriving commands; False once the primary is gone or diverged")
+        .def("applied", &ReplicationClient::applied)
+        .def("diverged", &ReplicationClient::diverged)
+        .def("take_annotations", &ReplicationClient::take_annotations);
+#endif
+    
+    // Compact binary L3 batches for the wire
+    m.def("encode_l3_events", [](const std::vector<L3Event>& events) {
+              auto bytes = l3::encode(events);
+              return py::bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+          },
+          py::arg("events"));
+    m.def("decode_l3_events", [](const py::bytes& data) {
+              std::string raw = data;
+              std::vector<L3Event> events;
+              if (!l3::decode(reinterpret_cast<const uint8_t*>(raw.data()), raw.size(), events)) {
+                  throw py::value_error("Malformed L3 batch");
+              }
+              return events;
+          },
+          py::arg("data"));
+    
+    // Reading exported segments back
+    m.def("decode_fill_segment", [](const py::bytes& data) {
+              std::string raw = data;
+              std::vector<Fill> fills;
+              if (!segment::decode_fills(reinterpret_cast<const uint8_t*>(raw.data()),
+                                         raw.size(), fills)) {
+                  throw py::value_error("Malformed fill segment");
+              }
+              return fills;
+          },
+          py::arg("data"));
+    m.def("decode_journal_segment", [](const py::bytes& data) {
+              std::string raw = data;
+              std::vector<JournalRecord> records;
+              if (!segment::decode_journal(reinterpret_cast<const uint8_t*>(raw.data()),
+                                           raw.size(), records)) {
+                  throw py::value_error("Malformed journal segment");
+              }
+              return records;
+          },
+          py::arg("data"));
 }
 
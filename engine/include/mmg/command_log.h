@@ -0,0 +1,148 @@
+#pragma once
+
+#include "engine.h"
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace mmg {
+
+// Engine inputs as replayable frames. A frame is
+//   u32 body length | u64 command number | i64 clock (ns) | u8 type | arguments
+// with fixed-width little-endian fields; the engine is the only producer
+// and consumer, so the layout favours speed over compactness.
+enum class CommandType : uint8_t {
+    ADD_INSTRUMENT = 1,
+    HALT_INSTRUMENT = 2,
+    SET_TICK_SIZE = 3,
+    SUBMIT_ORDER = 4,
+    SUBMIT_PACKAGE = 5,
+    MASS_QUOTE = 6,
+    ENABLE_MARKET_MAKER = 7,
+    DISABLE_MARKET_MAKER = 8,
+    STEP_MARKET_MAKERS = 9,
+    CANCEL_ORDER = 10,
+    REPLACE_ORDER = 11,
+    CANCEL_ALL = 12,
+    SET_CANCEL_ON_DISCONNECT = 13,
+    USER_DISCONNECTED = 14,
+    SETTLE_INSTRUMENT = 15,
+    ADMIN_BATCH = 16,
+    SET_RISK_LIMITS = 17,
+    SET_MARK_CONFIG = 18,
+    SET_RISK_PARAMS = 19,
+    ANNOTATE = 20,  // Opaque application bytes; no engine effect
+    SET_AGGREGATE_FILLS = 21
+};
+
+constexpr size_t kCommandHeaderSize = 4 + 8 + 8 + 1;
+
+// Far above any real command; a replica treats a longer frame as corrupt
+// rather than buffering toward it
+constexpr size_t kMaxCommandFrameSize = size_t(16) << 20;
+
+class CommandWriter {
+public:
+    explicit CommandWriter(std::vector<uint8_t>& out) : out_(out) {}
+    
+    template <typename T>
+    void put(T value) noexcept {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "POD field expected");
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out_.insert(out_.end(), bytes, bytes + sizeof(T));
+    }
+    
+    void put(const std::string& s) noexcept;
+    void put(const ComboLeg& leg) noexcept;
+    void put(const OrderRequest& request) noexcept;
+    void put(const Quote& quote) noexcept;
+    void put(const InstrumentSpec& spec) noexcept;
+    void put(const MarketMakerConfig& config) noexcept;
+    void put(const AdminAction& action) noexcept;
+    void put(const RiskLimits& limits) noexcept;
+    void put(const MarkConfig& config) noexcept;
+    void put(const RiskParams& params) noexcept;
+    
+    template <typename T>
+    void put(const std::vector<T>& items) noexcept {
+        put(static_cast<uint32_t>(items.size()));
+        for (const auto& item : items) put(item);
+    }
+    
+private:
+    std::vector<uint8_t>& out_;
+};
+
+// Bounds-checked counterpart; any overrun clears ok() and yields zeros
+class CommandReader {
+public:
+    CommandReader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+    
+    bool ok() const noexcept { return ok_; }
+    bool done() const noexcept { return ok_ && p_ == end_; }
+    
+    template <typename T>
+    void get(T& value) noexcept {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "POD field expected");
+        if (!ok_ || static_cast<size_t>(end_ - p_) < sizeof(T)) {
+            ok_ = false;
+            value = T();
+            return;
+        }
+        std::memcpy(&value, p_, sizeof(T));
+        p_ += sizeof(T);
+    }
+    
+    void get(bool& value) noexcept;
+    void get(std::string& s) noexcept;
+    void get(ComboLeg& leg) noexcept;
+    void get(OrderRequest& request) noexcept;
+    void get(Quote& quote) noexcept;
+    void get(InstrumentSpec& spec) noexcept;
+    void get(MarketMakerConfig& config) noexcept;
+    void get(AdminAction& action) noexcept;
+    void get(RiskLimits& limits) noexcept;
+    void get(MarkConfig& config) noexcept;
+    void get(RiskParams& params) noexcept;
+    
+    template <typename T>
+    void get(std::vector<T>& items) noexcept {
+        uint32_t count = 0;
+        get(count);
+        // Every element takes at least a byte, which bounds bogus counts
+        if (!ok_ || count > static_cast<size_t>(end_ - p_)) {
+            ok_ = false;
+            return;
+        }
+        items.resize(count);
+        for (auto& item : items) get(item);
+    }
+    
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ = true;
+};
+
+// Frames the current outermost command for the sink
+template <typename... Args>
+void Engine::record(CommandType type, const Args&... args) noexcept {
+    if (!command_sink_) return;
+    
+    std::vector<uint8_t>& frame = command_frame_;
+    frame.clear();
+    CommandWriter out(frame);
+    out.put(uint32_t(0));  // Body length, patched below
+    out.put(commands_);
+    out.put(static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock_.time_since_epoch()).count()));
+    out.put(type);
+    (out.put(args), ...);
+    
+    uint32_t body = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    std::memcpy(frame.data(), &body, sizeof(body));
+    command_sink_(frame.data(), frame.size());
+}
+
+}  // namespace mmg
@@ -2,6 +2,15 @@
 
 #include "types.h"
 #include "order_book.h"
+#include "risk_engine.h"
+#include "mark_price.h"
+#include "implied_engine.h"
+#include "event_log.h"
+#include "journal.h"
+#include "market_data.h"
+#include "l3_feed.h"
+#include "market_maker.h"
+#include <algorithm>
 #include <map>
 #include <set>
 #include <memory>
@@ -11,6 +20,9 @@
 
 namespace mmg {
 
+enum class CommandType : uint8_t;
+class CommandReader;
+
 struct RiskLimits {
     Quantity max_position;        // Max absolute position per instrument
     double max_notional;          // Max total notional exposure
@@ -19,15 +31,67 @@ struct RiskLimits {
     RiskLimits() : max_position(10000), max_notional(1000000.0), max_orders_per_sec(50) {}
 };
 
+// What happens to resting orders when an instrument's tick size changes
+enum class TickPolicy : uint8_t {
+    CANCEL = 0,   // Cancel every resting order
+    REPRICE = 1   // Snap onto the new grid, bids down and asks up
+};
+
+// Exchange-console operations applied as one batch
+enum class AdminActionType : uint8_t {
+    HALT = 0,
+    RESUME = 1,
+    SET_TICK = 2,      // value = new tick size; resting orders follow tick_policy
+    PULL_QUOTES = 3,
+    SETTLE = 4,        // value = settlement value; resting orders are pulled
+    SETTLE_CHAIN = 5   // SETTLE on an underlying plus every option referencing it
+};
+
+struct AdminAction {
+    AdminActionType type;
+    InstrumentId instrument_id;
+    Price value;
+    TickPolicy tick_policy;
+    
+    AdminAction() : type(AdminActionType::HALT), instrument_id(0), value(0),
+                    tick_policy(TickPolicy::CANCEL) {}
+    AdminAction(AdminActionType t, InstrumentId id, Price v = 0,
+                TickPolicy policy = TickPolicy::CANCEL)
+        : type(t), instrument_id(id), value(v), tick_policy(policy) {}
+};
+
+// One applied change; chain settlements are expanded per instrument and
+// option settlement values are in the option's own price scale
+struct InstrumentStateChange {
+    AdminActionType type;
+    InstrumentId instrument_id;
+    Price value;
+};
+
+struct AdminResult {
+    bool success;
+    std::string error_message;
+    size_t failed_index;                      // First invalid action when !success
+    std::vector<InstrumentStateChange> changes;
+    std::vector<OrderId> cancelled_orders;
+    std::map<UserId, double> settlement_pnl;  // Realized PnL booked by settlements
+    
+    AdminResult() : success(false), failed_index(0) {}
+};
+
 class Engine {
 public:
-    Engine();
+    // Events kept for retransmission before the oldest is overwritten
+    static constexpr size_t kDefaultRetransmitCapacity = 16384;
+    
+    explicit Engine(size_t retransmit_capacity = kDefaultRetransmitCapacity);
     ~Engine();
     
     // Instrument management
     bool add_instrument(const InstrumentSpec& spec) noexcept;
-    bool halt_instrument(InstrumentId id, bool halted) noexcept;
+    bool halt_instrument(InstrumentId id, bool halted, bool cancel_orders = false) noexcept;
     InstrumentSpec* get_instrument(InstrumentId id) noexcept;
+    bool set_tick_size(InstrumentId id, Price tick_size, TickPolicy policy) noexcept;
     
     // Order operations
     struct OrderResult {
@@ -35,18 +99,68 @@ public:
         bool success;
         std::string error_message;
         std::vector<Fill> fills;
+        uint64_t seq;  // Of the ORDER_ACCEPTED event; 0 when rejected
         
-        OrderResult() : order_id(0), success(false) {}
+        OrderResult() : order_id(0), success(false), seq(0) {}
     };
     
     OrderResult submit_order(const OrderRequest& request) noexcept;
+    
+    // Several orders from one user across distinct instruments, validated
+    // together and executed in one step. IOC packages are all-or-none.
+    struct PackageResult {
+        bool success;
+        std::string error_message;
+        std::vector<OrderId> order_ids;  // One per leg, in request order
+        std::vector<uint64_t> seqs;      // Each leg's ORDER_ACCEPTED event
+        std::vector<Fill> fills;
+        
+        PackageResult() : success(false) {}
+    };
+    
+    PackageResult submit_package(const std::vector<OrderRequest>& legs) noexcept;
+    // Replace a user's quotes: each Quote cancels that user's previous
+    // mass-quote orders on its instrument and rests the new sides (GFD).
+    // All quotes are validated before anything changes.
+    struct MassQuoteResult {
+        bool success;
+        std::string error_message;
+        std::vector<OrderId> order_ids;  // Sides placed, in request order
+        std::vector<Fill> fills;
+        
+        MassQuoteResult() : success(false) {}
+    };
+    
+    MassQuoteResult mass_quote(UserId user_id, const std::vector<Quote>& quotes) noexcept;
+    
+    // Built-in liquidity provider, one per instrument, quoting through
+    // mass_quote. It requotes inside the engine whenever its house account
+    // trades; step_market_makers moves the fair values and requotes.
+    bool enable_market_maker(const MarketMakerConfig& config) noexcept;
+    bool disable_market_maker(InstrumentId id) noexcept;
+    std::vector<Fill> step_market_makers() noexcept;
+    const MarketMaker* get_market_maker(InstrumentId id) const noexcept;
+    
     bool cancel_order(OrderId order_id, UserId user_id) noexcept;
     bool replace_order(OrderId order_id, UserId user_id, 
                       Price* new_price, Quantity* new_qty) noexcept;
     bool cancel_all(UserId user_id) noexcept;
     
+    // Users flagged cancel-on-disconnect lose all resting orders in one
+    // bulk pass when user_disconnected is called; returns the cancelled ids
+    void set_cancel_on_disconnect(UserId user_id, bool enabled) noexcept;
+    std::vector<OrderId> user_disconnected(UserId user_id) noexcept;
+    
+    // Sweep reporting: when enabled an aggressor gets one fill per price level
+    // it takes instead of one per resting order hit. Passive fills and trade
+    // records are unchanged. Applies to every book, including later ones.
+    void set_aggregate_fills(bool enabled) noexcept;
+    bool aggregate_fills() const noexcept { return aggregate_fills_; }
+    
     // Market data
-    MarketSnapshot get_snapshot(InstrumentId id) const noexcept;
+    // Top `depth` levels stamped with the current event seq; a client applies
+    // LEVEL_UPDATE events with a greater seq to stay current
+    MarketSnapshot get_snapshot(InstrumentId id, size_t depth = 10) const noexcept;
     std::vector<std::shared_ptr<Order>> get_orders(InstrumentId id) const noexcept;
     
     // Position and PnL
@@ -56,35 +170,150 @@ public:
     // Settlement
     bool settle_instrument(InstrumentId id, Price settlement_value) noexcept;
     
+    // Validates every action first and applies none if any is invalid
+    AdminResult apply_admin_batch(const std::vector<AdminAction>& actions) noexcept;
+    
     // Risk management
     void set_risk_limits(UserId user_id, const RiskLimits& limits) noexcept;
     bool check_risk(UserId user_id, InstrumentId inst_id, 
                    Side side, Quantity qty) const noexcept;
     
+    // Market data interest. Changed books are queued per subscriber and
+    // taken by the publishing side, which encodes them at each depth.
+    bool subscribe_market_data(UserId client_id, InstrumentId id, uint32_t depth) noexcept;
+    bool unsubscribe_market_data(UserId client_id, InstrumentId id) noexcept {
+        return market_data_.unsubscribe(client_id, id);
+    }
+    void unsubscribe_all_market_data(UserId client_id) noexcept {
+        market_data_.unsubscribe_all(client_id);
+    }
+    const std::vector<MarketDataSubscription>& get_market_data_subscribers(InstrumentId id) const noexcept {
+        return market_data_.subscribers(id);
+    }
+    std::vector<InstrumentId> get_market_data_subscriptions(UserId client_id) const noexcept {
+        return market_data_.subscriptions(client_id);
+    }
+    std::vector<InstrumentId> take_market_data_updates(UserId client_id) noexcept {
+        return market_data_.take_updates(client_id);
+    }
+    
+    // Order-by-order (L3) feed. A book reports order changes only while its
+    // instrument has an L3 subscriber; drain_l3_events hands them to the
+    // publishing side, and get_l3_snapshot bootstraps a subscriber.
+    bool subscribe_l3(UserId client_id, InstrumentId id) noexcept;
+    bool unsubscribe_l3(UserId client_id, InstrumentId id) noexcept;
+    void unsubscribe_all_l3(UserId client_id) noexcept;
+    const std::set<UserId>& get_l3_subscribers(InstrumentId id) const noexcept {
+        return l3_feed_.subscribers(id);
+    }
+    std::vector<InstrumentId> get_l3_subscriptions(UserId client_id) const noexcept {
+        return l3_feed_.subscriptions(client_id);
+    }
+    std::vector<L3Event> drain_l3_events() noexcept { return l3_feed_.drain(); }
+    L3Snapshot get_l3_snapshot(InstrumentId id) const noexcept;
+    
+    // Implied top of book: implied-in for combos, implied-out for legs
+    ImpliedQuote get_implied_quote(InstrumentId id) const noexcept;
+    
+    // Mark prices (cached per instrument, refreshed on book and trade events)
+    bool set_mark_config(InstrumentId id, const MarkConfig& config) noexcept;
+    Price get_mark_price(InstrumentId id) const noexcept { return marks_.get(id); }
+    
+    // Portfolio risk (greeks and scenario PnL across option chains)
+    void set_risk_params(const RiskParams& params) noexcept;
+    const RiskParams& get_risk_params() const noexcept { return risk_.get_params(); }
+    RiskReport get_user_risk(UserId user_id) const noexcept;
+    RiskReport get_room_risk() const noexcept;
+    
+    // Estimated heap footprint by area, walked on demand
+    struct MemoryStats {
+        MemoryUsage books;      // Price levels, queues and per-book id indexes
+        MemoryUsage orders;     // Resting order objects and the engine's order indexes
+        MemoryUsage positions;  // Positions and chain-risk slots
+        MemoryUsage history;    // Trade and fill history, book journal
+        MemoryUsage indexes;    // Instruments, limits, holders, marks and implied state
+        MemoryUsage events;     // Retransmit ring
+        
+        MemoryUsage total() const noexcept;
+    };
+    MemoryStats get_memory_stats() const noexcept;
+    
     // Statistics
     struct Stats {
         uint64_t total_orders;
         uint64_t total_fills;
         uint64_t total_cancels;
         uint64_t total_rejects;
+        MemoryStats memory;  // Filled in by get_stats
     };
     Stats get_stats() const noexcept;
     
     // Export history
+    // Fixed-size like Fill; seq is that of the passive fill
     struct TradeRecord {
+        uint64_t seq;
+        int64_t timestamp_ns;  // Nanoseconds since the Unix epoch
         OrderId buy_order_id;
         OrderId sell_order_id;
+        Price price;
+        Quantity quantity;
         UserId buyer_id;
         UserId seller_id;
         InstrumentId instrument_id;
-        Price price;
-        Quantity quantity;
-        Timestamp timestamp;
+        Side aggressor_side;
+        uint8_t reserved[3];   // Always zero
+        
+        TradeRecord() : seq(0), timestamp_ns(0), buy_order_id(0), sell_order_id(0), price(0),
+                        quantity(0), buyer_id(0), seller_id(0), instrument_id(0),
+                        aggressor_side(Side::BUY), reserved() {}
     };
     
-    const std::vector<TradeRecord>& get_trade_history() const noexcept { return trade_history_; }
+    // Built on request from the fill pairs in the fill history
+    std::vector<TradeRecord> get_trade_history() const noexcept;
+    size_t trade_count() const noexcept { return trades_.size(); }
     const std::vector<Fill>& get_fill_history() const noexcept { return fill_history_; }
     
+    // One user's history without scanning everyone else's. since counts the
+    // user's own fills already seen, so a reconnecting client passes how many
+    // it holds; both calls cost O(result).
+    std::vector<Fill> get_user_fills(UserId user_id, size_t since = 0,
+                                     size_t limit = SIZE_MAX) const noexcept;
+    std::vector<std::shared_ptr<Order>> get_user_orders(UserId user_id) const noexcept;
+    
+    // Every output (accepts, cancels, fills, bulk and admin changes) is an
+    // event with a session-wide sequence number. drain_events takes those
+    // since the last drain and returns false if the retransmit ring dropped
+    // some first; replay_from serves reconnecting clients from the ring and
+    // returns false once from_seq has been overwritten.
+    bool drain_events(std::vector<EngineEvent>& out) noexcept { return events_.drain(out); }
+    uint64_t last_seq() const noexcept { return events_.last_seq(); }
+    bool replay_from(uint64_t from_seq, std::vector<EngineEvent>& out) const noexcept {
+        return events_.replay_from(from_seq, out);
+    }
+    
+    // Every book as it stood at a past moment or seq, rebuilt from the
+    // journal's nearest checkpoint; cost is bounded by the checkpoint interval
+    std::vector<MarketSnapshot> reconstruct_at(Timestamp timestamp) const noexcept {
+        return journal_.reconstruct_at(timestamp);
+    }
+    std::vector<MarketSnapshot> reconstruct_at_seq(uint64_t seq) const noexcept {
+        return journal_.reconstruct_at_seq(seq);
+    }
+    const BookJournal& get_journal() const noexcept { return journal_; }
+    
+    // Replication. Every outermost call that changes engine state is a
+    // command: with a sink set, each is framed before it runs, and
+    // apply_command runs such a frame on another engine. Frames carry the
+    // primary's clock, so a replica applying every frame in order ends with
+    // the same order ids, books, positions, journal and event seqs.
+    using CommandSink = std::function<void(const uint8_t* frame, size_t size)>;
+    void set_command_sink(CommandSink sink) noexcept { command_sink_ = std::move(sink); }
+    bool apply_command(const uint8_t* frame, size_t size) noexcept;
+    uint64_t command_count() const noexcept { return commands_; }
+    
+    // Application bytes carried in order with the commands; no engine effect
+    void annotate(const std::string& data) noexcept;
+    
 private:
     std::atomic<OrderId> next_order_id_;
     
@@ -100,21 +329,117 @@ private:
     // Active orders: order_id -> order
     std::map<OrderId, std::shared_ptr<Order>> active_orders_;
     
-    // User orders: user_id -> set of order_ids
-    std::map<UserId, std::set<OrderId>> user_orders_;
+    // User orders: user_id -> open orders, keyed by id so in arrival order
+    std::map<UserId, std::map<OrderId, std::shared_ptr<Order>>> user_orders_;
     
-    // History
-    std::vector<TradeRecord> trade_history_;
+    // History. A trade is stored as the positions of its aggressor and
+    // passive fills in fill_history_ rather than as a second copy of them;
+    // 32 bits would take four billion fills in one room to outgrow.
+    struct TradeFills {
+        uint32_t taker;
+        uint32_t passive;
+    };
     std::vector<Fill> fill_history_;
+    std::vector<TradeFills> trades_;
+    
+    // Per-user positions in fill_history_, oldest first
+    std::map<UserId, std::vector<uint32_t>> user_fills_;
     
     // Statistics
     Stats stats_;
     
+    // Chain risk, fed by update_position and settle_instrument
+    RiskEngine risk_;
+    
+    // Cached marks, and who needs revaluing when one moves
+    MarkPriceService marks_;
+    std::map<InstrumentId, std::set<UserId>> holders_;
+    std::map<InstrumentId, std::vector<InstrumentId>> options_by_underlying_;
+    
+    // Combo definitions and implied prices
+    ImpliedEngine implied_;
+    
+    MarketDataPublisher market_data_;
+    L3Feed l3_feed_;
+    
+    // Resting mass-quote orders per (user, instrument), and the house bots
+    std::map<std::pair<UserId, InstrumentId>, std::vector<OrderId>> quotes_;
+    std::map<InstrumentId, MarketMaker> market_makers_;
+    bool requoting_ = false;
+    bool aggregate_fills_ = false;
+    
+    EventLog events_;
+    BookJournal journal_;
+    std::set<UserId> cancel_on_disconnect_;
+    
+    // Command stream. clock_ is read once per outermost command, or taken
+    // from the frame on a replica, and stamps everything the command does.
+    class CommandScope {
+    public:
+        explicit CommandScope(Engine& engine) noexcept
+            : engine_(engine), outer_(engine.command_depth_++ == 0) {
+            if (!outer_) return;
+            ++engine.commands_;
+            if (engine.clock_pinned_) return;
+            // Wall time, held back if the system clock steps backwards so
+            // that journal and fill times never decrease
+            engine.clock_ = std::max(engine.clock_, std::chrono::system_clock::now());
+        }
+        ~CommandScope() { --engine_.command_depth_; }
+        bool outer() const noexcept { return outer_; }
+    
+    private:
+        Engine& engine_;
+        bool outer_;
+    };
+    
+    CommandSink command_sink_;
+    std::vector<uint8_t> command_frame_;
+    uint64_t commands_ = 0;
+    uint32_t command_depth_ = 0;
+    bool clock_pinned_ = false;
+    Timestamp clock_;
+    
+    template <typename... Args>
+    void record(CommandType type, const Args&... args) noexcept;
+    bool dispatch_command(CommandType type, CommandReader& in) noexcept;
+    
     // Helper methods
+    bool validate_order(const OrderRequest& request, std::string& error) const noexcept;
+    OrderId execute_order(const OrderRequest& request, std::vector<Fill>& fills,
+                          uint64_t* accepted_seq = nullptr) noexcept;
+    std::shared_ptr<Order> detach_order(OrderId order_id, UserId user_id) noexcept;
+    void requote_market_makers(std::vector<Fill>& fills, bool requote_all = false) noexcept;
+    void process_fills(std::vector<Fill>& fills) noexcept;
     void update_position(UserId user_id, const Fill& fill) noexcept;
-    void calculate_unrealized_pnl(UserId user_id) noexcept;
-    Price get_mark_price(InstrumentId id) const noexcept;
+    void settle_positions(const InstrumentSpec& inst, Price settlement_value,
+                          std::map<UserId, double>* pnl) noexcept;
+    void set_halted(InstrumentSpec& inst, bool halted) noexcept;
+    void pull_quotes(InstrumentId id, std::vector<OrderId>& cancelled) noexcept;
+    void apply_tick_size(InstrumentId id, Price tick_size, TickPolicy policy,
+                         std::vector<OrderId>& cancelled) noexcept;
+    void forget_orders(const std::vector<std::shared_ptr<Order>>& orders) noexcept;
+    void update_combo_position(UserId user_id, const Fill& fill, const InstrumentSpec& combo) noexcept;
+    void on_book_changed(InstrumentId id) noexcept;
+    TopOfBook get_top_of_book(InstrumentId id) const noexcept;
+    bool legs_tradable(const std::vector<ComboLeg>& legs) const noexcept;
+    std::vector<Fill> execute_implied(const std::shared_ptr<Order>& order) noexcept;
+    std::vector<Fill> execute_legs(const std::vector<ComboLeg>& legs, OrderId parent_id,
+                                   UserId user_id, Side combo_side, Quantity combo_qty) noexcept;
+    std::vector<Fill> match_resting_combo(InstrumentId combo_id) noexcept;
+    std::vector<Fill> flush_implied() noexcept;
+    void refresh_mark(InstrumentId id) noexcept;
+    void on_mark_changed(InstrumentId id) noexcept;
+    void refresh_option_mark(InstrumentId option_id) noexcept;
+    void revalue_holders(InstrumentId id) noexcept;
+    double unrealized_pnl(const Position& pos) const noexcept;
+    std::map<InstrumentId, double> get_underlying_spots() const noexcept;
 };
 
+static_assert(sizeof(Engine::TradeRecord) == 64, "TradeRecord has implicit padding");
+static_assert(std::is_trivially_copyable_v<Engine::TradeRecord> &&
+              std::is_standard_layout_v<Engine::TradeRecord>,
+              "TradeRecord must stay memcpy-able");
+
 }  // namespace mmg
 
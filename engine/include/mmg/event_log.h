@@ -0,0 +1,41 @@
+#pragma once
+
+#include "events.h"
+#include "memory_stats.h"
+#include <vector>
+
+namespace mmg {
+
+// Assigns sequence numbers to engine events and keeps the most recent ones
+// in a fixed ring for retransmission. Sequence numbers start at 1; event
+// `seq` lives in slot (seq - 1) % capacity, so the ring never reallocates.
+class EventLog {
+public:
+    explicit EventLog(size_t capacity);
+    
+    // Stamp the next sequence number and store the event; returns its seq
+    uint64_t append(EngineEvent event) noexcept;
+    
+    uint64_t last_seq() const noexcept { return last_seq_; }
+    
+    // Oldest sequence number still cached (last_seq + 1 when empty)
+    uint64_t first_cached_seq() const noexcept;
+    
+    // Events with seq >= from_seq. Returns false, leaving `out` empty, if
+    // some of them have already been overwritten.
+    bool replay_from(uint64_t from_seq, std::vector<EngineEvent>& out) const noexcept;
+    
+    // Events appended since the last drain that are still cached. Returns
+    // false when some were overwritten first; `out` then holds the rest.
+    bool drain(std::vector<EngineEvent>& out) noexcept;
+    
+    size_t capacity() const noexcept { return ring_.size(); }
+    MemoryUsage memory_usage() const noexcept;
+    
+private:
+    std::vector<EngineEvent> ring_;
+    uint64_t last_seq_;
+    uint64_t drained_seq_;
+};
+
+}  // namespace mmg
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "types.h"
+#include <vector>
+
+namespace mmg {
+
+// Every engine output, in the order it happened
+enum class EngineEventType : uint8_t {
+    BOOK_RESET = 0,         // Price index rebuilt; consumers should re-snapshot
+    ORDERS_CANCELLED = 1,   // Many orders removed in one bulk operation
+    ORDER_ACCEPTED = 2,
+    ORDER_CANCELLED = 3,
+    FILL = 4,
+    INSTRUMENT_HALTED = 5,  // value: 1 halted, 0 resumed
+    INSTRUMENT_SETTLED = 6, // value: settlement value
+    LEVEL_UPDATE = 7        // side/price: level; quantity: new aggregate size, 0 = removed
+};
+
+struct EngineEvent {
+    uint64_t seq;                    // Session-wide, assigned by the event log
+    EngineEventType type;
+    InstrumentId instrument_id;
+    UserId user_id;                  // Owner for order events, or the bulk path's user
+    OrderId order_id;
+    Side side;
+    Price price;
+    Quantity quantity;
+    Price value;                     // BOOK_RESET: new tick size; see type comments
+    std::vector<OrderId> order_ids;  // Orders repriced (BOOK_RESET) or cancelled
+    
+    EngineEvent()
+        : seq(0), type(EngineEventType::BOOK_RESET), instrument_id(0), user_id(0),
+          order_id(0), side(Side::BUY), price(0), quantity(0), value(0) {}
+    EngineEvent(EngineEventType t, InstrumentId id)
+        : seq(0), type(t), instrument_id(id), user_id(0),
+          order_id(0), side(Side::BUY), price(0), quantity(0), value(0) {}
+};
+
+}  // namespace mmg
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.h"
+#include "memory_stats.h"
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace mmg {
+
+// Implied top of book. A side is absent when its size is 0; prices may be
+// zero or negative for spreads.
+struct ImpliedQuote {
+    Price bid;
+    Quantity bid_size;
+    Price ask;
+    Quantity ask_size;
+
+    ImpliedQuote() : bid(0), bid_size(0), ask(0), ask_size(0) {}
+};
+
+// Derives implied prices between combos and their outright legs.
+//
+// Implied-in: a combo's top of book built from its legs' books.
+// Implied-out: a leg's top of book built from a combo's resting orders
+// plus the combo's other legs (unit-ratio legs only).
+//
+// Only combos touching a changed book are recomputed: callers mark books
+// dirty as they mutate and recompute() walks the affected combos once.
+class ImpliedEngine {
+public:
+    using TopOfBookFn = std::function<TopOfBook(InstrumentId)>;
+
+    void add_combo(const InstrumentSpec& combo) noexcept;
+    bool is_combo(InstrumentId id) const noexcept { return combos_.count(id) != 0; }
+    const std::vector<ComboLeg>& get_legs(InstrumentId combo_id) const noexcept;
+
+    // A book changed; every combo containing it (or being it) needs recomputing
+    void mark_dirty(InstrumentId id) noexcept;
+    bool has_dirty() const noexcept { return !dirty_.empty(); }
+
+    // Recompute quotes for dirty combos and their legs; returns the combos touched
+    std::vector<InstrumentId> recompute(const TopOfBookFn& top_of_book) noexcept;
+
+    ImpliedQuote get_implied_in(InstrumentId combo_id) const noexcept;
+    ImpliedQuote get_implied_out(InstrumentId leg_id) const noexcept;
+
+    MemoryUsage memory_usage() const noexcept;
+
+    // Implied-in quote straight from leg books
+    static ImpliedQuote implied_in(const std::vector<ComboLeg>& legs,
+                                   const TopOfBookFn& top_of_book) noexcept;
+
+private:
+    struct ComboState {
+        std::vector<ComboLeg> legs;
+        ImpliedQuote implied_in;
+    };
+
+    std::map<InstrumentId, ComboState> combos_;
+    std::map<InstrumentId, std::vector<InstrumentId>> combos_by_leg_;
+    std::map<InstrumentId, ImpliedQuote> implied_out_;
+    std::set<InstrumentId> dirty_;
+
+    ImpliedQuote compute_implied_out(InstrumentId leg_id,
+                                     const TopOfBookFn& top_of_book) const noexcept;
+};
+
+}  // namespace mmg
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "types.h"
+#include "memory_stats.h"
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace mmg {
+
+// One aggregated price level as journaled; size 0 means the level is gone
+struct JournalLevel {
+    InstrumentId instrument_id;
+    Side side;
+    Price price;
+    Quantity size;
+};
+
+struct JournalRecord {
+    uint64_t seq;  // Engine event seq of the change
+    Timestamp timestamp;
+    JournalLevel level;
+};
+
+// Every level in every book at one point of the journal
+struct BookCheckpoint {
+    uint64_t seq;
+    Timestamp timestamp;
+    size_t record_index;  // Records before this index are folded in
+    std::vector<JournalLevel> levels;
+};
+
+// Append-only history of every book's aggregated levels. Every
+// checkpoint_interval records the live levels are copied into a checkpoint,
+// so rebuilding the books at any past time or seq loads the nearest
+// checkpoint and replays at most checkpoint_interval records.
+class BookJournal {
+public:
+    static constexpr size_t kDefaultCheckpointInterval = 4096;
+    
+    explicit BookJournal(size_t checkpoint_interval = kDefaultCheckpointInterval);
+    
+    void record(uint64_t seq, Timestamp timestamp, const JournalLevel& level) noexcept;
+    
+    // Replace one book's levels wholesale (after a retick, which moves levels
+    // without per-level updates); journals only the differences
+    void reset_book(uint64_t seq, Timestamp timestamp, const MarketSnapshot& book) noexcept;
+    
+    // Full-depth books with any levels as of the last change at or before the
+    // target, ordered by instrument
+    std::vector<MarketSnapshot> reconstruct_at(Timestamp timestamp) const noexcept;
+    std::vector<MarketSnapshot> reconstruct_at_seq(uint64_t seq) const noexcept;
+    
+    const std::vector<JournalRecord>& records() const noexcept { return records_; }
+    const std::vector<BookCheckpoint>& checkpoints() const noexcept { return checkpoints_; }
+    size_t size() const noexcept { return records_.size(); }
+    MemoryUsage memory_usage() const noexcept;
+    
+private:
+    struct Book {
+        std::map<Price, Quantity, std::greater<Price>> bids;
+        std::map<Price, Quantity> asks;
+    };
+    using Books = std::map<InstrumentId, Book>;
+    
+    static void apply(Books& books, const JournalLevel& level) noexcept;
+    
+    // Rebuild from the checkpoint `checkpoint`, then records while `before` holds
+    template <typename Before>
+    std::vector<MarketSnapshot> rebuild(const BookCheckpoint& checkpoint,
+                                        Before before) const noexcept;
+    
+    size_t checkpoint_interval_;
+    std::vector<JournalRecord> records_;
+    std::vector<BookCheckpoint> checkpoints_;
+    Books live_;
+};
+
+}  // namespace mmg
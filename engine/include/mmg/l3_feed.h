@@ -0,0 +1,98 @@
+#pragma once
+
+#include "types.h"
+#include "memory_stats.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace mmg {
+
+struct Order;
+
+enum class L3EventType : uint8_t {
+    ADD = 1,      // Order rests; quantity is what rests, position its place in the level
+    MODIFY = 2,   // Order moved to `price` at `position` (a retick); quantity remaining
+    EXECUTE = 3,  // Resting order traded `quantity`; gone once nothing remains
+    DELETE = 4    // Order left the book without trading
+};
+
+// One order-level change to a book. Seqs count per instrument, without
+// gaps while the instrument has subscribers.
+struct L3Event {
+    uint64_t seq;
+    InstrumentId instrument_id;
+    L3EventType type;
+    OrderId order_id;
+    Side side;
+    Price price;
+    Quantity quantity;
+    uint32_t position;  // Orders ahead at the level, for ADD and MODIFY
+    
+    L3Event() : seq(0), instrument_id(0), type(L3EventType::ADD), order_id(0),
+                side(Side::BUY), price(0), quantity(0), position(0) {}
+};
+
+struct L3Order {
+    OrderId order_id;
+    Quantity quantity;  // Remaining
+};
+
+struct L3Level {
+    Price price;
+    std::vector<L3Order> orders;  // Time priority
+};
+
+// Every resting order as of `seq`; apply events with a later seq on top
+struct L3Snapshot {
+    InstrumentId instrument_id;
+    uint64_t seq;
+    std::vector<L3Level> bids;  // Best first
+    std::vector<L3Level> asks;
+    
+    L3Snapshot() : instrument_id(0), seq(0) {}
+};
+
+// Order-by-order feed subscriptions and the events awaiting the publisher.
+// Books only report order changes while their instrument has a subscriber,
+// so unwatched books pay nothing.
+class L3Feed {
+public:
+    // True when this is the instrument's first subscriber
+    bool subscribe(UserId client_id, InstrumentId id) noexcept;
+    // True when this was the instrument's last subscriber
+    bool unsubscribe(UserId client_id, InstrumentId id) noexcept;
+    // Instruments left without subscribers
+    std::vector<InstrumentId> unsubscribe_all(UserId client_id) noexcept;
+    
+    const std::set<UserId>& subscribers(InstrumentId id) const noexcept;
+    std::vector<InstrumentId> subscriptions(UserId client_id) const noexcept;
+    
+    void publish(L3EventType type, const Order& order, Quantity quantity,
+                 uint32_t position) noexcept;
+    uint64_t last_seq(InstrumentId id) const noexcept;
+    
+    // Events since the last drain, in book order
+    std::vector<L3Event> drain() noexcept;
+    
+    MemoryUsage memory_usage() const noexcept;
+    
+private:
+    std::map<InstrumentId, std::set<UserId>> subscribers_;
+    std::map<UserId, std::set<InstrumentId>> subscriptions_;
+    std::map<InstrumentId, uint64_t> seqs_;
+    std::vector<L3Event> pending_;
+};
+
+// Wire encoding for L3 batches: per event one byte of type and side, then
+// varints for instrument, seq, order id, price (zigzag), quantity and
+// position. Seqs and order ids are deltas from the previous event of the
+// same instrument, so a typical event takes 8-12 bytes.
+namespace l3 {
+
+std::vector<uint8_t> encode(const std::vector<L3Event>& events) noexcept;
+// False, with `out` left empty, on truncated or malformed input
+bool decode(const uint8_t* data, size_t size, std::vector<L3Event>& out) noexcept;
+
+}  // namespace l3
+}  // namespace mmg
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.h"
+#include "memory_stats.h"
+#include <vector>
+
+namespace mmg {
+
+enum class MarkMethod : uint8_t {
+    LAST_OR_MID = 0,   // Last trade, else mid (default)
+    LAST = 1,
+    MID = 2,
+    MICROPRICE = 3,    // Size-weighted mid of the top of book
+    EMA_MID = 4,       // Exponential moving average of mid
+    OPTION_MODEL = 5   // Black-Scholes value from the underlying's mark
+};
+
+struct MarkConfig {
+    MarkMethod method;
+    double ema_alpha;  // Weight of the newest mid for EMA_MID
+
+    MarkConfig() : method(MarkMethod::LAST_OR_MID), ema_alpha(0.2) {}
+};
+
+// Model inputs for OPTION_MODEL marks
+struct OptionModel {
+    double cp_sign;   // +1 call, -1 put
+    double strike;    // Decimal
+    double volatility;
+    double time_to_expiry;
+    double rate;
+};
+
+// Per-instrument mark prices, maintained on book and trade events and
+// stored in a flat array indexed by instrument id so every reader is a
+// single load.
+class MarkPriceService {
+public:
+    void add_instrument(InstrumentId id) noexcept;
+    void configure(InstrumentId id, const MarkConfig& config) noexcept;
+    MarkConfig get_config(InstrumentId id) const noexcept;
+
+    // Recompute from the top of book; returns true if the mark moved
+    bool on_book_update(InstrumentId id, const TopOfBook& tob) noexcept;
+
+    // Recompute an OPTION_MODEL mark from the underlying's decimal mark;
+    // returns true if the mark moved
+    bool on_underlying_update(InstrumentId id, double underlying_mark,
+                              const OptionModel& model, Price price_scale) noexcept;
+
+    Price get(InstrumentId id) const noexcept {
+        return id < states_.size() ? states_[id].mark : 0;
+    }
+
+    MemoryUsage memory_usage() const noexcept { return memory::of(states_); }
+
+private:
+    struct MarkState {
+        Price mark;
+        double ema;
+        bool has_ema;
+        MarkConfig config;
+
+        MarkState() : mark(0), ema(0.0), has_ema(false) {}
+    };
+
+    std::vector<MarkState> states_;
+
+    bool store(MarkState& state, Price mark) noexcept;
+};
+
+}  // namespace mmg
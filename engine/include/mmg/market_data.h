@@ -0,0 +1,50 @@
+#pragma once
+
+#include "types.h"
+#include "memory_stats.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace mmg {
+
+struct MarketDataSubscription {
+    UserId client_id;
+    uint32_t depth;  // Levels per side the client wants
+    
+    MarketDataSubscription() : client_id(0), depth(0) {}
+    MarketDataSubscription(UserId client, uint32_t d) : client_id(client), depth(d) {}
+};
+
+// Who watches which book. Changed books are queued only for their
+// subscribers, so publishing work scales with interest rather than with
+// clients times instruments; books nobody watches cost one map lookup.
+class MarketDataPublisher {
+public:
+    // Subscribing again changes the depth
+    void subscribe(UserId client_id, InstrumentId id, uint32_t depth) noexcept;
+    bool unsubscribe(UserId client_id, InstrumentId id) noexcept;
+    void unsubscribe_all(UserId client_id) noexcept;
+    
+    // Sorted by client id; empty when nobody is subscribed
+    const std::vector<MarketDataSubscription>& subscribers(InstrumentId id) const noexcept;
+    std::vector<InstrumentId> subscriptions(UserId client_id) const noexcept;
+    
+    // Deepest depth any subscriber wants (0 without subscribers)
+    uint32_t max_depth(InstrumentId id) const noexcept;
+    
+    // A book changed; queue it for each of its subscribers
+    void on_book_changed(InstrumentId id) noexcept;
+    
+    // Books changed since the client's last call, in instrument order
+    std::vector<InstrumentId> take_updates(UserId client_id) noexcept;
+    
+    MemoryUsage memory_usage() const noexcept;
+    
+private:
+    std::map<InstrumentId, std::vector<MarketDataSubscription>> subscribers_;
+    std::map<UserId, std::set<InstrumentId>> subscriptions_;
+    std::map<UserId, std::set<InstrumentId>> pending_;
+};
+
+}  // namespace mmg
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "types.h"
+#include <random>
+
+namespace mmg {
+
+// Two-sided quote for the mass-quote path. A side with size 0 is not quoted.
+struct Quote {
+    InstrumentId instrument_id;
+    Price bid_price;
+    Quantity bid_size;
+    Price ask_price;
+    Quantity ask_size;
+    
+    Quote() : instrument_id(0), bid_price(0), bid_size(0), ask_price(0), ask_size(0) {}
+};
+
+struct MarketMakerConfig {
+    InstrumentId instrument_id;
+    UserId user_id;            // House account the quotes and inventory belong to
+    Price fair_value;          // Starting fair value
+    Price half_spread;         // Quoted either side of the reservation price
+    Quantity size;             // Per side
+    Quantity max_inventory;    // Stop adding to a side beyond this absolute position
+    double skew;               // Price units the reservation moves per unit of inventory
+    uint32_t fair_step_ticks;  // Fair value moves up to this many ticks per step (0 = fixed)
+    uint64_t seed;
+    
+    MarketMakerConfig()
+        : instrument_id(0), user_id(0), fair_value(0), half_spread(0), size(0),
+          max_inventory(0), skew(0.0), fair_step_ticks(0), seed(0) {}
+};
+
+// Liquidity provider for one instrument. Quotes are a pure function of the
+// fair value, inventory and tick size; the fair value's random walk draws
+// from a seeded mt19937_64 without library distributions, so a session
+// replays identically on every platform.
+class MarketMaker {
+public:
+    explicit MarketMaker(const MarketMakerConfig& config);
+    
+    // Reservation price fair - skew * inventory, bid snapped down and ask up
+    Quote quote(Quantity inventory, Price tick_size) const noexcept;
+    
+    // Advance the fair value one random-walk step on the tick grid
+    void step(Price tick_size) noexcept;
+    
+    Price fair_value() const noexcept { return fair_value_; }
+    const MarketMakerConfig& config() const noexcept { return config_; }
+    
+private:
+    MarketMakerConfig config_;
+    Price fair_value_;
+    std::mt19937_64 rng_;
+};
+
+}  // namespace mmg
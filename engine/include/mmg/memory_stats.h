@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace mmg {
+
+// Bytes held by one part of the engine. Vectors reserve ahead of use, so
+// reserved >= used; node containers allocate exactly what they use.
+struct MemoryUsage {
+    size_t used;
+    size_t reserved;
+    
+    MemoryUsage() : used(0), reserved(0) {}
+    MemoryUsage(size_t u, size_t r) : used(u), reserved(r) {}
+    
+    MemoryUsage& operator+=(const MemoryUsage& other) noexcept {
+        used += other.used;
+        reserved += other.reserved;
+        return *this;
+    }
+};
+
+// Container footprint estimates. Node sizes follow the usual libstdc++ and
+// libc++ layouts: red-black tree nodes carry three links plus a colour,
+// list nodes two links, make_shared one control block.
+namespace memory {
+
+constexpr size_t kTreeNodeOverhead = 4 * sizeof(void*);
+constexpr size_t kListNodeOverhead = 2 * sizeof(void*);
+constexpr size_t kSharedBlockOverhead = 2 * sizeof(void*);
+
+inline MemoryUsage bytes(size_t n) noexcept { return MemoryUsage(n, n); }
+
+template <typename T>
+MemoryUsage of(const std::vector<T>& v) noexcept {
+    return MemoryUsage(v.size() * sizeof(T), v.capacity() * sizeof(T));
+}
+
+template <typename K, typename V, typename C>
+MemoryUsage of(const std::map<K, V, C>& m) noexcept {
+    return bytes(m.size() * (sizeof(std::pair<const K, V>) + kTreeNodeOverhead));
+}
+
+template <typename K, typename C>
+MemoryUsage of(const std::set<K, C>& s) noexcept {
+    return bytes(s.size() * (sizeof(K) + kTreeNodeOverhead));
+}
+
+template <typename T>
+MemoryUsage of(const std::list<T>& l) noexcept {
+    return bytes(l.size() * (sizeof(T) + kListNodeOverhead));
+}
+
+}  // namespace memory
+
+}  // namespace mmg
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "types.h"
+#include "memory_stats.h"
+#include "l3_feed.h"
 #include <map>
 #include <list>
 #include <memory>
+#include <functional>
 #include <vector>
 
 namespace mmg {
@@ -29,9 +32,25 @@ struct Order {
 
 class OrderBook {
 public:
+    // Called with a level's new aggregate size (0 once the level is gone)
+    // each time matching, resting, cancelling or clearing changes it
+    using LevelListener = std::function<void(Side side, Price price, Quantity size)>;
+    
+    // Called for each order-level change (see L3EventType) while set
+    using OrderListener = std::function<void(L3EventType type, const Order& order,
+                                             Quantity quantity, uint32_t position)>;
+    
     OrderBook(InstrumentId instrument_id);
     
-    // Returns fills generated by matching
+    void set_level_listener(LevelListener listener) { listener_ = std::move(listener); }
+    void set_order_listener(OrderListener listener) { order_listener_ = std::move(listener); }
+    
+    // When set, an aggressor gets one fill per price level it takes (total
+    // quantity at that price) instead of one per resting order it hits
+    void set_aggregate_fills(bool aggregate) { aggregate_fills_ = aggregate; }
+    
+    // Returns fills generated by matching: each aggressor fill followed by
+    // the passive fills it matched
     std::vector<Fill> add_order(const std::shared_ptr<Order>& order) noexcept;
     
     bool cancel_order(OrderId order_id) noexcept;
@@ -39,29 +58,93 @@ public:
     // Get market snapshot (top N levels)
     MarketSnapshot get_snapshot(size_t depth = 10) const noexcept;
     
-    // Get best bid/ask
-    Price get_best_bid() const noexcept;
-    Price get_best_ask() const noexcept;
+    // Every resting order by level; seq is left for the caller
+    L3Snapshot get_l3_snapshot() const noexcept;
+    
+    // Best bid/ask (0 when that side is empty), cached so each is one load
+    Price get_best_bid() const noexcept { return top_.bid; }
+    Price get_best_ask() const noexcept { return top_.ask; }
     
     // Get last trade price
     Price get_last_price() const noexcept { return last_price_; }
     
+    // Best prices with their aggregate sizes
+    TopOfBook get_top_of_book() const noexcept {
+        TopOfBook tob = top_;
+        tob.last = last_price_;
+        return tob;
+    }
+    
+    // Price levels, queue nodes and the id index (orders themselves excluded)
+    MemoryUsage memory_usage() const noexcept;
+    
+    // Remove every resting order (marked CANCELLED) and return them
+    std::vector<std::shared_ptr<Order>> clear() noexcept;
+    
+    // Snap resting orders onto a new tick grid in one pass: bids round down,
+    // asks round up (so the book never crosses), and orders landing on the
+    // same level keep time priority. Returns the ids whose price changed.
+    // Level listeners are not told; consumers re-snapshot after a retick.
+    std::vector<OrderId> retick(Price tick_size) noexcept;
+    
+    // Resting quantity a taker on `side` could fill at `limit` or better,
+    // counting at most `max_qty`
+    Quantity available_quantity(Side side, Price limit, Quantity max_qty) const noexcept;
+    
+    // Oldest order at the best price on one side, nullptr if that side is empty
+    std::shared_ptr<Order> get_front_order(Side side) const noexcept;
+    
+    // Execute part of a resting order outside the normal match loop
+    // (e.g. against implied liquidity); removes it once fully filled
+    bool fill_resting(OrderId order_id, Quantity quantity, Price price) noexcept;
+    
 private:
+    // FIFO queue at one price with its remaining quantity kept alongside
+    struct Level {
+        Quantity size = 0;
+        std::list<std::shared_ptr<Order>> orders;
+    };
+    
     InstrumentId instrument_id_;
     Price last_price_;
+    LevelListener listener_;
+    OrderListener order_listener_;
+    TopOfBook top_;  // Best levels, refreshed whenever one may have changed; last unused
+    bool aggregate_fills_ = false;
     
-    // Price level -> list of orders (FIFO)
-    std::map<Price, std::list<std::shared_ptr<Order>>, std::greater<Price>> bids_;  // Descending
-    std::map<Price, std::list<std::shared_ptr<Order>>> asks_;  // Ascending
+    // Price level -> orders (FIFO)
+    std::map<Price, Level, std::greater<Price>> bids_;  // Descending
+    std::map<Price, Level> asks_;  // Ascending
     
     // Quick lookup by order ID
     std::map<OrderId, std::shared_ptr<Order>> orders_;
     
     std::vector<Fill> match_order(std::shared_ptr<Order>& order) noexcept;
     void add_to_book(const std::shared_ptr<Order>& order) noexcept;
-    Fill create_fill(const std::shared_ptr<Order>& aggressor, 
-                     const std::shared_ptr<Order>& passive,
-                     Price price, Quantity quantity) noexcept;
+    // Take `quantity` off the order's level, optionally dropping the order from it
+    void reduce_level(const std::shared_ptr<Order>& order, Quantity quantity,
+                      bool remove_order) noexcept;
+    // Reload one side's best level into top_; begin() is O(1) on std::map
+    void refresh_top(Side side) noexcept {
+        if (side == Side::BUY) {
+            top_.bid = bids_.empty() ? 0 : bids_.begin()->first;
+            top_.bid_size = bids_.empty() ? 0 : bids_.begin()->second.size;
+        } else {
+            top_.ask = asks_.empty() ? 0 : asks_.begin()->first;
+            top_.ask_size = asks_.empty() ? 0 : asks_.begin()->second.size;
+        }
+    }
+    void notify(Side side, Price price, Quantity size) const noexcept {
+        if (listener_) listener_(side, price, size);
+    }
+    void notify_order(L3EventType type, const Order& order, Quantity quantity,
+                      uint32_t position = 0) const noexcept {
+        if (order_listener_) order_listener_(type, order, quantity, position);
+    }
+    // `order`'s side of a match against `counterparty`
+    Fill create_fill(const std::shared_ptr<Order>& order,
+                     const std::shared_ptr<Order>& counterparty,
+                     Price price, Quantity quantity, bool aggressor) noexcept;
 };
 
 }  // namespace mmg
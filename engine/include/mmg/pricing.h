@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace mmg {
+namespace pricing {
+
+constexpr double kInvSqrt2Pi = 0.3989422804014327;
+constexpr double kInvSqrt2 = 0.7071067811865476;
+
+inline double norm_pdf(double x) noexcept {
+    return kInvSqrt2Pi * std::exp(-0.5 * x * x);
+}
+
+inline double norm_cdf(double x) noexcept {
+    return 0.5 * std::erfc(-x * kInvSqrt2);
+}
+
+// Black-Scholes option value; cp_sign is +1 for calls and -1 for puts.
+// Falls back to intrinsic value when there is no time or volatility left.
+inline double black_scholes(double cp_sign, double spot, double strike,
+                            double vol, double t, double rate) noexcept {
+    if (spot <= 0.0 || strike <= 0.0 || vol <= 0.0 || t <= 0.0) {
+        return std::max(0.0, cp_sign * (spot - strike));
+    }
+    double sqrt_t = std::sqrt(t);
+    double d1 = (std::log(spot / strike) + (rate + 0.5 * vol * vol) * t) / (vol * sqrt_t);
+    double d2 = d1 - vol * sqrt_t;
+    return cp_sign * (spot * norm_cdf(cp_sign * d1) -
+                      strike * std::exp(-rate * t) * norm_cdf(cp_sign * d2));
+}
+
+}  // namespace pricing
+}  // namespace mmg
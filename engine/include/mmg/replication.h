@@ -0,0 +1,94 @@
+#pragma once
+
+#include "engine.h"
+#include "memory_stats.h"
+#include <string>
+#include <vector>
+
+namespace mmg {
+
+// Hot standby over a local (Unix domain) socket. The primary's server keeps
+// the command frames and streams them to each connected replica, so a replica
+// attached before the log passes its limit catches up to the same state.
+// Past the limit, frames every connected replica has received are dropped; a
+// replica connecting later starts mid-stream and reports divergence.
+// Everything is non-blocking and driven by the owner calling flush()/poll().
+class ReplicationServer {
+public:
+    static constexpr size_t kDefaultLogLimit = size_t(64) << 20;
+    
+    explicit ReplicationServer(std::string path, size_t log_limit = kDefaultLogLimit) noexcept;
+    ~ReplicationServer();
+    ReplicationServer(const ReplicationServer&) = delete;
+    ReplicationServer& operator=(const ReplicationServer&) = delete;
+    
+    bool listening() const noexcept { return listen_fd_ >= 0; }
+    
+    // Route the engine's commands here; detached again on destruction
+    void attach(Engine& engine) noexcept;
+    
+    void publish(const uint8_t* frame, size_t size) noexcept;
+    
+    // Accept waiting replicas and send them whatever they have not had yet.
+    // A replica that errors or hangs up is dropped.
+    void flush() noexcept;
+    
+    size_t replicas() const noexcept { return replicas_.size(); }
+    size_t log_size() const noexcept { return log_.size(); }    // Bytes retained
+    size_t log_start() const noexcept { return log_start_; }    // Bytes dropped
+    MemoryUsage memory_usage() const noexcept { return memory::of(log_); }
+    
+private:
+    struct Replica {
+        int fd;
+        size_t sent;  // Bytes of log_ delivered
+    };
+    
+    void trim_log() noexcept;
+    
+    std::string path_;
+    size_t log_limit_;
+    size_t log_start_ = 0;
+    int listen_fd_ = -1;
+    Engine* engine_ = nullptr;
+    std::vector<uint8_t> log_;
+    std::vector<Replica> replicas_;
+};
+
+// Follows a primary into `engine`, which should be fresh. When poll()
+// returns false with !diverged() the primary is gone and the engine can take
+// over: it has applied every command the primary sent.
+class ReplicationClient {
+public:
+    ReplicationClient(Engine& engine, std::string path) noexcept;
+    ~ReplicationClient();
+    ReplicationClient(const ReplicationClient&) = delete;
+    ReplicationClient& operator=(const ReplicationClient&) = delete;
+    
+    bool connect() noexcept;
+    bool connected() const noexcept { return fd_ >= 0; }
+    
+    // Wait up to timeout_ms for data and apply every complete frame. False
+    // once the stream ends or a frame does not apply.
+    bool poll(int timeout_ms) noexcept;
+    
+    uint64_t applied() const noexcept { return applied_; }
+    bool diverged() const noexcept { return diverged_; }
+    
+    // ANNOTATE payloads applied since the last call, in order
+    std::vector<std::string> take_annotations() noexcept;
+    
+private:
+    bool apply_frames() noexcept;
+    void close_stream() noexcept;
+    
+    Engine& engine_;
+    std::string path_;
+    int fd_ = -1;
+    std::vector<uint8_t> buffer_;
+    uint64_t applied_ = 0;
+    bool diverged_ = false;
+    std::vector<std::string> annotations_;
+};
+
+}  // namespace mmg
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "types.h"
+#include "memory_stats.h"
+#include <map>
+#include <vector>
+
+namespace mmg {
+
+// Model inputs shared by every chain in a room
+struct RiskParams {
+    double volatility;                  // Annualized Black-Scholes volatility
+    double time_to_expiry;              // Years until option expiry
+    double rate;                        // Continuously compounded risk-free rate
+    std::vector<double> scenario_moves; // Relative underlying moves, e.g. -0.1 = down 10%
+
+    RiskParams()
+        : volatility(0.3), time_to_expiry(0.25), rate(0.0),
+          scenario_moves{-0.2, -0.1, -0.05, 0.0, 0.05, 0.1, 0.2} {}
+};
+
+// Greeks and scenario PnL for all positions referencing one underlying scalar
+struct UnderlyingRisk {
+    InstrumentId underlying_id;
+    double spot;                        // Underlying mark (decimal), 0 if unknown
+    double delta;                       // Underlying-equivalent units
+    double gamma;
+    double vega;                        // Per 1.00 change in volatility
+    double theta;                       // Per year
+    std::vector<double> scenario_spots;
+    std::vector<double> scenario_pnl;   // Settlement PnL if the underlying settles at each spot
+
+    UnderlyingRisk()
+        : underlying_id(0), spot(0.0), delta(0.0), gamma(0.0), vega(0.0), theta(0.0) {}
+};
+
+struct RiskReport {
+    UserId user_id;  // 0 for a room-wide report
+    std::vector<UnderlyingRisk> underlyings;
+
+    RiskReport() : user_id(0) {}
+};
+
+// Portfolio risk across option chains, updated incrementally on fills.
+// Each user's chain positions are kept in structure-of-arrays form so the
+// scenario grid is evaluated with branch-free loops the compiler vectorizes.
+class RiskEngine {
+public:
+    void set_params(const RiskParams& params) noexcept { params_ = params; }
+    const RiskParams& get_params() const noexcept { return params_; }
+
+    // Apply a fill: signed_qty > 0 for buys, price in decimal units
+    void on_fill(UserId user_id, const InstrumentSpec& inst,
+                 Quantity signed_qty, double price) noexcept;
+
+    // Convert every open position in an instrument to cash at its payoff
+    void on_settle(const InstrumentSpec& inst, double settlement_value) noexcept;
+
+    // spots: underlying id -> decimal mark price
+    RiskReport evaluate_user(UserId user_id,
+                             const std::map<InstrumentId, double>& spots) const noexcept;
+    RiskReport evaluate_room(const std::map<InstrumentId, double>& spots) const noexcept;
+
+    // Underlyings referenced by any tracked position
+    std::vector<InstrumentId> get_underlyings() const noexcept;
+
+    // Slot arrays grow by doubling, so reserved tracks their capacity
+    MemoryUsage memory_usage() const noexcept;
+
+private:
+    // Structure-of-arrays slot storage, one slot per instrument held
+    struct ChainPositions {
+        std::vector<InstrumentId> instrument_id;
+        std::vector<InstrumentId> underlying_id;
+        std::vector<double> strike;      // Decimal strike, 0 for scalars
+        std::vector<double> cp_sign;     // +1 call, -1 put, 0 scalar
+        std::vector<double> linear;      // 1 for scalars, 0 for options
+        std::vector<double> multiplier;  // tick_value
+        std::vector<double> qty;         // Net signed quantity
+        std::vector<double> cash;        // Cash flow from fills and settlement
+        std::map<InstrumentId, size_t> slot_of;
+
+        size_t slot(const InstrumentSpec& inst) noexcept;
+    };
+
+    RiskParams params_;
+    std::map<UserId, ChainPositions> users_;
+
+    void accumulate(const ChainPositions& chain,
+                    const std::map<InstrumentId, double>& spots,
+                    RiskReport& report) const noexcept;
+};
+
+}  // namespace mmg
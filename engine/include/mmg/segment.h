@@ -0,0 +1,42 @@
+#pragma once
+
+#include "types.h"
+#include "journal.h"
+#include <vector>
+
+namespace mmg {
+
+// Compact columnar segments for the fill history and the book journal.
+//
+// A segment is a small header followed by one length-prefixed column per
+// field. Timestamps, ids, seqs and prices are delta coded, users and
+// instruments are dictionary coded, sides are bit packed, and every integer
+// is a varint. The column block can then be LZ compressed as a whole.
+namespace segment {
+
+enum class Compression : uint8_t {
+    NONE = 0,
+    LZ = 1   // In-tree LZ77, 64KB window, LZ4-style sequences
+};
+
+enum class Kind : uint8_t {
+    FILLS = 1,
+    JOURNAL = 2
+};
+
+std::vector<uint8_t> encode_fills(const std::vector<Fill>& fills,
+                                  Compression compression = Compression::LZ) noexcept;
+std::vector<uint8_t> encode_journal(const std::vector<JournalRecord>& records,
+                                    Compression compression = Compression::LZ) noexcept;
+
+// False, with `out` left empty, on truncated or malformed input or the wrong kind
+bool decode_fills(const uint8_t* data, size_t size, std::vector<Fill>& out) noexcept;
+bool decode_journal(const uint8_t* data, size_t size, std::vector<JournalRecord>& out) noexcept;
+
+// The block compressor on its own; decompression needs the original size
+std::vector<uint8_t> lz_compress(const uint8_t* data, size_t size) noexcept;
+bool lz_decompress(const uint8_t* data, size_t size, size_t raw_size,
+                   std::vector<uint8_t>& out) noexcept;
+
+}  // namespace segment
+}  // namespace mmg
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include <chrono>
 
 namespace mmg {
@@ -9,9 +11,9 @@ namespace mmg {
 using UserId = uint32_t;
 using InstrumentId = uint32_t;
 using OrderId = uint64_t;
-using Price = int64_t;  // Fixed-point representation (e.g., cents)
+using Price = int64_t;  // Fixed-point representation, scaled per instrument
 using Quantity = int64_t;
-using Timestamp = std::chrono::steady_clock::time_point;
+using Timestamp = std::chrono::system_clock::time_point;  // Wall clock, kept monotonic by the engine
 
 enum class Side : uint8_t {
     BUY = 0,
@@ -26,7 +28,8 @@ enum class TimeInForce : uint8_t {
 enum class InstrumentType : uint8_t {
     SCALAR = 0,
     CALL = 1,
-    PUT = 2
+    PUT = 2,
+    COMBO = 3   // Spread of other instruments, see InstrumentSpec::legs
 };
 
 enum class OrderStatus : uint8_t {
@@ -37,6 +40,16 @@ enum class OrderStatus : uint8_t {
     REJECTED = 4
 };
 
+// One leg of a combo: buying one combo trades `ratio` units of the leg
+// (sells when ratio is negative)
+struct ComboLeg {
+    InstrumentId instrument_id;
+    int32_t ratio;
+    
+    ComboLeg() : instrument_id(0), ratio(1) {}
+    ComboLeg(InstrumentId id, int32_t r) : instrument_id(id), ratio(r) {}
+};
+
 struct InstrumentSpec {
     InstrumentId id;
     std::string symbol;
@@ -47,10 +60,19 @@ struct InstrumentSpec {
     Quantity lot_size;
     double tick_value;
     bool is_halted;
+    uint8_t price_decimals;    // Decimal places carried by fixed-point prices
+    Price price_scale;         // 10^price_decimals, resolved by Engine::add_instrument
+    std::vector<ComboLeg> legs;  // For combos only; combo price = sum(ratio * leg price)
     
     InstrumentSpec()
         : id(0), type(InstrumentType::SCALAR), reference_id(0), 
-          strike(0), tick_size(1), lot_size(1), tick_value(1.0), is_halted(false) {}
+          strike(0), tick_size(1), lot_size(1), tick_value(1.0), is_halted(false),
+          price_decimals(2), price_scale(100) {}
+    
+    // Convert a fixed-point price to its decimal value
+    double to_decimal(Price price) const noexcept {
+        return static_cast<double>(price) / static_cast<double>(price_scale);
+    }
 };
 
 struct OrderRequest {
@@ -67,19 +89,37 @@ struct OrderRequest {
           price(0), quantity(0), tif(TimeInForce::GFD), post_only(false) {}
 };
 
+// Nanoseconds since the Unix epoch, as history records store time
+inline int64_t to_nanos(Timestamp t) noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+inline Timestamp from_nanos(int64_t ns) noexcept {
+    return Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds(ns)));
+}
+
+// Fixed-size record without implicit padding, so fill history can be copied
+// to disk or the wire as raw bytes
 struct Fill {
+    uint64_t seq;          // Event sequence number of the fill, set by the engine
+    int64_t timestamp_ns;  // Nanoseconds since the Unix epoch
     OrderId order_id;
+    Price price;
+    Quantity quantity;
     UserId user_id;
     InstrumentId instrument_id;
     Side side;
-    Price price;
-    Quantity quantity;
-    Timestamp timestamp;
+    bool aggressor;        // Taking side of the match
+    uint8_t reserved[6];   // Always zero
     
-    Fill() : order_id(0), user_id(0), instrument_id(0), 
-             side(Side::BUY), price(0), quantity(0) {}
+    Fill() : seq(0), timestamp_ns(0), order_id(0), price(0), quantity(0),
+             user_id(0), instrument_id(0), side(Side::BUY), aggressor(false), reserved() {}
 };
 
+static_assert(sizeof(Fill) == 56, "Fill has implicit padding");
+static_assert(std::is_trivially_copyable_v<Fill> && std::is_standard_layout_v<Fill>,
+              "Fill must stay memcpy-able");
+
 struct Position {
     InstrumentId instrument_id;
     Quantity net_qty;
@@ -91,6 +131,20 @@ struct Position {
                  realized_pnl(0.0), unrealized_pnl(0.0) {}
 };
 
+// Largest decimals whose scale still fits in a Price
+constexpr uint8_t kMaxPriceDecimals = 18;
+
+// Nearest multiple of tick at or below (or at or above) price; prices may be negative
+inline Price snap_to_tick(Price price, Price tick, bool round_up) noexcept {
+    Price steps = price / tick;
+    Price remainder = price % tick;
+    if (remainder != 0) {
+        if (remainder < 0) --steps;  // Floor for negative prices
+        if (round_up) ++steps;
+    }
+    return steps * tick;
+}
+
 struct PriceLevel {
     Price price;
     Quantity size;
@@ -99,14 +153,25 @@ struct PriceLevel {
     PriceLevel(Price p, Quantity s) : price(p), size(s) {}
 };
 
+struct TopOfBook {
+    Price bid;           // 0 if no bids
+    Quantity bid_size;
+    Price ask;           // 0 if no asks
+    Quantity ask_size;
+    Price last;          // 0 if never traded
+    
+    TopOfBook() : bid(0), bid_size(0), ask(0), ask_size(0), last(0) {}
+};
+
 struct MarketSnapshot {
     InstrumentId instrument_id;
     std::vector<PriceLevel> bids;
     std::vector<PriceLevel> asks;
     Price last_price;
     Timestamp timestamp;
+    uint64_t seq;  // Engine event seq the book reflects; apply LEVEL_UPDATEs after it
     
-    MarketSnapshot() : instrument_id(0), last_price(0) {}
+    MarketSnapshot() : instrument_id(0), last_price(0), seq(0) {}
 };
 
 }  // namespace mmg
@@ -0,0 +1,387 @@
+#include "mmg/command_log.h"
+
+namespace mmg {
+
+void CommandWriter::put(const std::string& s) noexcept {
+    put(static_cast<uint32_t>(s.size()));
+    out_.insert(out_.end(), s.begin(), s.end());
+}
+
+void CommandWriter::put(const ComboLeg& leg) noexcept {
+    put(leg.instrument_id);
+    put(leg.ratio);
+}
+
+void CommandWriter::put(const OrderRequest& request) noexcept {
+    put(request.user_id);
+    put(request.instrument_id);
+    put(request.side);
+    put(request.price);
+    put(request.quantity);
+    put(request.tif);
+    put(request.post_only);
+}
+
+void CommandWriter::put(const Quote& quote) noexcept {
+    put(quote.instrument_id);
+    put(quote.bid_price);
+    put(quote.bid_size);
+    put(quote.ask_price);
+    put(quote.ask_size);
+}
+
+void CommandWriter::put(const InstrumentSpec& spec) noexcept {
+    put(spec.id);
+    put(spec.symbol);
+    put(spec.type);
+    put(spec.reference_id);
+    put(spec.strike);
+    put(spec.tick_size);
+    put(spec.lot_size);
+    put(spec.tick_value);
+    put(spec.is_halted);
+    put(spec.price_decimals);
+    put(spec.price_scale);
+    put(spec.legs);
+}
+
+void CommandWriter::put(const MarketMakerConfig& config) noexcept {
+    put(config.instrument_id);
+    put(config.user_id);
+    put(config.fair_value);
+    put(config.half_spread);
+    put(config.size);
+    put(config.max_inventory);
+    put(config.skew);
+    put(config.fair_step_ticks);
+    put(config.seed);
+}
+
+void CommandWriter::put(const AdminAction& action) noexcept {
+    put(action.type);
+    put(action.instrument_id);
+    put(action.value);
+    put(action.tick_policy);
+}
+
+void CommandWriter::put(const RiskLimits& limits) noexcept {
+    put(limits.max_position);
+    put(limits.max_notional);
+    put(limits.max_orders_per_sec);
+}
+
+void CommandWriter::put(const MarkConfig& config) noexcept {
+    put(config.method);
+    put(config.ema_alpha);
+}
+
+void CommandWriter::put(const RiskParams& params) noexcept {
+    put(params.volatility);
+    put(params.time_to_expiry);
+    put(params.rate);
+    put(params.scenario_moves);
+}
+
+void CommandReader::get(bool& value) noexcept {
+    uint8_t byte = 0;
+    get(byte);
+    value = byte != 0;
+}
+
+void CommandReader::get(std::string& s) noexcept {
+    uint32_t size = 0;
+    get(size);
+    if (!ok_ || size > static_cast<size_t>(end_ - p_)) {
+        ok_ = false;
+        return;
+    }
+    s.assign(reinterpret_cast<const char*>(p_), size);
+    p_ += size;
+}
+
+void CommandReader::get(ComboLeg& leg) noexcept {
+    get(leg.instrument_id);
+    get(leg.ratio);
+}
+
+void CommandReader::get(OrderRequest& request) noexcept {
+    get(request.user_id);
+    get(request.instrument_id);
+    get(request.side);
+    get(request.price);
+    get(request.quantity);
+    get(request.tif);
+    get(request.post_only);
+}
+
+void CommandReader::get(Quote& quote) noexcept {
+    get(quote.instrument_id);
+    get(quote.bid_price);
+    get(quote.bid_size);
+    get(quote.ask_price);
+    get(quote.ask_size);
+}
+
+void CommandReader::get(InstrumentSpec& spec) noexcept {
+    get(spec.id);
+    get(spec.symbol);
+    get(spec.type);
+    get(spec.reference_id);
+    get(spec.strike);
+    get(spec.tick_size);
+    get(spec.lot_size);
+    get(spec.tick_value);
+    get(spec.is_halted);
+    get(spec.price_decimals);
+    get(spec.price_scale);
+    get(spec.legs);
+}
+
+void CommandReader::get(MarketMakerConfig& config) noexcept {
+    get(config.instrument_id);
+    get(config.user_id);
+    get(config.fair_value);
+    get(config.half_spread);
+    get(config.size);
+    get(config.max_inventory);
+    get(config.skew);
+    get(config.fair_step_ticks);
+    get(config.seed);
+}
+
+void CommandReader::get(AdminAction& action) noexcept {
+    get(action.type);
+    get(action.instrument_id);
+    get(action.value);
+    get(action.tick_policy);
+}
+
+void CommandReader::get(RiskLimits& limits) noexcept {
+    get(limits.max_position);
+    get(limits.max_notional);
+    get(limits.max_orders_per_sec);
+}
+
+void CommandReader::get(MarkConfig& config) noexcept {
+    get(config.method);
+    get(config.ema_alpha);
+}
+
+void CommandReader::get(RiskParams& params) noexcept {
+    get(params.volatility);
+    get(params.time_to_expiry);
+    get(params.rate);
+    get(params.scenario_moves);
+}
+
+void Engine::annotate(const std::string& data) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::ANNOTATE, data);
+}
+
+bool Engine::apply_command(const uint8_t* frame, size_t size) noexcept {
+    CommandReader in(frame, size);
+    uint32_t body = 0;
+    uint64_t number = 0;
+    int64_t nanos = 0;
+    CommandType type{};
+    in.get(body);
+    in.get(number);
+    in.get(nanos);
+    in.get(type);
+    
+    // Frames apply strictly in order, one at a time
+    if (!in.ok() || body != size - sizeof(body) || number != commands_ + 1 || command_depth_ != 0) {
+        return false;
+    }
+    
+    clock_ = Timestamp(std::chrono::duration_cast<Timestamp::duration>(
+        std::chrono::nanoseconds(nanos)));
+    clock_pinned_ = true;
+    bool applied = dispatch_command(type, in);
+    clock_pinned_ = false;
+    return applied;
+}
+
+// Decodes every argument before calling, so a malformed frame changes nothing.
+// A command that fails validation still applies: it failed on the primary too.
+bool Engine::dispatch_command(CommandType type, CommandReader& in) noexcept {
+    switch (type) {
+        case CommandType::ADD_INSTRUMENT: {
+            InstrumentSpec spec;
+            in.get(spec);
+            if (!in.done()) return false;
+            add_instrument(spec);
+            return true;
+        }
+        case CommandType::HALT_INSTRUMENT: {
+            InstrumentId id = 0;
+            bool halted = false, cancel_orders = false;
+            in.get(id);
+            in.get(halted);
+            in.get(cancel_orders);
+            if (!in.done()) return false;
+            halt_instrument(id, halted, cancel_orders);
+            return true;
+        }
+        case CommandType::SET_TICK_SIZE: {
+            InstrumentId id = 0;
+            Price tick_size = 0;
+            TickPolicy policy{};
+            in.get(id);
+            in.get(tick_size);
+            in.get(policy);
+            if (!in.done()) return false;
+            set_tick_size(id, tick_size, policy);
+            return true;
+        }
+        case CommandType::SUBMIT_ORDER: {
+            OrderRequest request;
+            in.get(request);
+            if (!in.done()) return false;
+            submit_order(request);
+            return true;
+        }
+        case CommandType::SUBMIT_PACKAGE: {
+            std::vector<OrderRequest> legs;
+            in.get(legs);
+            if (!in.done()) return false;
+            submit_package(legs);
+            return true;
+        }
+        case CommandType::MASS_QUOTE: {
+            UserId user_id = 0;
+            std::vector<Quote> quotes;
+            in.get(user_id);
+            in.get(quotes);
+            if (!in.done()) return false;
+            mass_quote(user_id, quotes);
+            return true;
+        }
+        case CommandType::ENABLE_MARKET_MAKER: {
+            MarketMakerConfig config;
+            in.get(config);
+            if (!in.done()) return false;
+            enable_market_maker(config);
+            return true;
+        }
+        case CommandType::DISABLE_MARKET_MAKER: {
+            InstrumentId id = 0;
+            in.get(id);
+            if (!in.done()) return false;
+            disable_market_maker(id);
+            return true;
+        }
+        case CommandType::STEP_MARKET_MAKERS: {
+            if (!in.done()) return false;
+            step_market_makers();
+            return true;
+        }
+        case CommandType::CANCEL_ORDER: {
+            OrderId order_id = 0;
+            UserId user_id = 0;
+            in.get(order_id);
+            in.get(user_id);
+            if (!in.done()) return false;
+            cancel_order(order_id, user_id);
+            return true;
+        }
+        case CommandType::REPLACE_ORDER: {
+            OrderId order_id = 0;
+            UserId user_id = 0;
+            bool has_price = false, has_qty = false;
+            Price price = 0;
+            Quantity qty = 0;
+            in.get(order_id);
+            in.get(user_id);
+            in.get(has_price);
+            in.get(price);
+            in.get(has_qty);
+            in.get(qty);
+            if (!in.done()) return false;
+            replace_order(order_id, user_id, has_price ? &price : nullptr, has_qty ? &qty : nullptr);
+            return true;
+        }
+        case CommandType::CANCEL_ALL: {
+            UserId user_id = 0;
+            in.get(user_id);
+            if (!in.done()) return false;
+            cancel_all(user_id);
+            return true;
+        }
+        case CommandType::SET_CANCEL_ON_DISCONNECT: {
+            UserId user_id = 0;
+            bool enabled = false;
+            in.get(user_id);
+            in.get(enabled);
+            if (!in.done()) return false;
+            set_cancel_on_disconnect(user_id, enabled);
+            return true;
+        }
+        case CommandType::USER_DISCONNECTED: {
+            UserId user_id = 0;
+            in.get(user_id);
+            if (!in.done()) return false;
+            user_disconnected(user_id);
+            return true;
+        }
+        case CommandType::SETTLE_INSTRUMENT: {
+            InstrumentId id = 0;
+            Price value = 0;
+            in.get(id);
+            in.get(value);
+            if (!in.done()) return false;
+            settle_instrument(id, value);
+            return true;
+        }
+        case CommandType::ADMIN_BATCH: {
+            std::vector<AdminAction> actions;
+            in.get(actions);
+            if (!in.done()) return false;
+            apply_admin_batch(actions);
+            return true;
+        }
+        case CommandType::SET_RISK_LIMITS: {
+            UserId user_id = 0;
+            RiskLimits limits;
+            in.get(user_id);
+            in.get(limits);
+            if (!in.done()) return false;
+            set_risk_limits(user_id, limits);
+            return true;
+        }
+        case CommandType::SET_MARK_CONFIG: {
+            InstrumentId id = 0;
+            MarkConfig config;
+            in.get(id);
+            in.get(config);
+            if (!in.done()) return false;
+            set_mark_config(id, config);
+            return true;
+        }
+        case CommandType::SET_RISK_PARAMS: {
+            RiskParams params;
+            in.get(params);
+            if (!in.done()) return false;
+            set_risk_params(params);
+            return true;
+        }
+        case CommandType::ANNOTATE: {
+            std::string data;
+            in.get(data);
+            if (!in.done()) return false;
+            annotate(data);
+            return true;
+        }
+        case CommandType::SET_AGGREGATE_FILLS: {
+            bool enabled = false;
+            in.get(enabled);
+            if (!in.done()) return false;
+            set_aggregate_fills(enabled);
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace mmg
@@ -1,72 +1,529 @@
 #include "mmg/engine.h"
+#include "mmg/command_log.h"
 #include <cmath>
+#include <cstdlib>
 #include <algorithm>
 
 namespace mmg {
 
-Engine::Engine() : next_order_id_(1) {
+namespace {
+
+EngineEvent fill_event(const Fill& fill) {
+    EngineEvent event(EngineEventType::FILL, fill.instrument_id);
+    event.user_id = fill.user_id;
+    event.order_id = fill.order_id;
+    event.side = fill.side;
+    event.price = fill.price;
+    event.quantity = fill.quantity;
+    return event;
+}
+
+Engine::TradeRecord trade_record(const Fill& taker, const Fill& passive) {
+    Engine::TradeRecord trade;
+    trade.seq = passive.seq;
+    trade.instrument_id = passive.instrument_id;
+    trade.price = passive.price;
+    trade.quantity = passive.quantity;
+    trade.timestamp_ns = passive.timestamp_ns;
+    trade.aggressor_side = taker.side;
+    
+    if (taker.side == Side::BUY) {
+        trade.buy_order_id = taker.order_id;
+        trade.buyer_id = taker.user_id;
+        trade.sell_order_id = passive.order_id;
+        trade.seller_id = passive.user_id;
+    } else {
+        trade.sell_order_id = taker.order_id;
+        trade.seller_id = taker.user_id;
+        trade.buy_order_id = passive.order_id;
+        trade.buyer_id = passive.user_id;
+    }
+    return trade;
+}
+
+}  // namespace
+
+Engine::Engine(size_t retransmit_capacity)
+    : next_order_id_(1), events_(retransmit_capacity) {
     stats_ = {};
 }
 
 Engine::~Engine() = default;
 
 bool Engine::add_instrument(const InstrumentSpec& spec) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::ADD_INSTRUMENT, spec);
+    
     if (instruments_.find(spec.id) != instruments_.end()) {
         return false;  // Already exists
     }
     
-    instruments_[spec.id] = spec;
-    order_books_[spec.id] = std::make_unique<OrderBook>(spec.id);
+    if (spec.price_decimals > kMaxPriceDecimals) {
+        return false;  // Scale would overflow a Price
+    }
+    
+    if (spec.tick_size <= 0) {
+        return false;  // Prices are checked and snapped modulo the tick
+    }
+    
+    if (spec.type == InstrumentType::COMBO) {
+        // Legs must be distinct existing outrights priced on the combo's scale
+        if (spec.legs.size() < 2) return false;
+        std::set<InstrumentId> seen;
+        for (const auto& leg : spec.legs) {
+            auto leg_it = instruments_.find(leg.instrument_id);
+            if (leg_it == instruments_.end() || leg_it->second.type == InstrumentType::COMBO ||
+                leg.ratio == 0 || leg_it->second.price_decimals != spec.price_decimals ||
+                !seen.insert(leg.instrument_id).second) {
+                return false;
+            }
+        }
+    }
+    
+    // Resolve the fixed-point scale once so PnL and settlement never recompute it
+    InstrumentSpec resolved = spec;
+    resolved.price_scale = 1;
+    for (uint8_t i = 0; i < resolved.price_decimals; ++i) {
+        resolved.price_scale *= 10;
+    }
+    
+    instruments_[spec.id] = resolved;
+    auto book = std::make_unique<OrderBook>(spec.id);
+    book->set_level_listener([this, id = spec.id](Side side, Price price, Quantity size) {
+        EngineEvent event(EngineEventType::LEVEL_UPDATE, id);
+        event.side = side;
+        event.price = price;
+        event.quantity = size;
+        uint64_t seq = events_.append(std::move(event));
+        journal_.record(seq, clock_, {id, side, price, size});
+    });
+    book->set_aggregate_fills(aggregate_fills_);
+    order_books_[spec.id] = std::move(book);
+    marks_.add_instrument(spec.id);
+    if (spec.type == InstrumentType::CALL || spec.type == InstrumentType::PUT) {
+        options_by_underlying_[spec.reference_id].push_back(spec.id);
+    } else if (spec.type == InstrumentType::COMBO) {
+        implied_.add_combo(resolved);
+    }
     return true;
 }
 
-bool Engine::halt_instrument(InstrumentId id, bool halted) noexcept {
+bool Engine::halt_instrument(InstrumentId id, bool halted, bool cancel_orders) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::HALT_INSTRUMENT, id, halted, cancel_orders);
+    
     auto it = instruments_.find(id);
     if (it == instruments_.end()) return false;
     
-    it->second.is_halted = halted;
+    set_halted(it->second, halted);
+    if (halted && cancel_orders) {
+        std::vector<OrderId> cancelled;
+        pull_quotes(id, cancelled);
+        flush_implied();
+    }
     return true;
 }
 
+void Engine::set_halted(InstrumentSpec& inst, bool halted) noexcept {
+    inst.is_halted = halted;
+    EngineEvent event(EngineEventType::INSTRUMENT_HALTED, inst.id);
+    event.value = halted ? 1 : 0;
+    events_.append(std::move(event));
+}
+
+void Engine::set_cancel_on_disconnect(UserId user_id, bool enabled) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SET_CANCEL_ON_DISCONNECT, user_id, enabled);
+    
+    if (enabled) {
+        cancel_on_disconnect_.insert(user_id);
+    } else {
+        cancel_on_disconnect_.erase(user_id);
+    }
+}
+
+void Engine::set_aggregate_fills(bool enabled) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SET_AGGREGATE_FILLS, enabled);
+    
+    aggregate_fills_ = enabled;
+    for (auto& [id, book] : order_books_) book->set_aggregate_fills(enabled);
+}
+
+std::vector<OrderId> Engine::user_disconnected(UserId user_id) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::USER_DISCONNECTED, user_id);
+    
+    std::vector<OrderId> cancelled;
+    auto it = user_orders_.find(user_id);
+    if (!cancel_on_disconnect_.count(user_id) || it == user_orders_.end()) return cancelled;
+    
+    // One pass over the user's own orders, one event per instrument touched
+    std::map<InstrumentId, EngineEvent> events;
+    for (const auto& [order_id, order] : it->second) {
+        auto order_it = active_orders_.find(order_id);
+        if (order_it == active_orders_.end()) continue;
+        
+        InstrumentId inst_id = order_it->second->instrument_id;
+        if (!order_books_[inst_id]->cancel_order(order_id)) continue;
+        active_orders_.erase(order_it);
+        cancelled.push_back(order_id);
+        
+        auto event_it = events.find(inst_id);
+        if (event_it == events.end()) {
+            event_it = events.emplace(inst_id, EngineEvent(EngineEventType::ORDERS_CANCELLED, inst_id)).first;
+            event_it->second.user_id = user_id;
+        }
+        event_it->second.order_ids.push_back(order_id);
+    }
+    user_orders_.erase(it);
+    stats_.total_cancels += cancelled.size();
+    
+    for (auto& [inst_id, event] : events) {
+        on_book_changed(inst_id);
+        events_.append(std::move(event));
+    }
+    flush_implied();
+    return cancelled;
+}
+
 InstrumentSpec* Engine::get_instrument(InstrumentId id) noexcept {
     auto it = instruments_.find(id);
     if (it == instruments_.end()) return nullptr;
     return &it->second;
 }
 
+bool Engine::set_tick_size(InstrumentId id, Price tick_size, TickPolicy policy) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SET_TICK_SIZE, id, tick_size, policy);
+    
+    if (instruments_.find(id) == instruments_.end() || tick_size <= 0) return false;
+    
+    std::vector<OrderId> cancelled;
+    apply_tick_size(id, tick_size, policy, cancelled);
+    return true;
+}
+
+void Engine::apply_tick_size(InstrumentId id, Price tick_size, TickPolicy policy,
+                             std::vector<OrderId>& cancelled) noexcept {
+    EngineEvent reset(EngineEventType::BOOK_RESET, id);
+    reset.value = tick_size;
+    
+    if (policy == TickPolicy::CANCEL) {
+        pull_quotes(id, cancelled);
+    } else {
+        reset.order_ids = order_books_[id]->retick(tick_size);
+    }
+    
+    instruments_[id].tick_size = tick_size;
+    on_book_changed(id);
+    flush_implied();  // Repricing only widens the book, so nothing crosses
+    uint64_t seq = events_.append(std::move(reset));
+    journal_.reset_book(seq, clock_, order_books_[id]->get_snapshot(SIZE_MAX));
+}
+
+void Engine::forget_orders(const std::vector<std::shared_ptr<Order>>& orders) noexcept {
+    for (const auto& order : orders) {
+        active_orders_.erase(order->id);
+        auto user_it = user_orders_.find(order->user_id);
+        if (user_it != user_orders_.end()) {
+            user_it->second.erase(order->id);
+            if (user_it->second.empty()) user_orders_.erase(user_it);
+        }
+    }
+    stats_.total_cancels += orders.size();
+}
+
 Engine::OrderResult Engine::submit_order(const OrderRequest& request) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SUBMIT_ORDER, request);
+    
     OrderResult result;
     result.order_id = 0;
     result.success = false;
     
-    // Validate instrument
-    auto inst_it = instruments_.find(request.instrument_id);
-    if (inst_it == instruments_.end()) {
-        result.error_message = "Instrument not found";
+    if (!validate_order(request, result.error_message)) {
         stats_.total_rejects++;
         return result;
     }
     
-    if (inst_it->second.is_halted) {
-        result.error_message = "Instrument is halted";
+    result.order_id = execute_order(request, result.fills, &result.seq);
+    
+    // Leg books may now cross resting combo orders
+    auto implied_fills = flush_implied();
+    result.fills.insert(result.fills.end(), implied_fills.begin(), implied_fills.end());
+    requote_market_makers(result.fills);
+    
+    result.success = true;
+    stats_.total_orders++;
+    return result;
+}
+
+Engine::PackageResult Engine::submit_package(const std::vector<OrderRequest>& legs) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SUBMIT_PACKAGE, legs);
+    
+    PackageResult result;
+    auto reject = [&](const char* message) {
+        result.error_message = message;
         stats_.total_rejects++;
         return result;
+    };
+    
+    if (legs.empty()) return reject("Empty package");
+    
+    // Validate every leg before anything executes
+    std::set<InstrumentId> seen;
+    double notional = 0.0;
+    for (const auto& leg : legs) {
+        if (leg.user_id != legs.front().user_id) return reject("Package legs must share a user");
+        if (leg.tif != legs.front().tif) return reject("Package legs must share a time in force");
+        if (!seen.insert(leg.instrument_id).second) return reject("Duplicate instrument in package");
+        if (!validate_order(leg, result.error_message)) {
+            stats_.total_rejects++;
+            return result;
+        }
+        const auto& inst = instruments_.find(leg.instrument_id)->second;
+        if (inst.type == InstrumentType::COMBO) return reject("Combos cannot be package legs");
+        notional += std::abs(inst.to_decimal(leg.price)) * leg.quantity;
+    }
+    
+    // Legs are distinct instruments, so the per-leg position checks above
+    // already see the combined position; notional is checked across legs
+    auto limits_it = risk_limits_.find(legs.front().user_id);
+    if (limits_it != risk_limits_.end() && notional > limits_it->second.max_notional) {
+        return reject("Risk limit exceeded");
+    }
+    
+    // IOC packages are all-or-none: every leg must fill in full right now
+    if (legs.front().tif == TimeInForce::IOC) {
+        for (const auto& leg : legs) {
+            const auto& book = order_books_[leg.instrument_id];
+            if (book->available_quantity(leg.side, leg.price, leg.quantity) < leg.quantity) {
+                return reject("Package cannot be filled in full");
+            }
+        }
     }
     
-    // Check risk limits
-    if (!check_risk(request.user_id, request.instrument_id, request.side, request.quantity)) {
-        result.error_message = "Risk limit exceeded";
+    // Execute all legs in one step; implied matching waits until every leg is in
+    for (const auto& leg : legs) {
+        uint64_t seq = 0;
+        result.order_ids.push_back(execute_order(leg, result.fills, &seq));
+        result.seqs.push_back(seq);
+    }
+    auto implied_fills = flush_implied();
+    result.fills.insert(result.fills.end(), implied_fills.begin(), implied_fills.end());
+    requote_market_makers(result.fills);
+    
+    result.success = true;
+    stats_.total_orders += legs.size();
+    return result;
+}
+
+Engine::MassQuoteResult Engine::mass_quote(UserId user_id, const std::vector<Quote>& quotes) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::MASS_QUOTE, user_id, quotes);
+    
+    MassQuoteResult result;
+    auto reject = [&](const char* message) {
+        result.error_message = message;
         stats_.total_rejects++;
         return result;
+    };
+    
+    // Validate every quote before touching the books
+    std::set<InstrumentId> seen;
+    for (const auto& quote : quotes) {
+        auto inst_it = instruments_.find(quote.instrument_id);
+        if (inst_it == instruments_.end()) return reject("Instrument not found");
+        const auto& inst = inst_it->second;
+        if (inst.is_halted) return reject("Instrument is halted");
+        if (inst.type == InstrumentType::COMBO) return reject("Combos cannot be mass quoted");
+        if (!seen.insert(quote.instrument_id).second) return reject("Duplicate instrument in mass quote");
+        if (quote.bid_size < 0 || quote.ask_size < 0) return reject("Invalid quantity");
+        if ((quote.bid_size > 0 && quote.bid_price % inst.tick_size != 0) ||
+            (quote.ask_size > 0 && quote.ask_price % inst.tick_size != 0)) {
+            return reject("Price not on tick grid");
+        }
+        if (quote.bid_size > 0 && quote.ask_size > 0 && quote.bid_price >= quote.ask_price) {
+            return reject("Crossed quote");
+        }
+        if ((quote.bid_size > 0 && !check_risk(user_id, quote.instrument_id, Side::BUY, quote.bid_size)) ||
+            (quote.ask_size > 0 && !check_risk(user_id, quote.instrument_id, Side::SELL, quote.ask_size))) {
+            return reject("Risk limit exceeded");
+        }
+    }
+    
+    for (const auto& quote : quotes) {
+        auto key = std::make_pair(user_id, quote.instrument_id);
+        auto& resting = quotes_[key];
+        for (OrderId order_id : resting) {
+            detach_order(order_id, user_id);  // Already filled ones are gone
+        }
+        resting.clear();
+        
+        OrderRequest request;
+        request.user_id = user_id;
+        request.instrument_id = quote.instrument_id;
+        for (Side side : {Side::BUY, Side::SELL}) {
+            request.side = side;
+            request.price = side == Side::BUY ? quote.bid_price : quote.ask_price;
+            request.quantity = side == Side::BUY ? quote.bid_size : quote.ask_size;
+            if (request.quantity == 0) continue;
+            OrderId order_id = execute_order(request, result.fills);
+            resting.push_back(order_id);
+            result.order_ids.push_back(order_id);
+            stats_.total_orders++;
+        }
+        if (resting.empty()) quotes_.erase(key);
+        on_book_changed(quote.instrument_id);
+    }
+    
+    auto implied_fills = flush_implied();
+    result.fills.insert(result.fills.end(), implied_fills.begin(), implied_fills.end());
+    requote_market_makers(result.fills);
+    
+    result.success = true;
+    return result;
+}
+
+bool Engine::enable_market_maker(const MarketMakerConfig& config) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::ENABLE_MARKET_MAKER, config);
+    
+    auto inst_it = instruments_.find(config.instrument_id);
+    if (inst_it == instruments_.end() || inst_it->second.type == InstrumentType::COMBO ||
+        config.user_id == 0 || config.size <= 0 || config.half_spread < 0 ||
+        config.max_inventory < 0) {
+        return false;
+    }
+    
+    disable_market_maker(config.instrument_id);
+    market_makers_.emplace(config.instrument_id, MarketMaker(config));
+    
+    std::vector<Fill> fills;
+    requote_market_makers(fills, true);
+    return true;
+}
+
+bool Engine::disable_market_maker(InstrumentId id) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::DISABLE_MARKET_MAKER, id);
+    
+    auto it = market_makers_.find(id);
+    if (it == market_makers_.end()) return false;
+    
+    // Pull its quotes even when the instrument is halted
+    auto quotes_it = quotes_.find(std::make_pair(it->second.config().user_id, id));
+    if (quotes_it != quotes_.end()) {
+        for (OrderId order_id : quotes_it->second) detach_order(order_id, quotes_it->first.first);
+        quotes_.erase(quotes_it);
+        on_book_changed(id);
+        flush_implied();
+    }
+    market_makers_.erase(it);
+    return true;
+}
+
+std::vector<Fill> Engine::step_market_makers() noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::STEP_MARKET_MAKERS);
+    
+    for (auto& [inst_id, maker] : market_makers_) {
+        maker.step(instruments_[inst_id].tick_size);
+    }
+    std::vector<Fill> fills;
+    requote_market_makers(fills, true);
+    return fills;
+}
+
+const MarketMaker* Engine::get_market_maker(InstrumentId id) const noexcept {
+    auto it = market_makers_.find(id);
+    return it != market_makers_.end() ? &it->second : nullptr;
+}
+
+void Engine::requote_market_makers(std::vector<Fill>& fills, bool requote_all) noexcept {
+    if (requoting_ || market_makers_.empty()) return;
+    requoting_ = true;
+    
+    // Bots requote when their house account traded; requotes can trade too,
+    // so repeat for a bounded number of rounds
+    constexpr int kMaxRounds = 4;
+    size_t checked = 0;
+    for (int round = 0; round < kMaxRounds; ++round) {
+        std::vector<Fill> new_fills;
+        for (auto& [inst_id, maker] : market_makers_) {
+            const auto& inst = instruments_[inst_id];
+            UserId house = maker.config().user_id;
+            bool traded = std::any_of(fills.begin() + checked, fills.end(), [&](const Fill& fill) {
+                return fill.user_id == house && fill.instrument_id == inst_id;
+            });
+            if (inst.is_halted || !(requote_all || traded)) continue;
+            
+            Quantity inventory = 0;
+            auto pos_it = positions_.find(house);
+            if (pos_it != positions_.end()) {
+                auto inst_pos = pos_it->second.find(inst_id);
+                if (inst_pos != pos_it->second.end()) inventory = inst_pos->second.net_qty;
+            }
+            
+            auto result = mass_quote(house, {maker.quote(inventory, inst.tick_size)});
+            new_fills.insert(new_fills.end(), result.fills.begin(), result.fills.end());
+        }
+        checked = fills.size();
+        fills.insert(fills.end(), new_fills.begin(), new_fills.end());
+        requote_all = false;
+        if (new_fills.empty()) break;
+    }
+    
+    requoting_ = false;
+}
+
+bool Engine::validate_order(const OrderRequest& request, std::string& error) const noexcept {
+    // Validate instrument
+    auto inst_it = instruments_.find(request.instrument_id);
+    if (inst_it == instruments_.end()) {
+        error = "Instrument not found";
+        return false;
+    }
+    
+    if (inst_it->second.is_halted) {
+        error = "Instrument is halted";
+        return false;
+    }
+    
+    // Check risk limits (combos are checked on each leg they would trade)
+    bool risk_ok = true;
+    if (inst_it->second.type == InstrumentType::COMBO) {
+        for (const auto& leg : inst_it->second.legs) {
+            Side leg_side = (leg.ratio > 0) == (request.side == Side::BUY) ? Side::BUY : Side::SELL;
+            risk_ok = risk_ok && check_risk(request.user_id, leg.instrument_id, leg_side,
+                                            request.quantity * std::abs(leg.ratio));
+        }
+    } else {
+        risk_ok = check_risk(request.user_id, request.instrument_id, request.side, request.quantity);
+    }
+    if (!risk_ok) {
+        error = "Risk limit exceeded";
+        return false;
     }
     
     // Validate price/quantity
     if (request.quantity <= 0) {
-        result.error_message = "Invalid quantity";
-        stats_.total_rejects++;
-        return result;
+        error = "Invalid quantity";
+        return false;
     }
     
+    if (request.price % inst_it->second.tick_size != 0) {
+        error = "Price not on tick grid";
+        return false;
+    }
+    
+    return true;
+}
+
+OrderId Engine::execute_order(const OrderRequest& request, std::vector<Fill>& fills,
+                              uint64_t* accepted_seq) noexcept {
     // Create order
     auto order = std::make_shared<Order>();
     order->id = next_order_id_++;
@@ -79,83 +536,95 @@ Engine::OrderResult Engine::submit_order(const OrderRequest& request) noexcept {
     order->status = OrderStatus::PENDING;
     order->tif = request.tif;
     order->post_only = request.post_only;
-    order->timestamp = std::chrono::steady_clock::now();
+    order->timestamp = clock_;
     
-    result.order_id = order->id;
+    // Combos take implied liquidity from the leg books first
+    std::vector<Fill> order_fills;
+    if (instruments_.find(request.instrument_id)->second.type == InstrumentType::COMBO) {
+        order_fills = execute_implied(order);
+    }
     
-    // Submit to order book
-    auto& book = order_books_[request.instrument_id];
-    result.fills = book->add_order(order);
+    // Submit the remainder to the order book
+    if (order->status != OrderStatus::REJECTED) {
+        if (order->filled_quantity < order->quantity) {
+            auto& book = order_books_[request.instrument_id];
+            auto book_fills = book->add_order(order);
+            order_fills.insert(order_fills.end(), book_fills.begin(), book_fills.end());
+        } else {
+            order->status = OrderStatus::FILLED;
+        }
+    }
+    
+    if (order->status != OrderStatus::REJECTED) {
+        EngineEvent accepted(EngineEventType::ORDER_ACCEPTED, order->instrument_id);
+        accepted.user_id = order->user_id;
+        accepted.order_id = order->id;
+        accepted.side = order->side;
+        accepted.price = order->price;
+        accepted.quantity = order->quantity;
+        uint64_t seq = events_.append(std::move(accepted));
+        if (accepted_seq) *accepted_seq = seq;
+    }
     
     // Track active orders
     if (order->status == OrderStatus::PENDING || order->status == OrderStatus::PARTIAL) {
         active_orders_[order->id] = order;
-        user_orders_[request.user_id].insert(order->id);
+        user_orders_[request.user_id].emplace(order->id, order);
     }
     
-    // Update positions for fills
-    // Fills come in pairs (aggressor, passive), so process them in pairs
-    for (size_t i = 0; i < result.fills.size(); i += 2) {
-        const auto& fill1 = result.fills[i];
-        update_position(fill1.user_id, fill1);
-        fill_history_.push_back(fill1);
-        stats_.total_fills++;
-        
-        if (i + 1 < result.fills.size()) {
-            const auto& fill2 = result.fills[i + 1];
-            update_position(fill2.user_id, fill2);
-            fill_history_.push_back(fill2);
-            stats_.total_fills++;
-            
-            // Create trade record from the matched pair
-            TradeRecord trade;
-            trade.instrument_id = fill1.instrument_id;
-            trade.price = fill1.price;
-            trade.quantity = fill1.quantity;
-            trade.timestamp = fill1.timestamp;
-            
-            if (fill1.side == Side::BUY) {
-                trade.buy_order_id = fill1.order_id;
-                trade.buyer_id = fill1.user_id;
-                trade.sell_order_id = fill2.order_id;
-                trade.seller_id = fill2.user_id;
-            } else {
-                trade.sell_order_id = fill1.order_id;
-                trade.seller_id = fill1.user_id;
-                trade.buy_order_id = fill2.order_id;
-                trade.buyer_id = fill2.user_id;
-            }
-            
-            trade_history_.push_back(trade);
-        }
-    }
+    process_fills(order_fills);
+    on_book_changed(request.instrument_id);
     
-    result.success = true;
-    stats_.total_orders++;
-    return result;
+    fills.insert(fills.end(), order_fills.begin(), order_fills.end());
+    return order->id;
 }
 
 bool Engine::cancel_order(OrderId order_id, UserId user_id) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::CANCEL_ORDER, order_id, user_id);
+    
+    auto order = detach_order(order_id, user_id);
+    if (!order) return false;
+    
+    on_book_changed(order->instrument_id);
+    flush_implied();  // Removing liquidity cannot create a cross, only reprices
+    return true;
+}
+
+std::shared_ptr<Order> Engine::detach_order(OrderId order_id, UserId user_id) noexcept {
     auto it = active_orders_.find(order_id);
-    if (it == active_orders_.end()) return false;
+    if (it == active_orders_.end()) return nullptr;
     
     auto order = it->second;
-    if (order->user_id != user_id) return false;
+    if (order->user_id != user_id) return nullptr;
     
     // Cancel in order book
     auto& book = order_books_[order->instrument_id];
-    if (book->cancel_order(order_id)) {
-        active_orders_.erase(it);
-        user_orders_[user_id].erase(order_id);
-        stats_.total_cancels++;
-        return true;
-    }
+    if (!book->cancel_order(order_id)) return nullptr;
+    
+    active_orders_.erase(it);
+    user_orders_[user_id].erase(order_id);
+    stats_.total_cancels++;
     
-    return false;
+    EngineEvent event(EngineEventType::ORDER_CANCELLED, order->instrument_id);
+    event.user_id = user_id;
+    event.order_id = order_id;
+    event.side = order->side;
+    event.price = order->price;
+    event.quantity = order->quantity - order->filled_quantity;
+    events_.append(std::move(event));
+    return order;
 }
 
 bool Engine::replace_order(OrderId order_id, UserId user_id,
                           Price* new_price, Quantity* new_qty) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) {
+        record(CommandType::REPLACE_ORDER, order_id, user_id, new_price != nullptr,
+               new_price ? *new_price : Price(0), new_qty != nullptr,
+               new_qty ? *new_qty : Quantity(0));
+    }
+    
     // For simplicity, replace = cancel + new order
     auto it = active_orders_.find(order_id);
     if (it == active_orders_.end()) return false;
@@ -181,23 +650,62 @@ bool Engine::replace_order(OrderId order_id, UserId user_id,
 }
 
 bool Engine::cancel_all(UserId user_id) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::CANCEL_ALL, user_id);
+    
     auto it = user_orders_.find(user_id);
     if (it == user_orders_.end()) return true;
     
-    auto order_ids = it->second;  // Copy to avoid iterator invalidation
-    for (OrderId order_id : order_ids) {
+    auto orders = it->second;  // Copy to avoid iterator invalidation
+    for (const auto& [order_id, order] : orders) {
         cancel_order(order_id, user_id);
     }
     
     return true;
 }
 
-MarketSnapshot Engine::get_snapshot(InstrumentId id) const noexcept {
+MarketSnapshot Engine::get_snapshot(InstrumentId id, size_t depth) const noexcept {
     auto it = order_books_.find(id);
     if (it == order_books_.end()) {
         return MarketSnapshot();
     }
-    return it->second->get_snapshot();
+    MarketSnapshot snapshot = it->second->get_snapshot(depth);
+    snapshot.seq = events_.last_seq();
+    return snapshot;
+}
+
+std::vector<Fill> Engine::get_user_fills(UserId user_id, size_t since,
+                                         size_t limit) const noexcept {
+    std::vector<Fill> result;
+    auto it = user_fills_.find(user_id);
+    if (it == user_fills_.end() || since >= it->second.size()) return result;
+    
+    const auto& indexes = it->second;
+    size_t end = since + std::min(limit, indexes.size() - since);
+    result.reserve(end - since);
+    for (size_t i = since; i < end; ++i) {
+        result.push_back(fill_history_[indexes[i]]);
+    }
+    return result;
+}
+
+std::vector<Engine::TradeRecord> Engine::get_trade_history() const noexcept {
+    std::vector<TradeRecord> trades;
+    trades.reserve(trades_.size());
+    for (const auto& pair : trades_) {
+        trades.push_back(trade_record(fill_history_[pair.taker], fill_history_[pair.passive]));
+    }
+    return trades;
+}
+
+std::vector<std::shared_ptr<Order>> Engine::get_user_orders(UserId user_id) const noexcept {
+    std::vector<std::shared_ptr<Order>> result;
+    auto it = user_orders_.find(user_id);
+    if (it == user_orders_.end()) return result;
+    
+    result.reserve(it->second.size());
+    for (const auto& [order_id, order] : it->second) result.push_back(order);
+    return result;
 }
 
 std::vector<std::shared_ptr<Order>> Engine::get_orders(InstrumentId id) const noexcept {
@@ -216,19 +724,9 @@ std::vector<Position> Engine::get_positions(UserId user_id) const noexcept {
     auto it = positions_.find(user_id);
     if (it != positions_.end()) {
         for (const auto& [inst_id, pos] : it->second) {
-            // Only return open positions (net_qty != 0)
+            // Only return open positions (net_qty != 0); unrealized PnL is kept current by mark updates
             if (pos.net_qty != 0) {
-                Position p = pos;
-                
-                // Calculate unrealized PnL
-                Price mark = get_mark_price(inst_id);
-                if (mark > 0) {
-                    double mark_value = static_cast<double>(mark) / 100.0;  // Assuming cents
-                    double entry_value = static_cast<double>(pos.vwap) / 100.0;
-                    p.unrealized_pnl = (mark_value - entry_value) * pos.net_qty;
-                }
-                
-                result.push_back(p);
+                result.push_back(pos);
             }
         }
     }
@@ -243,18 +741,7 @@ double Engine::get_total_pnl(UserId user_id) const noexcept {
     auto it = positions_.find(user_id);
     if (it != positions_.end()) {
         for (const auto& [inst_id, pos] : it->second) {
-            total += pos.realized_pnl;
-            
-            // Add unrealized P&L for open positions
-            if (pos.net_qty != 0) {
-                Price mark = get_mark_price(inst_id);
-                if (mark > 0) {
-                    double mark_value = static_cast<double>(mark) / 100.0;
-                    double entry_value = static_cast<double>(pos.vwap) / 100.0;
-                    double unrealized = (mark_value - entry_value) * pos.net_qty;
-                    total += unrealized;
-                }
-            }
+            total += pos.realized_pnl + pos.unrealized_pnl;
         }
     }
     
@@ -262,14 +749,21 @@ double Engine::get_total_pnl(UserId user_id) const noexcept {
 }
 
 bool Engine::settle_instrument(InstrumentId id, Price settlement_value) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SETTLE_INSTRUMENT, id, settlement_value);
+    
     auto inst_it = instruments_.find(id);
     if (inst_it == instruments_.end()) return false;
     
-    const auto& inst = inst_it->second;
-    
+    settle_positions(inst_it->second, settlement_value, nullptr);
+    return true;
+}
+
+void Engine::settle_positions(const InstrumentSpec& inst, Price settlement_value,
+                              std::map<UserId, double>* pnl) noexcept {
     // Calculate settlement payoff for all positions
     for (auto& [user_id, user_positions] : positions_) {
-        auto pos_it = user_positions.find(id);
+        auto pos_it = user_positions.find(inst.id);
         if (pos_it == user_positions.end() || pos_it->second.net_qty == 0) {
             continue;
         }
@@ -279,32 +773,135 @@ bool Engine::settle_instrument(InstrumentId id, Price settlement_value) noexcept
         
         if (inst.type == InstrumentType::SCALAR) {
             // Payoff = settlement_value * net_qty * tick_value
-            payoff = (static_cast<double>(settlement_value) / 100.0) * pos.net_qty * inst.tick_value;
+            payoff = inst.to_decimal(settlement_value) * pos.net_qty * inst.tick_value;
         } else if (inst.type == InstrumentType::CALL) {
             // Payoff = max(settlement_value - strike, 0) * net_qty * tick_value
-            double intrinsic = std::max(0.0, (static_cast<double>(settlement_value - inst.strike) / 100.0));
+            double intrinsic = std::max(0.0, inst.to_decimal(settlement_value - inst.strike));
             payoff = intrinsic * pos.net_qty * inst.tick_value;
         } else if (inst.type == InstrumentType::PUT) {
             // Payoff = max(strike - settlement_value, 0) * net_qty * tick_value
-            double intrinsic = std::max(0.0, (static_cast<double>(inst.strike - settlement_value) / 100.0));
+            double intrinsic = std::max(0.0, inst.to_decimal(inst.strike - settlement_value));
             payoff = intrinsic * pos.net_qty * inst.tick_value;
         }
         
         // Subtract cost basis
-        double cost_basis = (static_cast<double>(pos.vwap) / 100.0) * pos.net_qty * inst.tick_value;
+        double cost_basis = inst.to_decimal(pos.vwap) * pos.net_qty * inst.tick_value;
         pos.realized_pnl += payoff - cost_basis;
+        if (pnl) (*pnl)[user_id] += payoff - cost_basis;
         pos.unrealized_pnl = 0.0;
         pos.net_qty = 0;
         pos.vwap = 0;
     }
     
+    risk_.on_settle(inst, inst.to_decimal(settlement_value));
+    holders_.erase(inst.id);
+    
     // Halt instrument after settlement
-    inst_it->second.is_halted = true;
+    instruments_[inst.id].is_halted = true;
     
-    return true;
+    EngineEvent event(EngineEventType::INSTRUMENT_SETTLED, inst.id);
+    event.value = settlement_value;
+    events_.append(std::move(event));
+}
+
+AdminResult Engine::apply_admin_batch(const std::vector<AdminAction>& actions) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::ADMIN_BATCH, actions);
+    
+    AdminResult result;
+    
+    // Validate everything up front so the batch applies all-or-nothing
+    for (size_t i = 0; i < actions.size(); ++i) {
+        const auto& action = actions[i];
+        auto it = instruments_.find(action.instrument_id);
+        const char* error = nullptr;
+        if (it == instruments_.end()) {
+            error = "Instrument not found";
+        } else if (action.type == AdminActionType::SET_TICK && action.value <= 0) {
+            error = "Invalid tick size";
+        } else if ((action.type == AdminActionType::SETTLE ||
+                    action.type == AdminActionType::SETTLE_CHAIN) &&
+                   it->second.type == InstrumentType::COMBO) {
+            error = "Combos settle through their legs";
+        } else if (action.type == AdminActionType::SETTLE_CHAIN &&
+                   it->second.type != InstrumentType::SCALAR) {
+            error = "Chain settlement needs an underlying";
+        }
+        if (error) {
+            result.error_message = error;
+            result.failed_index = i;
+            return result;
+        }
+    }
+    
+    for (const auto& action : actions) {
+        InstrumentId id = action.instrument_id;
+        InstrumentSpec& inst = instruments_[id];
+        
+        switch (action.type) {
+            case AdminActionType::HALT:
+            case AdminActionType::RESUME:
+                set_halted(inst, action.type == AdminActionType::HALT);
+                result.changes.push_back({action.type, id, 0});
+                break;
+            case AdminActionType::SET_TICK:
+                apply_tick_size(id, action.value, action.tick_policy, result.cancelled_orders);
+                result.changes.push_back({action.type, id, action.value});
+                break;
+            case AdminActionType::PULL_QUOTES:
+                pull_quotes(id, result.cancelled_orders);
+                result.changes.push_back({action.type, id, 0});
+                break;
+            case AdminActionType::SETTLE:
+                pull_quotes(id, result.cancelled_orders);
+                settle_positions(inst, action.value, &result.settlement_pnl);
+                result.changes.push_back({action.type, id, action.value});
+                break;
+            case AdminActionType::SETTLE_CHAIN: {
+                pull_quotes(id, result.cancelled_orders);
+                settle_positions(inst, action.value, &result.settlement_pnl);
+                result.changes.push_back({AdminActionType::SETTLE, id, action.value});
+                
+                // Options expire at the underlying's value, rescaled to their own decimals
+                double spot = inst.to_decimal(action.value);
+                auto options_it = options_by_underlying_.find(id);
+                if (options_it == options_by_underlying_.end()) break;
+                for (InstrumentId option_id : options_it->second) {
+                    InstrumentSpec& option = instruments_[option_id];
+                    Price value = static_cast<Price>(std::llround(spot * option.price_scale));
+                    pull_quotes(option_id, result.cancelled_orders);
+                    settle_positions(option, value, &result.settlement_pnl);
+                    result.changes.push_back({AdminActionType::SETTLE, option_id, value});
+                }
+                break;
+            }
+        }
+    }
+    
+    flush_implied();
+    result.success = true;
+    return result;
+}
+
+void Engine::pull_quotes(InstrumentId id, std::vector<OrderId>& cancelled) noexcept {
+    // Bulk path: clear the whole book at once rather than cancel order by order
+    auto removed = order_books_[id]->clear();
+    if (removed.empty()) return;
+    forget_orders(removed);
+    
+    EngineEvent event(EngineEventType::ORDERS_CANCELLED, id);
+    for (const auto& order : removed) {
+        event.order_ids.push_back(order->id);
+    }
+    cancelled.insert(cancelled.end(), event.order_ids.begin(), event.order_ids.end());
+    events_.append(std::move(event));
+    on_book_changed(id);
 }
 
 void Engine::set_risk_limits(UserId user_id, const RiskLimits& limits) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SET_RISK_LIMITS, user_id, limits);
+    
     risk_limits_[user_id] = limits;
 }
 
@@ -331,15 +928,195 @@ bool Engine::check_risk(UserId user_id, InstrumentId inst_id,
     return true;
 }
 
+bool Engine::set_mark_config(InstrumentId id, const MarkConfig& config) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SET_MARK_CONFIG, id, config);
+    
+    if (instruments_.find(id) == instruments_.end()) return false;
+    
+    marks_.configure(id, config);
+    if (config.method == MarkMethod::OPTION_MODEL) {
+        refresh_option_mark(id);
+    } else {
+        refresh_mark(id);
+    }
+    return true;
+}
+
+void Engine::set_risk_params(const RiskParams& params) noexcept {
+    CommandScope scope(*this);
+    if (scope.outer()) record(CommandType::SET_RISK_PARAMS, params);
+    
+    risk_.set_params(params);
+    
+    // Model marks depend on volatility and expiry
+    for (const auto& [underlying_id, options] : options_by_underlying_) {
+        for (InstrumentId option_id : options) {
+            refresh_option_mark(option_id);
+        }
+    }
+}
+
+bool Engine::subscribe_market_data(UserId client_id, InstrumentId id, uint32_t depth) noexcept {
+    if (order_books_.find(id) == order_books_.end() || depth == 0) return false;
+    market_data_.subscribe(client_id, id, depth);
+    return true;
+}
+
+bool Engine::subscribe_l3(UserId client_id, InstrumentId id) noexcept {
+    auto it = order_books_.find(id);
+    if (it == order_books_.end()) return false;
+    if (l3_feed_.subscribe(client_id, id)) {
+        it->second->set_order_listener(
+            [this](L3EventType type, const Order& order, Quantity quantity, uint32_t position) {
+                l3_feed_.publish(type, order, quantity, position);
+            });
+    }
+    return true;
+}
+
+bool Engine::unsubscribe_l3(UserId client_id, InstrumentId id) noexcept {
+    bool subscribed = l3_feed_.subscribers(id).count(client_id) > 0;
+    if (l3_feed_.unsubscribe(client_id, id)) order_books_[id]->set_order_listener(nullptr);
+    return subscribed;
+}
+
+void Engine::unsubscribe_all_l3(UserId client_id) noexcept {
+    for (InstrumentId id : l3_feed_.unsubscribe_all(client_id)) {
+        order_books_[id]->set_order_listener(nullptr);
+    }
+}
+
+L3Snapshot Engine::get_l3_snapshot(InstrumentId id) const noexcept {
+    auto it = order_books_.find(id);
+    if (it == order_books_.end()) return {};
+    L3Snapshot snapshot = it->second->get_l3_snapshot();
+    snapshot.seq = l3_feed_.last_seq(id);
+    return snapshot;
+}
+
+ImpliedQuote Engine::get_implied_quote(InstrumentId id) const noexcept {
+    return implied_.is_combo(id) ? implied_.get_implied_in(id) : implied_.get_implied_out(id);
+}
+
+RiskReport Engine::get_user_risk(UserId user_id) const noexcept {
+    return risk_.evaluate_user(user_id, get_underlying_spots());
+}
+
+RiskReport Engine::get_room_risk() const noexcept {
+    return risk_.evaluate_room(get_underlying_spots());
+}
+
 Engine::Stats Engine::get_stats() const noexcept {
-    return stats_;
+    Stats stats = stats_;
+    stats.memory = get_memory_stats();
+    return stats;
+}
+
+MemoryUsage Engine::MemoryStats::total() const noexcept {
+    MemoryUsage usage = books;
+    usage += orders;
+    usage += positions;
+    usage += history;
+    usage += indexes;
+    usage += events;
+    return usage;
+}
+
+Engine::MemoryStats Engine::get_memory_stats() const noexcept {
+    MemoryStats stats;
+    
+    for (const auto& [inst_id, book] : order_books_) {
+        stats.books += memory::bytes(sizeof(OrderBook));
+        stats.books += book->memory_usage();
+    }
+    
+    stats.orders += memory::bytes(active_orders_.size() *
+                                  (sizeof(Order) + memory::kSharedBlockOverhead));
+    stats.orders += memory::of(active_orders_);
+    stats.orders += memory::of(user_orders_);
+    for (const auto& [user_id, orders] : user_orders_) stats.orders += memory::of(orders);
+    
+    stats.positions += memory::of(positions_);
+    for (const auto& [user_id, user_positions] : positions_) {
+        stats.positions += memory::of(user_positions);
+    }
+    stats.positions += risk_.memory_usage();
+    
+    stats.history += memory::of(fill_history_);
+    stats.history += memory::of(trades_);
+    stats.history += memory::of(user_fills_);
+    stats.history += journal_.memory_usage();
+    for (const auto& [user_id, indexes] : user_fills_) stats.history += memory::of(indexes);
+    
+    stats.indexes += memory::of(instruments_);
+    stats.indexes += memory::of(order_books_);
+    stats.indexes += memory::of(risk_limits_);
+    stats.indexes += memory::of(holders_);
+    for (const auto& [inst_id, users] : holders_) stats.indexes += memory::of(users);
+    stats.indexes += memory::of(options_by_underlying_);
+    for (const auto& [inst_id, options] : options_by_underlying_) {
+        stats.indexes += memory::of(options);
+    }
+    stats.indexes += memory::of(cancel_on_disconnect_);
+    stats.indexes += marks_.memory_usage();
+    stats.indexes += implied_.memory_usage();
+    stats.indexes += market_data_.memory_usage();
+    stats.indexes += memory::of(quotes_);
+    for (const auto& [key, order_ids] : quotes_) stats.indexes += memory::of(order_ids);
+    stats.indexes += memory::of(market_makers_);
+    
+    stats.events += events_.memory_usage();
+    stats.events += l3_feed_.memory_usage();
+    
+    return stats;
+}
+
+void Engine::process_fills(std::vector<Fill>& fills) noexcept {
+    // Each aggressor fill is followed by the passive fills it matched (one,
+    // or a level's worth when aggregated); every passive fill is a trade.
+    // Fills are stamped with their event seq, which callers also get back.
+    uint32_t taker = 0;
+    bool have_taker = false;
+    for (auto& fill : fills) {
+        auto index = static_cast<uint32_t>(fill_history_.size());
+        fill.seq = events_.append(fill_event(fill));
+        update_position(fill.user_id, fill);
+        user_fills_[fill.user_id].push_back(index);
+        fill_history_.push_back(fill);
+        stats_.total_fills++;
+        
+        if (fill.aggressor) {
+            taker = index;
+            have_taker = true;
+            continue;
+        }
+        if (!have_taker) continue;
+        
+        trades_.push_back({taker, index});
+        
+        // Passive orders leave the active set once fully filled
+        auto passive_it = active_orders_.find(fill.order_id);
+        if (passive_it != active_orders_.end() &&
+            passive_it->second->status == OrderStatus::FILLED) {
+            user_orders_[passive_it->second->user_id].erase(fill.order_id);
+            active_orders_.erase(passive_it);
+        }
+    }
 }
 
 void Engine::update_position(UserId user_id, const Fill& fill) noexcept {
+    const auto& inst = instruments_.find(fill.instrument_id)->second;  // Validated on submit
+    if (inst.type == InstrumentType::COMBO) {
+        update_combo_position(user_id, fill, inst);
+        return;
+    }
+    
     Position& pos = positions_[user_id][fill.instrument_id];
     pos.instrument_id = fill.instrument_id;
     
     Quantity fill_qty = (fill.side == Side::BUY ? fill.quantity : -fill.quantity);
+    risk_.on_fill(user_id, inst, fill_qty, inst.to_decimal(fill.price));
     
     // Update VWAP
     if (pos.net_qty == 0) {
@@ -354,7 +1131,7 @@ void Engine::update_position(UserId user_id, const Fill& fill) noexcept {
     } else {
         // Reducing or flipping position - realize PnL
         Quantity reduce_qty = std::min(std::abs(pos.net_qty), std::abs(fill_qty));
-        double pnl_per_unit = (static_cast<double>(fill.price - pos.vwap) / 100.0);
+        double pnl_per_unit = inst.to_decimal(fill.price - pos.vwap);
         if (pos.net_qty < 0) pnl_per_unit = -pnl_per_unit;
         pos.realized_pnl += pnl_per_unit * reduce_qty;
         
@@ -364,23 +1141,250 @@ void Engine::update_position(UserId user_id, const Fill& fill) noexcept {
             pos.vwap = fill.price;
         }
     }
+    
+    if (pos.net_qty != 0) {
+        holders_[fill.instrument_id].insert(user_id);
+    } else {
+        holders_[fill.instrument_id].erase(user_id);
+    }
+    pos.unrealized_pnl = unrealized_pnl(pos);
 }
 
-Price Engine::get_mark_price(InstrumentId id) const noexcept {
+void Engine::update_combo_position(UserId user_id, const Fill& fill,
+                                   const InstrumentSpec& combo) noexcept {
+    // Combo trades are booked as leg positions. Legs are priced at their
+    // marks and the smallest-ratio leg absorbs the difference so the legs
+    // add up to the traded combo price. Unless that leg has a unit ratio the
+    // division can leave a remainder, which is realized on it instead.
+    std::vector<Price> prices;
+    size_t absorb = 0;
+    Price implied_total = 0;
+    for (size_t i = 0; i < combo.legs.size(); ++i) {
+        const auto& leg = combo.legs[i];
+        prices.push_back(marks_.get(leg.instrument_id));
+        implied_total += leg.ratio * prices.back();
+        if (std::abs(leg.ratio) < std::abs(combo.legs[absorb].ratio)) absorb = i;
+    }
+    const auto& absorber = combo.legs[absorb];
+    prices[absorb] += (fill.price - implied_total) / absorber.ratio;
+    Price residue = (fill.price - implied_total) % absorber.ratio;
+    
+    for (size_t i = 0; i < combo.legs.size(); ++i) {
+        const auto& leg = combo.legs[i];
+        Fill leg_fill = fill;
+        leg_fill.instrument_id = leg.instrument_id;
+        leg_fill.side = (leg.ratio > 0) == (fill.side == Side::BUY) ? Side::BUY : Side::SELL;
+        leg_fill.price = prices[i];
+        leg_fill.quantity = fill.quantity * std::abs(leg.ratio);
+        update_position(user_id, leg_fill);
+    }
+    
+    // A buyer paid the residue over the booked legs; a seller received it
+    if (residue != 0) {
+        const auto& inst = instruments_.find(absorber.instrument_id)->second;
+        double pnl = inst.to_decimal(residue) * fill.quantity;
+        positions_[user_id][absorber.instrument_id].realized_pnl +=
+            fill.side == Side::BUY ? -pnl : pnl;
+    }
+}
+
+void Engine::on_book_changed(InstrumentId id) noexcept {
+    refresh_mark(id);
+    implied_.mark_dirty(id);
+    market_data_.on_book_changed(id);
+}
+
+TopOfBook Engine::get_top_of_book(InstrumentId id) const noexcept {
     auto it = order_books_.find(id);
-    if (it == order_books_.end()) return 0;
+    return it != order_books_.end() ? it->second->get_top_of_book() : TopOfBook();
+}
+
+bool Engine::legs_tradable(const std::vector<ComboLeg>& legs) const noexcept {
+    for (const auto& leg : legs) {
+        if (instruments_.find(leg.instrument_id)->second.is_halted) return false;
+    }
+    return true;
+}
+
+std::vector<Fill> Engine::execute_implied(const std::shared_ptr<Order>& order) noexcept {
+    std::vector<Fill> fills;
+    const auto& legs = implied_.get_legs(order->instrument_id);
+    if (!legs_tradable(legs)) return fills;
     
-    Price last = it->second->get_last_price();
-    if (last > 0) return last;
+    auto tob_fn = [this](InstrumentId id) { return get_top_of_book(id); };
+    const auto& combo_book = order_books_[order->instrument_id];
+    bool buy = order->side == Side::BUY;
     
-    Price bid = it->second->get_best_bid();
-    Price ask = it->second->get_best_ask();
-    if (bid > 0 && ask > 0) {
-        return (bid + ask) / 2;
+    // Take implied liquidity one top-of-book round at a time while it is at
+    // least as good as the combo's own book; the remainder then matches there
+    while (order->filled_quantity < order->quantity) {
+        ImpliedQuote quote = ImpliedEngine::implied_in(legs, tob_fn);
+        Price price = buy ? quote.ask : quote.bid;
+        Quantity size = buy ? quote.ask_size : quote.bid_size;
+        if (size <= 0 || (buy ? price > order->price : price < order->price)) break;
+        
+        TopOfBook direct = combo_book->get_top_of_book();
+        if (buy ? (direct.ask_size > 0 && direct.ask < price)
+                : (direct.bid_size > 0 && direct.bid > price)) {
+            break;
+        }
+        
+        if (order->post_only) {
+            order->status = OrderStatus::REJECTED;
+            break;
+        }
+        
+        Quantity qty = std::min(size, order->quantity - order->filled_quantity);
+        auto leg_fills = execute_legs(legs, order->id, order->user_id, order->side, qty);
+        fills.insert(fills.end(), leg_fills.begin(), leg_fills.end());
+        order->filled_quantity += qty;
     }
     
-    return 0;
+    return fills;
 }
 
-}  // namespace mmg
+std::vector<Fill> Engine::execute_legs(const std::vector<ComboLeg>& legs, OrderId parent_id,
+                                       UserId user_id, Side combo_side, Quantity combo_qty) noexcept {
+    // Sizes come from the current implied quote, so every leg fills in full
+    // at its top level and the package executes atomically
+    std::vector<Fill> fills;
+    for (const auto& leg : legs) {
+        bool buy_leg = (leg.ratio > 0) == (combo_side == Side::BUY);
+        TopOfBook tob = get_top_of_book(leg.instrument_id);
+        
+        auto child = std::make_shared<Order>();
+        child->id = parent_id;  // Leg fills report against the combo order
+        child->user_id = user_id;
+        child->instrument_id = leg.instrument_id;
+        child->side = buy_leg ? Side::BUY : Side::SELL;
+        child->price = buy_leg ? tob.ask : tob.bid;
+        child->quantity = combo_qty * std::abs(leg.ratio);
+        child->tif = TimeInForce::IOC;
+        child->timestamp = clock_;
+        
+        auto leg_fills = order_books_[leg.instrument_id]->add_order(child);
+        fills.insert(fills.end(), leg_fills.begin(), leg_fills.end());
+        on_book_changed(leg.instrument_id);
+    }
+    return fills;
+}
+
+std::vector<Fill> Engine::match_resting_combo(InstrumentId combo_id) noexcept {
+    std::vector<Fill> fills;
+    const auto& legs = implied_.get_legs(combo_id);
+    if (instruments_.find(combo_id)->second.is_halted || !legs_tradable(legs)) return fills;
+    
+    auto tob_fn = [this](InstrumentId id) { return get_top_of_book(id); };
+    auto& book = order_books_[combo_id];
+    
+    for (Side side : {Side::BUY, Side::SELL}) {
+        bool buy = side == Side::BUY;
+        while (auto resting = book->get_front_order(side)) {
+            ImpliedQuote quote = ImpliedEngine::implied_in(legs, tob_fn);
+            Price price = buy ? quote.ask : quote.bid;
+            Quantity size = buy ? quote.ask_size : quote.bid_size;
+            if (size <= 0 || (buy ? price > resting->price : price < resting->price)) break;
+            
+            Quantity qty = std::min(size, resting->quantity - resting->filled_quantity);
+            auto leg_fills = execute_legs(legs, resting->id, resting->user_id, side, qty);
+            fills.insert(fills.end(), leg_fills.begin(), leg_fills.end());
+            
+            book->fill_resting(resting->id, qty, price);
+            if (resting->status == OrderStatus::FILLED) {
+                active_orders_.erase(resting->id);
+                user_orders_[resting->user_id].erase(resting->id);
+            }
+        }
+    }
+    
+    if (!fills.empty()) on_book_changed(combo_id);
+    return fills;
+}
+
+std::vector<Fill> Engine::flush_implied() noexcept {
+    std::vector<Fill> fills;
+    auto tob_fn = [this](InstrumentId id) { return get_top_of_book(id); };
+    
+    // Matching dirties leg books again; loop until implied prices settle
+    while (implied_.has_dirty()) {
+        for (InstrumentId combo_id : implied_.recompute(tob_fn)) {
+            market_data_.on_book_changed(combo_id);  // Implied prices moved
+            auto combo_fills = match_resting_combo(combo_id);
+            process_fills(combo_fills);
+            fills.insert(fills.end(), combo_fills.begin(), combo_fills.end());
+        }
+    }
+    return fills;
+}
+
+void Engine::refresh_mark(InstrumentId id) noexcept {
+    auto it = order_books_.find(id);
+    if (it == order_books_.end()) return;
+    
+    if (marks_.on_book_update(id, it->second->get_top_of_book())) {
+        on_mark_changed(id);
+    }
+}
 
+void Engine::on_mark_changed(InstrumentId id) noexcept {
+    revalue_holders(id);
+    
+    auto it = options_by_underlying_.find(id);
+    if (it == options_by_underlying_.end()) return;
+    for (InstrumentId option_id : it->second) {
+        refresh_option_mark(option_id);
+    }
+}
+
+void Engine::refresh_option_mark(InstrumentId option_id) noexcept {
+    if (marks_.get_config(option_id).method != MarkMethod::OPTION_MODEL) return;
+    
+    const auto& option = instruments_.find(option_id)->second;
+    auto under_it = instruments_.find(option.reference_id);
+    double underlying_mark = under_it != instruments_.end()
+        ? under_it->second.to_decimal(marks_.get(option.reference_id)) : 0.0;
+    
+    const RiskParams& params = risk_.get_params();
+    OptionModel model;
+    model.cp_sign = option.type == InstrumentType::CALL ? 1.0 : -1.0;
+    model.strike = option.to_decimal(option.strike);
+    model.volatility = params.volatility;
+    model.time_to_expiry = params.time_to_expiry;
+    model.rate = params.rate;
+    
+    if (marks_.on_underlying_update(option_id, underlying_mark, model, option.price_scale)) {
+        revalue_holders(option_id);
+    }
+}
+
+void Engine::revalue_holders(InstrumentId id) noexcept {
+    auto it = holders_.find(id);
+    if (it == holders_.end()) return;
+    
+    for (UserId user_id : it->second) {
+        Position& pos = positions_[user_id][id];
+        pos.unrealized_pnl = unrealized_pnl(pos);
+    }
+}
+
+double Engine::unrealized_pnl(const Position& pos) const noexcept {
+    Price mark = marks_.get(pos.instrument_id);
+    if (mark <= 0 || pos.net_qty == 0) return 0.0;
+    
+    const auto& inst = instruments_.find(pos.instrument_id)->second;
+    return (inst.to_decimal(mark) - inst.to_decimal(pos.vwap)) * pos.net_qty;
+}
+
+std::map<InstrumentId, double> Engine::get_underlying_spots() const noexcept {
+    std::map<InstrumentId, double> spots;
+    for (InstrumentId id : risk_.get_underlyings()) {
+        auto inst_it = instruments_.find(id);
+        Price mark = get_mark_price(id);
+        if (inst_it != instruments_.end() && mark > 0) {
+            spots[id] = inst_it->second.to_decimal(mark);
+        }
+    }
+    return spots;
+}
+
+}  // namespace mmg
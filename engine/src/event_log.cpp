@@ -0,0 +1,47 @@
+#include "mmg/event_log.h"
+#include <algorithm>
+
+namespace mmg {
+
+EventLog::EventLog(size_t capacity)
+    : ring_(std::max<size_t>(capacity, 1)), last_seq_(0), drained_seq_(0) {}
+
+uint64_t EventLog::append(EngineEvent event) noexcept {
+    event.seq = ++last_seq_;
+    ring_[(event.seq - 1) % ring_.size()] = std::move(event);
+    return last_seq_;
+}
+
+uint64_t EventLog::first_cached_seq() const noexcept {
+    return last_seq_ >= ring_.size() ? last_seq_ - ring_.size() + 1 : 1;
+}
+
+bool EventLog::replay_from(uint64_t from_seq, std::vector<EngineEvent>& out) const noexcept {
+    out.clear();
+    from_seq = std::max<uint64_t>(from_seq, 1);
+    if (from_seq < first_cached_seq()) return false;
+    
+    for (uint64_t seq = from_seq; seq <= last_seq_; ++seq) {
+        out.push_back(ring_[(seq - 1) % ring_.size()]);
+    }
+    return true;
+}
+
+bool EventLog::drain(std::vector<EngineEvent>& out) noexcept {
+    bool complete = drained_seq_ + 1 >= first_cached_seq();
+    replay_from(std::max(drained_seq_ + 1, first_cached_seq()), out);
+    drained_seq_ = last_seq_;
+    return complete;
+}
+
+MemoryUsage EventLog::memory_usage() const noexcept {
+    MemoryUsage usage = memory::of(ring_);
+    size_t cached = static_cast<size_t>(last_seq_ - first_cached_seq() + 1);
+    usage.used = cached * sizeof(EngineEvent);
+    for (const auto& event : ring_) {
+        usage += memory::of(event.order_ids);
+    }
+    return usage;
+}
+
+}  // namespace mmg
@@ -0,0 +1,186 @@
+#include "mmg/implied_engine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace mmg {
+
+namespace {
+
+const std::vector<ComboLeg> kNoLegs;
+
+// Price and size on the side of a book that a buyer (or seller) would take
+bool take_side(const TopOfBook& tob, bool buy, Price& price, Quantity& size) noexcept {
+    if (buy) {
+        price = tob.ask;
+        size = tob.ask_size;
+    } else {
+        price = tob.bid;
+        size = tob.bid_size;
+    }
+    return size > 0;
+}
+
+}  // namespace
+
+void ImpliedEngine::add_combo(const InstrumentSpec& combo) noexcept {
+    ComboState& state = combos_[combo.id];
+    state.legs = combo.legs;
+    for (const auto& leg : combo.legs) {
+        combos_by_leg_[leg.instrument_id].push_back(combo.id);
+    }
+    dirty_.insert(combo.id);
+}
+
+const std::vector<ComboLeg>& ImpliedEngine::get_legs(InstrumentId combo_id) const noexcept {
+    auto it = combos_.find(combo_id);
+    return it != combos_.end() ? it->second.legs : kNoLegs;
+}
+
+void ImpliedEngine::mark_dirty(InstrumentId id) noexcept {
+    if (combos_.count(id) || combos_by_leg_.count(id)) {
+        dirty_.insert(id);
+    }
+}
+
+std::vector<InstrumentId> ImpliedEngine::recompute(const TopOfBookFn& top_of_book) noexcept {
+    std::set<InstrumentId> affected;
+    for (InstrumentId id : dirty_) {
+        if (combos_.count(id)) affected.insert(id);
+        auto it = combos_by_leg_.find(id);
+        if (it != combos_by_leg_.end()) {
+            affected.insert(it->second.begin(), it->second.end());
+        }
+    }
+    dirty_.clear();
+
+    std::set<InstrumentId> legs;
+    for (InstrumentId combo_id : affected) {
+        ComboState& state = combos_[combo_id];
+        state.implied_in = implied_in(state.legs, top_of_book);
+        for (const auto& leg : state.legs) {
+            legs.insert(leg.instrument_id);
+        }
+    }
+
+    for (InstrumentId leg_id : legs) {
+        implied_out_[leg_id] = compute_implied_out(leg_id, top_of_book);
+    }
+
+    return std::vector<InstrumentId>(affected.begin(), affected.end());
+}
+
+ImpliedQuote ImpliedEngine::get_implied_in(InstrumentId combo_id) const noexcept {
+    auto it = combos_.find(combo_id);
+    return it != combos_.end() ? it->second.implied_in : ImpliedQuote();
+}
+
+ImpliedQuote ImpliedEngine::get_implied_out(InstrumentId leg_id) const noexcept {
+    auto it = implied_out_.find(leg_id);
+    return it != implied_out_.end() ? it->second : ImpliedQuote();
+}
+
+MemoryUsage ImpliedEngine::memory_usage() const noexcept {
+    MemoryUsage usage = memory::of(combos_);
+    for (const auto& [combo_id, state] : combos_) usage += memory::of(state.legs);
+    usage += memory::of(combos_by_leg_);
+    for (const auto& [leg_id, combos] : combos_by_leg_) usage += memory::of(combos);
+    usage += memory::of(implied_out_);
+    usage += memory::of(dirty_);
+    return usage;
+}
+
+ImpliedQuote ImpliedEngine::implied_in(const std::vector<ComboLeg>& legs,
+                                       const TopOfBookFn& top_of_book) noexcept {
+    ImpliedQuote quote;
+    if (legs.empty()) return quote;
+
+    Price bid = 0, ask = 0;
+    Quantity bid_size = std::numeric_limits<Quantity>::max();
+    Quantity ask_size = std::numeric_limits<Quantity>::max();
+
+    for (const auto& leg : legs) {
+        TopOfBook tob = top_of_book(leg.instrument_id);
+        Quantity ratio = std::abs(leg.ratio);
+        Price price;
+        Quantity size;
+
+        // Buying the combo buys positive-ratio legs and sells negative ones
+        if (take_side(tob, leg.ratio > 0, price, size)) {
+            ask += leg.ratio * price;
+            ask_size = std::min(ask_size, size / ratio);
+        } else {
+            ask_size = 0;
+        }
+
+        if (take_side(tob, leg.ratio < 0, price, size)) {
+            bid += leg.ratio * price;
+            bid_size = std::min(bid_size, size / ratio);
+        } else {
+            bid_size = 0;
+        }
+    }
+
+    if (bid_size > 0) {
+        quote.bid = bid;
+        quote.bid_size = bid_size;
+    }
+    if (ask_size > 0) {
+        quote.ask = ask;
+        quote.ask_size = ask_size;
+    }
+    return quote;
+}
+
+ImpliedQuote ImpliedEngine::compute_implied_out(InstrumentId leg_id,
+                                                const TopOfBookFn& top_of_book) const noexcept {
+    ImpliedQuote best;
+
+    auto it = combos_by_leg_.find(leg_id);
+    if (it == combos_by_leg_.end()) return best;
+
+    for (InstrumentId combo_id : it->second) {
+        const auto& legs = combos_.find(combo_id)->second.legs;
+        auto self = std::find_if(legs.begin(), legs.end(),
+                                 [leg_id](const ComboLeg& l) { return l.instrument_id == leg_id; });
+        if (std::abs(self->ratio) != 1) continue;  // Would need fractional prices
+
+        TopOfBook combo_tob = top_of_book(combo_id);
+
+        // want_buy: implied bid in the leg (a resting combo order ends up buying it)
+        for (bool want_buy : {true, false}) {
+            bool combo_buyer = (self->ratio > 0) == want_buy;
+            Price price = combo_buyer ? combo_tob.bid : combo_tob.ask;
+            Quantity size = combo_buyer ? combo_tob.bid_size : combo_tob.ask_size;
+            if (size <= 0) continue;
+
+            // The combo side trades the other legs against their books
+            bool available = true;
+            for (const auto& other : legs) {
+                if (other.instrument_id == leg_id) continue;
+                bool buys_other = (other.ratio > 0) == combo_buyer;
+                Price other_price;
+                Quantity other_size;
+                if (!take_side(top_of_book(other.instrument_id), buys_other, other_price, other_size)) {
+                    available = false;
+                    break;
+                }
+                price -= other.ratio * other_price;
+                size = std::min(size, other_size / std::abs(other.ratio));
+            }
+            if (!available || size <= 0) continue;
+
+            price = price * self->ratio;  // ratio is +-1
+            if (want_buy && (best.bid_size == 0 || price > best.bid)) {
+                best.bid = price;
+                best.bid_size = size;
+            } else if (!want_buy && (best.ask_size == 0 || price < best.ask)) {
+                best.ask = price;
+                best.ask_size = size;
+            }
+        }
+    }
+    return best;
+}
+
+}  // namespace mmg
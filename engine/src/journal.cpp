@@ -0,0 +1,133 @@
+#include "mmg/journal.h"
+#include <algorithm>
+
+namespace mmg {
+
+namespace {
+
+// Empty books before the first record, so every target has a checkpoint
+const BookCheckpoint kStart{0, Timestamp::min(), 0, {}};
+
+}  // namespace
+
+BookJournal::BookJournal(size_t checkpoint_interval)
+    : checkpoint_interval_(std::max<size_t>(checkpoint_interval, 1)) {}
+
+void BookJournal::record(uint64_t seq, Timestamp timestamp, const JournalLevel& level) noexcept {
+    apply(live_, level);
+    records_.push_back({seq, timestamp, level});
+    size_t folded = checkpoints_.empty() ? 0 : checkpoints_.back().record_index;
+    if (records_.size() - folded < checkpoint_interval_) return;
+    
+    BookCheckpoint checkpoint{seq, timestamp, records_.size(), {}};
+    for (const auto& [inst_id, book] : live_) {
+        for (const auto& [price, size] : book.bids) {
+            checkpoint.levels.push_back({inst_id, Side::BUY, price, size});
+        }
+        for (const auto& [price, size] : book.asks) {
+            checkpoint.levels.push_back({inst_id, Side::SELL, price, size});
+        }
+    }
+    checkpoints_.push_back(std::move(checkpoint));
+}
+
+void BookJournal::reset_book(uint64_t seq, Timestamp timestamp,
+                             const MarketSnapshot& book) noexcept {
+    InstrumentId id = book.instrument_id;
+    std::vector<JournalLevel> changes;
+    auto diff = [&](Side side, const auto& old_levels, const std::vector<PriceLevel>& new_levels) {
+        for (const auto& [price, size] : old_levels) {
+            bool kept = std::any_of(new_levels.begin(), new_levels.end(),
+                                    [price = price](const PriceLevel& l) { return l.price == price; });
+            if (!kept) changes.push_back({id, side, price, 0});
+        }
+        for (const auto& level : new_levels) {
+            auto it = old_levels.find(level.price);
+            if (it == old_levels.end() || it->second != level.size) {
+                changes.push_back({id, side, level.price, level.size});
+            }
+        }
+    };
+    
+    auto it = live_.find(id);
+    Book empty;
+    const Book& old_book = it == live_.end() ? empty : it->second;
+    diff(Side::BUY, old_book.bids, book.bids);
+    diff(Side::SELL, old_book.asks, book.asks);
+    
+    for (const auto& change : changes) record(seq, timestamp, change);
+}
+
+std::vector<MarketSnapshot> BookJournal::reconstruct_at(Timestamp timestamp) const noexcept {
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), timestamp,
+                               [](Timestamp t, const BookCheckpoint& c) { return t < c.timestamp; });
+    return rebuild(it == checkpoints_.begin() ? kStart : *std::prev(it),
+                   [timestamp](const JournalRecord& r) { return r.timestamp <= timestamp; });
+}
+
+std::vector<MarketSnapshot> BookJournal::reconstruct_at_seq(uint64_t seq) const noexcept {
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), seq,
+                               [](uint64_t s, const BookCheckpoint& c) { return s < c.seq; });
+    return rebuild(it == checkpoints_.begin() ? kStart : *std::prev(it),
+                   [seq](const JournalRecord& r) { return r.seq <= seq; });
+}
+
+template <typename Before>
+std::vector<MarketSnapshot> BookJournal::rebuild(const BookCheckpoint& checkpoint,
+                                                 Before before) const noexcept {
+    Books books;
+    for (const auto& level : checkpoint.levels) apply(books, level);
+    
+    uint64_t seq = checkpoint.seq;
+    Timestamp timestamp = checkpoint.timestamp;
+    for (size_t i = checkpoint.record_index; i < records_.size() && before(records_[i]); ++i) {
+        apply(books, records_[i].level);
+        seq = records_[i].seq;
+        timestamp = records_[i].timestamp;
+    }
+    
+    // Stamped with the last change folded in
+    std::vector<MarketSnapshot> snapshots;
+    for (const auto& [inst_id, book] : books) {
+        if (book.bids.empty() && book.asks.empty()) continue;
+        MarketSnapshot snapshot;
+        snapshot.instrument_id = inst_id;
+        snapshot.timestamp = timestamp;
+        snapshot.seq = seq;
+        for (const auto& [price, size] : book.bids) snapshot.bids.emplace_back(price, size);
+        for (const auto& [price, size] : book.asks) snapshot.asks.emplace_back(price, size);
+        snapshots.push_back(std::move(snapshot));
+    }
+    return snapshots;
+}
+
+void BookJournal::apply(Books& books, const JournalLevel& level) noexcept {
+    Book& book = books[level.instrument_id];
+    if (level.side == Side::BUY) {
+        if (level.size == 0) {
+            book.bids.erase(level.price);
+        } else {
+            book.bids[level.price] = level.size;
+        }
+    } else {
+        if (level.size == 0) {
+            book.asks.erase(level.price);
+        } else {
+            book.asks[level.price] = level.size;
+        }
+    }
+}
+
+MemoryUsage BookJournal::memory_usage() const noexcept {
+    MemoryUsage usage = memory::of(records_);
+    usage += memory::of(checkpoints_);
+    for (const auto& checkpoint : checkpoints_) usage += memory::of(checkpoint.levels);
+    usage += memory::of(live_);
+    for (const auto& [inst_id, book] : live_) {
+        usage += memory::of(book.bids);
+        usage += memory::of(book.asks);
+    }
+    return usage;
+}
+
+}  // namespace mmg
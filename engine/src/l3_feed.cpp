@@ -0,0 +1,188 @@
+#include "mmg/l3_feed.h"
+#include "mmg/order_book.h"
+
+namespace mmg {
+
+bool L3Feed::subscribe(UserId client_id, InstrumentId id) noexcept {
+    auto& clients = subscribers_[id];
+    bool first = clients.empty();
+    clients.insert(client_id);
+    subscriptions_[client_id].insert(id);
+    return first;
+}
+
+bool L3Feed::unsubscribe(UserId client_id, InstrumentId id) noexcept {
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end() || it->second.erase(client_id) == 0) return false;
+    
+    auto sub_it = subscriptions_.find(client_id);
+    if (sub_it != subscriptions_.end()) {
+        sub_it->second.erase(id);
+        if (sub_it->second.empty()) subscriptions_.erase(sub_it);
+    }
+    if (!it->second.empty()) return false;
+    subscribers_.erase(it);
+    return true;
+}
+
+std::vector<InstrumentId> L3Feed::unsubscribe_all(UserId client_id) noexcept {
+    std::vector<InstrumentId> emptied;
+    auto it = subscriptions_.find(client_id);
+    if (it == subscriptions_.end()) return emptied;
+    
+    std::set<InstrumentId> ids = std::move(it->second);
+    subscriptions_.erase(it);
+    for (InstrumentId id : ids) {
+        auto sub_it = subscribers_.find(id);
+        if (sub_it == subscribers_.end()) continue;
+        sub_it->second.erase(client_id);
+        if (sub_it->second.empty()) {
+            subscribers_.erase(sub_it);
+            emptied.push_back(id);
+        }
+    }
+    return emptied;
+}
+
+const std::set<UserId>& L3Feed::subscribers(InstrumentId id) const noexcept {
+    static const std::set<UserId> kNone;
+    auto it = subscribers_.find(id);
+    return it == subscribers_.end() ? kNone : it->second;
+}
+
+std::vector<InstrumentId> L3Feed::subscriptions(UserId client_id) const noexcept {
+    auto it = subscriptions_.find(client_id);
+    if (it == subscriptions_.end()) return {};
+    return {it->second.begin(), it->second.end()};
+}
+
+void L3Feed::publish(L3EventType type, const Order& order, Quantity quantity,
+                     uint32_t position) noexcept {
+    L3Event event;
+    event.seq = ++seqs_[order.instrument_id];
+    event.instrument_id = order.instrument_id;
+    event.type = type;
+    event.order_id = order.id;
+    event.side = order.side;
+    event.price = order.price;
+    event.quantity = quantity;
+    event.position = position;
+    pending_.push_back(event);
+}
+
+uint64_t L3Feed::last_seq(InstrumentId id) const noexcept {
+    auto it = seqs_.find(id);
+    return it == seqs_.end() ? 0 : it->second;
+}
+
+std::vector<L3Event> L3Feed::drain() noexcept {
+    std::vector<L3Event> out;
+    out.swap(pending_);
+    return out;
+}
+
+MemoryUsage L3Feed::memory_usage() const noexcept {
+    MemoryUsage usage;
+    usage += memory::of(subscribers_);
+    for (const auto& [id, clients] : subscribers_) usage += memory::of(clients);
+    usage += memory::of(subscriptions_);
+    for (const auto& [client, ids] : subscriptions_) usage += memory::of(ids);
+    usage += memory::of(seqs_);
+    usage += memory::of(pending_);
+    return usage;
+}
+
+namespace l3 {
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, uint64_t v) noexcept {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v) noexcept {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) noexcept {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) noexcept {
+    return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+}
+
+// Previous seq and order id per instrument, the base for the next deltas
+using Bases = std::map<InstrumentId, std::pair<uint64_t, uint64_t>>;
+
+}  // namespace
+
+std::vector<uint8_t> encode(const std::vector<L3Event>& events) noexcept {
+    std::vector<uint8_t> out;
+    out.reserve(events.size() * 12);
+    Bases bases;
+    for (const auto& event : events) {
+        auto& [seq, order_id] = bases[event.instrument_id];
+        out.push_back(static_cast<uint8_t>(
+            static_cast<uint8_t>(event.type) | (event.side == Side::SELL ? 0x80 : 0)));
+        put_varint(out, event.instrument_id);
+        put_varint(out, zigzag(static_cast<int64_t>(event.seq - seq)));
+        put_varint(out, zigzag(static_cast<int64_t>(event.order_id - order_id)));
+        put_varint(out, zigzag(event.price));
+        put_varint(out, static_cast<uint64_t>(event.quantity));
+        put_varint(out, event.position);
+        seq = event.seq;
+        order_id = event.order_id;
+    }
+    return out;
+}
+
+bool decode(const uint8_t* data, size_t size, std::vector<L3Event>& out) noexcept {
+    out.clear();
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    Bases bases;
+    while (p != end) {
+        uint8_t head = *p++;
+        uint8_t type = head & 0x7f;
+        uint64_t instrument, seq_delta, order_delta, price, quantity, position;
+        if (type < static_cast<uint8_t>(L3EventType::ADD) ||
+            type > static_cast<uint8_t>(L3EventType::DELETE) ||
+            !get_varint(p, end, instrument) || !get_varint(p, end, seq_delta) ||
+            !get_varint(p, end, order_delta) || !get_varint(p, end, price) ||
+            !get_varint(p, end, quantity) || !get_varint(p, end, position) ||
+            instrument > UINT32_MAX || position > UINT32_MAX) {
+            out.clear();
+            return false;
+        }
+        
+        L3Event event;
+        event.instrument_id = static_cast<InstrumentId>(instrument);
+        auto& [seq, order_id] = bases[event.instrument_id];
+        event.type = static_cast<L3EventType>(type);
+        event.side = head & 0x80 ? Side::SELL : Side::BUY;
+        event.seq = seq + static_cast<uint64_t>(unzigzag(seq_delta));
+        event.order_id = order_id + static_cast<uint64_t>(unzigzag(order_delta));
+        event.price = unzigzag(price);
+        event.quantity = static_cast<Quantity>(quantity);
+        event.position = static_cast<uint32_t>(position);
+        seq = event.seq;
+        order_id = event.order_id;
+        out.push_back(event);
+    }
+    return true;
+}
+
+}  // namespace l3
+}  // namespace mmg
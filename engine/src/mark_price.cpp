@@ -0,0 +1,77 @@
+#include "mmg/mark_price.h"
+#include "mmg/pricing.h"
+#include <cmath>
+
+namespace mmg {
+
+void MarkPriceService::add_instrument(InstrumentId id) noexcept {
+    if (id >= states_.size()) {
+        states_.resize(static_cast<size_t>(id) + 1);
+    }
+}
+
+void MarkPriceService::configure(InstrumentId id, const MarkConfig& config) noexcept {
+    add_instrument(id);
+    states_[id].config = config;
+    states_[id].has_ema = false;
+}
+
+MarkConfig MarkPriceService::get_config(InstrumentId id) const noexcept {
+    return id < states_.size() ? states_[id].config : MarkConfig();
+}
+
+bool MarkPriceService::on_book_update(InstrumentId id, const TopOfBook& tob) noexcept {
+    if (id >= states_.size()) return false;
+    MarkState& state = states_[id];
+
+    bool two_sided = tob.bid > 0 && tob.ask > 0;
+    Price mid = two_sided ? (tob.bid + tob.ask) / 2 : 0;
+
+    switch (state.config.method) {
+        case MarkMethod::LAST_OR_MID:
+            return store(state, tob.last > 0 ? tob.last : mid);
+        case MarkMethod::LAST:
+            return store(state, tob.last);
+        case MarkMethod::MID:
+            return store(state, mid);
+        case MarkMethod::MICROPRICE: {
+            Quantity total = tob.bid_size + tob.ask_size;
+            if (!two_sided || total <= 0) return store(state, mid);
+            // Weight each side by the opposite size: a heavy bid pulls toward the ask
+            double micro = (static_cast<double>(tob.bid) * tob.ask_size +
+                            static_cast<double>(tob.ask) * tob.bid_size) / total;
+            return store(state, static_cast<Price>(std::llround(micro)));
+        }
+        case MarkMethod::EMA_MID: {
+            if (!two_sided) return false;  // Keep the last average through one-sided books
+            double alpha = state.config.ema_alpha;
+            state.ema = state.has_ema ? alpha * mid + (1.0 - alpha) * state.ema
+                                      : static_cast<double>(mid);
+            state.has_ema = true;
+            return store(state, static_cast<Price>(std::llround(state.ema)));
+        }
+        case MarkMethod::OPTION_MODEL:
+            return false;  // Driven by on_underlying_update
+    }
+    return false;
+}
+
+bool MarkPriceService::on_underlying_update(InstrumentId id, double underlying_mark,
+                                            const OptionModel& model, Price price_scale) noexcept {
+    if (id >= states_.size()) return false;
+    MarkState& state = states_[id];
+    if (state.config.method != MarkMethod::OPTION_MODEL) return false;
+    if (underlying_mark <= 0.0) return store(state, 0);
+
+    double value = pricing::black_scholes(model.cp_sign, underlying_mark, model.strike,
+                                          model.volatility, model.time_to_expiry, model.rate);
+    return store(state, static_cast<Price>(std::llround(value * static_cast<double>(price_scale))));
+}
+
+bool MarkPriceService::store(MarkState& state, Price mark) noexcept {
+    if (state.mark == mark) return false;
+    state.mark = mark;
+    return true;
+}
+
+}  // namespace mmg
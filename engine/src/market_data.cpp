@@ -0,0 +1,98 @@
+#include "mmg/market_data.h"
+#include <algorithm>
+
+namespace mmg {
+
+namespace {
+
+const std::vector<MarketDataSubscription> kNoSubscribers;
+
+bool by_client(const MarketDataSubscription& sub, UserId client_id) noexcept {
+    return sub.client_id < client_id;
+}
+
+}  // namespace
+
+void MarketDataPublisher::subscribe(UserId client_id, InstrumentId id, uint32_t depth) noexcept {
+    auto& subs = subscribers_[id];
+    auto it = std::lower_bound(subs.begin(), subs.end(), client_id, by_client);
+    if (it != subs.end() && it->client_id == client_id) {
+        it->depth = depth;
+    } else {
+        subs.insert(it, MarketDataSubscription(client_id, depth));
+    }
+    subscriptions_[client_id].insert(id);
+    pending_[client_id].insert(id);  // First publish is the current book
+}
+
+bool MarketDataPublisher::unsubscribe(UserId client_id, InstrumentId id) noexcept {
+    auto subs_it = subscribers_.find(id);
+    if (subs_it == subscribers_.end()) return false;
+    
+    auto& subs = subs_it->second;
+    auto it = std::lower_bound(subs.begin(), subs.end(), client_id, by_client);
+    if (it == subs.end() || it->client_id != client_id) return false;
+    subs.erase(it);
+    if (subs.empty()) subscribers_.erase(subs_it);
+    
+    auto erase_from = [&](std::map<UserId, std::set<InstrumentId>>& index) {
+        auto client_it = index.find(client_id);
+        if (client_it == index.end()) return;
+        client_it->second.erase(id);
+        if (client_it->second.empty()) index.erase(client_it);
+    };
+    erase_from(subscriptions_);
+    erase_from(pending_);
+    return true;
+}
+
+void MarketDataPublisher::unsubscribe_all(UserId client_id) noexcept {
+    for (InstrumentId id : subscriptions(client_id)) {
+        unsubscribe(client_id, id);
+    }
+}
+
+const std::vector<MarketDataSubscription>& MarketDataPublisher::subscribers(InstrumentId id) const noexcept {
+    auto it = subscribers_.find(id);
+    return it != subscribers_.end() ? it->second : kNoSubscribers;
+}
+
+std::vector<InstrumentId> MarketDataPublisher::subscriptions(UserId client_id) const noexcept {
+    auto it = subscriptions_.find(client_id);
+    if (it == subscriptions_.end()) return {};
+    return std::vector<InstrumentId>(it->second.begin(), it->second.end());
+}
+
+uint32_t MarketDataPublisher::max_depth(InstrumentId id) const noexcept {
+    uint32_t depth = 0;
+    for (const auto& sub : subscribers(id)) depth = std::max(depth, sub.depth);
+    return depth;
+}
+
+void MarketDataPublisher::on_book_changed(InstrumentId id) noexcept {
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end()) return;
+    for (const auto& sub : it->second) {
+        pending_[sub.client_id].insert(id);
+    }
+}
+
+std::vector<InstrumentId> MarketDataPublisher::take_updates(UserId client_id) noexcept {
+    auto it = pending_.find(client_id);
+    if (it == pending_.end()) return {};
+    std::vector<InstrumentId> updates(it->second.begin(), it->second.end());
+    pending_.erase(it);
+    return updates;
+}
+
+MemoryUsage MarketDataPublisher::memory_usage() const noexcept {
+    MemoryUsage usage = memory::of(subscribers_);
+    for (const auto& [id, subs] : subscribers_) usage += memory::of(subs);
+    usage += memory::of(subscriptions_);
+    for (const auto& [client, ids] : subscriptions_) usage += memory::of(ids);
+    usage += memory::of(pending_);
+    for (const auto& [client, ids] : pending_) usage += memory::of(ids);
+    return usage;
+}
+
+}  // namespace mmg
@@ -0,0 +1,32 @@
+#include "mmg/market_maker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mmg {
+
+MarketMaker::MarketMaker(const MarketMakerConfig& config)
+    : config_(config), fair_value_(config.fair_value), rng_(config.seed) {}
+
+Quote MarketMaker::quote(Quantity inventory, Price tick_size) const noexcept {
+    Quote quote;
+    quote.instrument_id = config_.instrument_id;
+    
+    Price reservation = fair_value_ - static_cast<Price>(std::llround(config_.skew * inventory));
+    quote.bid_price = snap_to_tick(reservation - config_.half_spread, tick_size, false);
+    quote.ask_price = snap_to_tick(reservation + config_.half_spread, tick_size, true);
+    if (quote.ask_price <= quote.bid_price) quote.ask_price = quote.bid_price + tick_size;
+    
+    // Only quote what keeps the position within max_inventory
+    quote.bid_size = std::clamp<Quantity>(config_.max_inventory - inventory, 0, config_.size);
+    quote.ask_size = std::clamp<Quantity>(config_.max_inventory + inventory, 0, config_.size);
+    return quote;
+}
+
+void MarketMaker::step(Price tick_size) noexcept {
+    if (config_.fair_step_ticks == 0) return;
+    uint64_t span = 2 * static_cast<uint64_t>(config_.fair_step_ticks) + 1;
+    int64_t ticks = static_cast<int64_t>(rng_() % span) - config_.fair_step_ticks;
+    fair_value_ = snap_to_tick(fair_value_ + ticks * tick_size, tick_size, false);
+}
+
+}  // namespace mmg
@@ -1,8 +1,18 @@
 #include "mmg/order_book.h"
 #include <algorithm>
+#include <set>
+#include <type_traits>
 
 namespace mmg {
 
+namespace {
+
+bool earlier(const std::shared_ptr<Order>& a, const std::shared_ptr<Order>& b) noexcept {
+    return a->timestamp != b->timestamp ? a->timestamp < b->timestamp : a->id < b->id;
+}
+
+}  // namespace
+
 OrderBook::OrderBook(InstrumentId instrument_id)
     : instrument_id_(instrument_id), last_price_(0) {}
 
@@ -23,11 +33,15 @@ std::vector<Fill> OrderBook::add_order(const std::shared_ptr<Order>& order) noex
     if (order->filled_quantity < order->quantity && order->tif != TimeInForce::IOC) {
         add_to_book(order);
         order->status = order->filled_quantity > 0 ? OrderStatus::PARTIAL : OrderStatus::PENDING;
-    } else if (order->filled_quantity >= order->quantity) {
+        return fills;
+    }
+    
+    if (order->filled_quantity >= order->quantity) {
         order->status = OrderStatus::FILLED;
     } else {
         order->status = OrderStatus::CANCELLED;  // IOC not fully filled
     }
+    orders_.erase(order->id);  // Never rested
     
     return fills;
 }
@@ -38,7 +52,7 @@ std::vector<Fill> OrderBook::match_order(std::shared_ptr<Order>& order) noexcept
     if (order->side == Side::BUY) {
         // Buying - match against asks (ascending order)
         while (order->filled_quantity < order->quantity && !asks_.empty()) {
-            auto& [price, orders_at_level] = *asks_.begin();
+            auto& [price, level] = *asks_.begin();
             
             // Check if price crosses
             if (order->price < price) break;
@@ -49,9 +63,12 @@ std::vector<Fill> OrderBook::match_order(std::shared_ptr<Order>& order) noexcept
                 return fills;
             }
             
-            // Match against orders at this level
-            while (!orders_at_level.empty() && order->filled_quantity < order->quantity) {
-                auto passive_order = orders_at_level.front();
+            // Match against orders at this level. An aggregated aggressor
+            // fill is opened here and its quantity summed below.
+            size_t level_fill = fills.size();
+            if (aggregate_fills_) fills.push_back(create_fill(order, level.orders.front(), price, 0, true));
+            while (!level.orders.empty() && order->filled_quantity < order->quantity) {
+                auto passive_order = level.orders.front();
                 
                 Quantity match_qty = std::min(
                     order->quantity - order->filled_quantity,
@@ -59,33 +76,41 @@ std::vector<Fill> OrderBook::match_order(std::shared_ptr<Order>& order) noexcept
                 );
                 
                 // Generate fills for both sides
-                fills.push_back(create_fill(order, passive_order, price, match_qty));
-                fills.push_back(create_fill(passive_order, order, price, match_qty));
+                if (aggregate_fills_) {
+                    fills[level_fill].quantity += match_qty;
+                } else {
+                    fills.push_back(create_fill(order, passive_order, price, match_qty, true));
+                }
+                fills.push_back(create_fill(passive_order, order, price, match_qty, false));
                 
                 order->filled_quantity += match_qty;
                 passive_order->filled_quantity += match_qty;
+                level.size -= match_qty;
+                notify_order(L3EventType::EXECUTE, *passive_order, match_qty);
                 
                 last_price_ = price;
                 
                 // Remove fully filled order
                 if (passive_order->filled_quantity >= passive_order->quantity) {
                     passive_order->status = OrderStatus::FILLED;
-                    orders_at_level.pop_front();
+                    level.orders.pop_front();
                     orders_.erase(passive_order->id);
                 } else {
                     passive_order->status = OrderStatus::PARTIAL;
                 }
             }
             
-            // Remove empty price level
-            if (orders_at_level.empty()) {
+            // One update per level touched, then drop it if emptied
+            notify(Side::SELL, price, level.size);
+            if (level.orders.empty()) {
                 asks_.erase(asks_.begin());
             }
+            refresh_top(Side::SELL);
         }
     } else {
         // Selling - match against bids (descending order)
         while (order->filled_quantity < order->quantity && !bids_.empty()) {
-            auto& [price, orders_at_level] = *bids_.begin();
+            auto& [price, level] = *bids_.begin();
             
             // Check if price crosses
             if (order->price > price) break;
@@ -96,9 +121,12 @@ std::vector<Fill> OrderBook::match_order(std::shared_ptr<Order>& order) noexcept
                 return fills;
             }
             
-            // Match against orders at this level
-            while (!orders_at_level.empty() && order->filled_quantity < order->quantity) {
-                auto passive_order = orders_at_level.front();
+            // Match against orders at this level. An aggregated aggressor
+            // fill is opened here and its quantity summed below.
+            size_t level_fill = fills.size();
+            if (aggregate_fills_) fills.push_back(create_fill(order, level.orders.front(), price, 0, true));
+            while (!level.orders.empty() && order->filled_quantity < order->quantity) {
+                auto passive_order = level.orders.front();
                 
                 Quantity match_qty = std::min(
                     order->quantity - order->filled_quantity,
@@ -106,28 +134,36 @@ std::vector<Fill> OrderBook::match_order(std::shared_ptr<Order>& order) noexcept
                 );
                 
                 // Generate fills for both sides
-                fills.push_back(create_fill(order, passive_order, price, match_qty));
-                fills.push_back(create_fill(passive_order, order, price, match_qty));
+                if (aggregate_fills_) {
+                    fills[level_fill].quantity += match_qty;
+                } else {
+                    fills.push_back(create_fill(order, passive_order, price, match_qty, true));
+                }
+                fills.push_back(create_fill(passive_order, order, price, match_qty, false));
                 
                 order->filled_quantity += match_qty;
                 passive_order->filled_quantity += match_qty;
+                level.size -= match_qty;
+                notify_order(L3EventType::EXECUTE, *passive_order, match_qty);
                 
                 last_price_ = price;
                 
                 // Remove fully filled order
                 if (passive_order->filled_quantity >= passive_order->quantity) {
                     passive_order->status = OrderStatus::FILLED;
-                    orders_at_level.pop_front();
+                    level.orders.pop_front();
                     orders_.erase(passive_order->id);
                 } else {
                     passive_order->status = OrderStatus::PARTIAL;
                 }
             }
             
-            // Remove empty price level
-            if (orders_at_level.empty()) {
+            // One update per level touched, then drop it if emptied
+            notify(Side::BUY, price, level.size);
+            if (level.orders.empty()) {
                 bids_.erase(bids_.begin());
             }
+            refresh_top(Side::BUY);
         }
     }
     
@@ -135,24 +171,50 @@ std::vector<Fill> OrderBook::match_order(std::shared_ptr<Order>& order) noexcept
 }
 
 void OrderBook::add_to_book(const std::shared_ptr<Order>& order) noexcept {
+    Level& level = order->side == Side::BUY ? bids_[order->price] : asks_[order->price];
+    level.orders.push_back(order);
+    level.size += order->quantity - order->filled_quantity;
+    refresh_top(order->side);
+    notify(order->side, order->price, level.size);
+    if (order_listener_) {
+        notify_order(L3EventType::ADD, *order, order->quantity - order->filled_quantity,
+                     static_cast<uint32_t>(level.orders.size() - 1));
+    }
+}
+
+void OrderBook::reduce_level(const std::shared_ptr<Order>& order, Quantity quantity,
+                             bool remove_order) noexcept {
+    auto reduce = [&](auto& levels) {
+        auto level_it = levels.find(order->price);
+        if (level_it == levels.end()) return;
+        Level& level = level_it->second;
+        level.size -= quantity;
+        if (remove_order) level.orders.remove(order);
+        notify(order->side, order->price, level.orders.empty() ? 0 : level.size);
+        if (level.orders.empty()) levels.erase(level_it);
+    };
+    
     if (order->side == Side::BUY) {
-        bids_[order->price].push_back(order);
+        reduce(bids_);
     } else {
-        asks_[order->price].push_back(order);
+        reduce(asks_);
     }
+    refresh_top(order->side);
 }
 
-Fill OrderBook::create_fill(const std::shared_ptr<Order>& aggressor,
-                            const std::shared_ptr<Order>& /* passive */,
-                            Price price, Quantity quantity) noexcept {
+Fill OrderBook::create_fill(const std::shared_ptr<Order>& order,
+                            const std::shared_ptr<Order>& counterparty,
+                            Price price, Quantity quantity, bool aggressor) noexcept {
     Fill fill;
-    fill.order_id = aggressor->id;
-    fill.user_id = aggressor->user_id;
+    fill.order_id = order->id;
+    fill.user_id = order->user_id;
     fill.instrument_id = instrument_id_;
-    fill.side = aggressor->side;
+    fill.side = order->side;
+    fill.aggressor = aggressor;
     fill.price = price;
     fill.quantity = quantity;
-    fill.timestamp = std::chrono::steady_clock::now();
+    // Matching happens when the newer order arrives; no clock read per fill
+    fill.timestamp_ns = to_nanos(std::max(order->timestamp, counterparty->timestamp));
     return fill;
 }
 
@@ -161,79 +223,172 @@ bool OrderBook::cancel_order(OrderId order_id) noexcept {
     if (it == orders_.end()) return false;
     
     auto order = it->second;
+    notify_order(L3EventType::DELETE, *order, order->quantity - order->filled_quantity);
+    reduce_level(order, order->quantity - order->filled_quantity, true);
     
-    // Remove from price level
-    if (order->side == Side::BUY) {
-        auto level_it = bids_.find(order->price);
-        if (level_it != bids_.end()) {
-            auto& orders_at_level = level_it->second;
-            orders_at_level.remove(order);
-            if (orders_at_level.empty()) {
-                bids_.erase(level_it);
+    order->status = OrderStatus::CANCELLED;
+    orders_.erase(it);
+    return true;
+}
+
+MemoryUsage OrderBook::memory_usage() const noexcept {
+    MemoryUsage usage;
+    usage += memory::of(bids_);
+    usage += memory::of(asks_);
+    for (const auto& [price, level] : bids_) usage += memory::of(level.orders);
+    for (const auto& [price, level] : asks_) usage += memory::of(level.orders);
+    usage += memory::of(orders_);
+    return usage;
+}
+
+std::vector<std::shared_ptr<Order>> OrderBook::clear() noexcept {
+    std::vector<std::shared_ptr<Order>> removed;
+    removed.reserve(orders_.size());
+    for (auto& [order_id, order] : orders_) {
+        order->status = OrderStatus::CANCELLED;
+        removed.push_back(order);
+    }
+    if (order_listener_) {
+        for (const auto& [price, level] : bids_) {
+            for (const auto& order : level.orders) {
+                notify_order(L3EventType::DELETE, *order, order->quantity - order->filled_quantity);
             }
         }
-    } else {
-        auto level_it = asks_.find(order->price);
-        if (level_it != asks_.end()) {
-            auto& orders_at_level = level_it->second;
-            orders_at_level.remove(order);
-            if (orders_at_level.empty()) {
-                asks_.erase(level_it);
+        for (const auto& [price, level] : asks_) {
+            for (const auto& order : level.orders) {
+                notify_order(L3EventType::DELETE, *order, order->quantity - order->filled_quantity);
             }
         }
     }
+    for (const auto& [price, level] : bids_) notify(Side::BUY, price, 0);
+    for (const auto& [price, level] : asks_) notify(Side::SELL, price, 0);
+    bids_.clear();
+    asks_.clear();
+    orders_.clear();
+    top_ = TopOfBook();
+    return removed;
+}
+
+std::vector<OrderId> OrderBook::retick(Price tick_size) noexcept {
+    std::vector<OrderId> repriced;
     
-    order->status = OrderStatus::CANCELLED;
-    orders_.erase(it);
-    return true;
+    auto rebuild = [&](auto& levels, bool round_up) {
+        std::remove_reference_t<decltype(levels)> rebuilt;
+        for (auto& [price, level] : levels) {
+            Price snapped = snap_to_tick(price, tick_size, round_up);
+            if (snapped != price) {
+                for (auto& order : level.orders) {
+                    order->price = snapped;
+                    repriced.push_back(order->id);
+                }
+            }
+            // Levels are FIFO, so merging by arrival keeps time priority
+            Level& target = rebuilt[snapped];
+            target.size += level.size;
+            target.orders.merge(level.orders, earlier);
+        }
+        levels.swap(rebuilt);
+        
+        // Moved orders in priority order, so inserting each at its position
+        // rebuilds every merged level
+        if (!order_listener_ || repriced.empty()) return;
+        std::set<OrderId> moved(repriced.begin(), repriced.end());
+        for (const auto& [price, level] : levels) {
+            uint32_t position = 0;
+            for (const auto& order : level.orders) {
+                if (moved.count(order->id)) {
+                    notify_order(L3EventType::MODIFY, *order,
+                                 order->quantity - order->filled_quantity, position);
+                }
+                ++position;
+            }
+        }
+    };
+    
+    rebuild(bids_, false);
+    rebuild(asks_, true);
+    refresh_top(Side::BUY);
+    refresh_top(Side::SELL);
+    return repriced;
 }
 
 MarketSnapshot OrderBook::get_snapshot(size_t depth) const noexcept {
     MarketSnapshot snapshot;
     snapshot.instrument_id = instrument_id_;
     snapshot.last_price = last_price_;
-    snapshot.timestamp = std::chrono::steady_clock::now();
-    
-    // Build bid levels
-    size_t count = 0;
-    for (const auto& [price, orders] : bids_) {
-        if (count >= depth) break;
-        Quantity total_size = 0;
-        for (const auto& order : orders) {
-            total_size += (order->quantity - order->filled_quantity);
-        }
-        if (total_size > 0) {
-            snapshot.bids.emplace_back(price, total_size);
-            count++;
-        }
+    snapshot.timestamp = std::chrono::system_clock::now();
+    
+    // Aggregates are maintained per level, so this is O(depth)
+    for (const auto& [price, level] : bids_) {
+        if (snapshot.bids.size() >= depth) break;
+        snapshot.bids.emplace_back(price, level.size);
+    }
+    for (const auto& [price, level] : asks_) {
+        if (snapshot.asks.size() >= depth) break;
+        snapshot.asks.emplace_back(price, level.size);
     }
     
-    // Build ask levels
-    count = 0;
-    for (const auto& [price, orders] : asks_) {
-        if (count >= depth) break;
-        Quantity total_size = 0;
-        for (const auto& order : orders) {
-            total_size += (order->quantity - order->filled_quantity);
+    return snapshot;
+}
+
+L3Snapshot OrderBook::get_l3_snapshot() const noexcept {
+    L3Snapshot snapshot;
+    snapshot.instrument_id = instrument_id_;
+    auto copy = [](const auto& levels, std::vector<L3Level>& out) {
+        out.reserve(levels.size());
+        for (const auto& [price, level] : levels) {
+            L3Level& l3 = out.emplace_back();
+            l3.price = price;
+            l3.orders.reserve(level.orders.size());
+            for (const auto& order : level.orders) {
+                l3.orders.push_back({order->id, order->quantity - order->filled_quantity});
+            }
         }
-        if (total_size > 0) {
-            snapshot.asks.emplace_back(price, total_size);
-            count++;
+    };
+    copy(bids_, snapshot.bids);
+    copy(asks_, snapshot.asks);
+    return snapshot;
+}
+
+Quantity OrderBook::available_quantity(Side side, Price limit, Quantity max_qty) const noexcept {
+    Quantity available = 0;
+    auto accumulate = [&](const auto& levels, auto crosses) {
+        for (const auto& [price, level] : levels) {
+            if (!crosses(price) || available >= max_qty) break;
+            available += level.size;
         }
-    }
+    };
     
-    return snapshot;
+    if (side == Side::BUY) {
+        accumulate(asks_, [limit](Price price) { return price <= limit; });
+    } else {
+        accumulate(bids_, [limit](Price price) { return price >= limit; });
+    }
+    return std::min(available, max_qty);
 }
 
-Price OrderBook::get_best_bid() const noexcept {
-    if (bids_.empty()) return 0;
-    return bids_.begin()->first;
+std::shared_ptr<Order> OrderBook::get_front_order(Side side) const noexcept {
+    if (side == Side::BUY) {
+        return bids_.empty() ? nullptr : bids_.begin()->second.orders.front();
+    }
+    return asks_.empty() ? nullptr : asks_.begin()->second.orders.front();
 }
 
-Price OrderBook::get_best_ask() const noexcept {
-    if (asks_.empty()) return 0;
-    return asks_.begin()->first;
+bool OrderBook::fill_resting(OrderId order_id, Quantity quantity, Price price) noexcept {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end()) return false;
+    
+    auto order = it->second;
+    order->filled_quantity += quantity;
+    last_price_ = price;
+    notify_order(L3EventType::EXECUTE, *order, quantity);
+    
+    // Fully filled orders drop from their level like the match loop does
+    bool filled = order->filled_quantity >= order->quantity;
+    order->status = filled ? OrderStatus::FILLED : OrderStatus::PARTIAL;
+    reduce_level(order, quantity, filled);
+    if (filled) orders_.erase(it);
+    return true;
 }
 
 }  // namespace mmg
-
@@ -0,0 +1,223 @@
+#include "mmg/replication.h"
+#include "mmg/command_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace mmg {
+
+namespace {
+
+bool make_address(const std::string& path, sockaddr_un& addr) noexcept {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+void set_nonblocking(int fd) noexcept {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+}  // namespace
+
+ReplicationServer::ReplicationServer(std::string path, size_t log_limit) noexcept
+    : path_(std::move(path)), log_limit_(log_limit) {
+    sockaddr_un addr;
+    if (!make_address(path_, addr)) return;
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    ::unlink(path_.c_str());  // Stale socket from an earlier primary
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        ::close(fd);
+        return;
+    }
+    set_nonblocking(fd);
+    listen_fd_ = fd;
+}
+
+ReplicationServer::~ReplicationServer() {
+    if (engine_) engine_->set_command_sink(nullptr);
+    for (const auto& replica : replicas_) ::close(replica.fd);
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(path_.c_str());
+    }
+}
+
+void ReplicationServer::attach(Engine& engine) noexcept {
+    engine_ = &engine;
+    engine.set_command_sink([this](const uint8_t* frame, size_t size) {
+        publish(frame, size);
+    });
+}
+
+void ReplicationServer::publish(const uint8_t* frame, size_t size) noexcept {
+    log_.insert(log_.end(), frame, frame + size);
+    if (!replicas_.empty()) {
+        flush();
+    } else {
+        trim_log();
+    }
+}
+
+void ReplicationServer::flush() noexcept {
+    if (listen_fd_ >= 0) {
+        int fd;
+        while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0) {
+            set_nonblocking(fd);
+            replicas_.push_back({fd, 0});
+        }
+    }
+    
+    for (size_t i = 0; i < replicas_.size();) {
+        Replica& replica = replicas_[i];
+        bool alive = true;
+        while (replica.sent < log_.size()) {
+            ssize_t n = send(replica.fd, log_.data() + replica.sent, log_.size() - replica.sent,
+                             kSendFlags);
+            if (n > 0) {
+                replica.sent += static_cast<size_t>(n);
+            } else {
+                // A full socket buffer just waits for the next flush
+                alive = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+                break;
+            }
+        }
+        if (alive) {
+            ++i;
+        } else {
+            ::close(replica.fd);
+            replicas_.erase(replicas_.begin() + i);
+        }
+    }
+    trim_log();
+}
+
+// Cuts at a frame boundary, and only once that frees half the log so the
+// erase stays amortized; with no replica connected nothing is waiting
+void ReplicationServer::trim_log() noexcept {
+    if (log_.size() <= log_limit_) return;
+    size_t delivered = log_.size();
+    for (const auto& replica : replicas_) delivered = std::min(delivered, replica.sent);
+    if (delivered < log_.size() / 2) return;
+    
+    size_t cut = 0;
+    while (log_.size() - cut >= sizeof(uint32_t)) {
+        uint32_t body = 0;
+        std::memcpy(&body, log_.data() + cut, sizeof(body));
+        size_t next = cut + sizeof(body) + body;
+        if (next > delivered) break;
+        cut = next;
+    }
+    if (cut < log_.size() / 2) return;
+    
+    log_.erase(log_.begin(), log_.begin() + cut);
+    log_start_ += cut;
+    for (auto& replica : replicas_) replica.sent -= cut;
+}
+
+ReplicationClient::ReplicationClient(Engine& engine, std::string path) noexcept
+    : engine_(engine), path_(std::move(path)) {}
+
+ReplicationClient::~ReplicationClient() {
+    close_stream();
+}
+
+bool ReplicationClient::connect() noexcept {
+    if (fd_ >= 0) return true;
+    sockaddr_un addr;
+    if (!make_address(path_, addr)) return false;
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    set_nonblocking(fd);
+    fd_ = fd;
+    return true;
+}
+
+void ReplicationClient::close_stream() noexcept {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+bool ReplicationClient::poll(int timeout_ms) noexcept {
+    if (fd_ < 0 || diverged_) return false;
+    
+    pollfd pfd{fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, timeout_ms) <= 0) return true;
+    
+    uint8_t chunk[64 * 1024];
+    while (true) {
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            buffer_.insert(buffer_.end(), chunk, chunk + n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        
+        // Primary gone: apply what arrived complete; a torn last frame never ran
+        apply_frames();
+        close_stream();
+        return false;
+    }
+    return apply_frames();
+}
+
+bool ReplicationClient::apply_frames() noexcept {
+    size_t offset = 0;
+    while (buffer_.size() - offset >= sizeof(uint32_t)) {
+        uint32_t body = 0;
+        std::memcpy(&body, buffer_.data() + offset, sizeof(body));
+        size_t size = sizeof(body) + body;
+        if (size < kCommandHeaderSize || size > kMaxCommandFrameSize) {
+            diverged_ = true;
+            break;
+        }
+        if (buffer_.size() - offset < size) break;
+        
+        const uint8_t* frame = buffer_.data() + offset;
+        if (!engine_.apply_command(frame, size)) {
+            diverged_ = true;
+            break;
+        }
+        if (static_cast<CommandType>(frame[kCommandHeaderSize - 1]) == CommandType::ANNOTATE) {
+            CommandReader in(frame + kCommandHeaderSize, size - kCommandHeaderSize);
+            std::string data;
+            in.get(data);
+            annotations_.push_back(std::move(data));
+        }
+        ++applied_;
+        offset += size;
+    }
+    buffer_.erase(buffer_.begin(), buffer_.begin() + offset);
+    if (diverged_) close_stream();
+    return !diverged_;
+}
+
+std::vector<std::string> ReplicationClient::take_annotations() noexcept {
+    std::vector<std::string> out;
+    out.swap(annotations_);
+    return out;
+}
+
+}  // namespace mmg
@@ -0,0 +1,202 @@
+#include "mmg/risk_engine.h"
+#include "mmg/pricing.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace mmg {
+
+namespace {
+
+using pricing::norm_cdf;
+using pricing::norm_pdf;
+
+UnderlyingRisk& entry_for(RiskReport& report, InstrumentId underlying_id,
+                          const std::map<InstrumentId, double>& spots,
+                          const std::vector<double>& moves) noexcept {
+    for (auto& u : report.underlyings) {
+        if (u.underlying_id == underlying_id) return u;
+    }
+
+    UnderlyingRisk u;
+    u.underlying_id = underlying_id;
+    auto it = spots.find(underlying_id);
+    u.spot = it != spots.end() ? it->second : 0.0;
+
+    // Without a spot there is nothing to center the grid on
+    if (u.spot > 0.0) {
+        u.scenario_spots.reserve(moves.size());
+        for (double move : moves) {
+            u.scenario_spots.push_back(u.spot * (1.0 + move));
+        }
+        u.scenario_pnl.assign(moves.size(), 0.0);
+    }
+
+    report.underlyings.push_back(std::move(u));
+    return report.underlyings.back();
+}
+
+}  // namespace
+
+size_t RiskEngine::ChainPositions::slot(const InstrumentSpec& inst) noexcept {
+    auto it = slot_of.find(inst.id);
+    if (it != slot_of.end()) return it->second;
+
+    size_t index = qty.size();
+    bool is_option = inst.type != InstrumentType::SCALAR;
+
+    instrument_id.push_back(inst.id);
+    underlying_id.push_back(is_option ? inst.reference_id : inst.id);
+    strike.push_back(is_option ? inst.to_decimal(inst.strike) : 0.0);
+    cp_sign.push_back(inst.type == InstrumentType::CALL ? 1.0 :
+                      inst.type == InstrumentType::PUT ? -1.0 : 0.0);
+    linear.push_back(is_option ? 0.0 : 1.0);
+    multiplier.push_back(inst.tick_value);
+    qty.push_back(0.0);
+    cash.push_back(0.0);
+
+    slot_of[inst.id] = index;
+    return index;
+}
+
+void RiskEngine::on_fill(UserId user_id, const InstrumentSpec& inst,
+                         Quantity signed_qty, double price) noexcept {
+    auto& chain = users_[user_id];
+    size_t i = chain.slot(inst);
+
+    double qty = static_cast<double>(signed_qty);
+    chain.qty[i] += qty;
+    chain.cash[i] -= qty * price * chain.multiplier[i];
+}
+
+void RiskEngine::on_settle(const InstrumentSpec& inst, double settlement_value) noexcept {
+    for (auto& [user_id, chain] : users_) {
+        auto it = chain.slot_of.find(inst.id);
+        if (it == chain.slot_of.end()) continue;
+
+        size_t i = it->second;
+        double payoff = chain.linear[i] * settlement_value +
+            (1.0 - chain.linear[i]) * std::max(0.0, chain.cp_sign[i] * (settlement_value - chain.strike[i]));
+        chain.cash[i] += chain.qty[i] * payoff * chain.multiplier[i];
+        chain.qty[i] = 0.0;
+    }
+}
+
+void RiskEngine::accumulate(const ChainPositions& chain,
+                            const std::map<InstrumentId, double>& spots,
+                            RiskReport& report) const noexcept {
+    const double vol = params_.volatility;
+    const double t = params_.time_to_expiry;
+    const double r = params_.rate;
+    const bool has_model = vol > 0.0 && t > 0.0;
+    const double sqrt_t = has_model ? std::sqrt(t) : 0.0;
+
+    for (size_t i = 0; i < chain.qty.size(); ++i) {
+        UnderlyingRisk& u = entry_for(report, chain.underlying_id[i], spots, params_.scenario_moves);
+
+        const double qty = chain.qty[i];
+        const double mult = chain.multiplier[i];
+        const double lin = chain.linear[i];
+        const double cp = chain.cp_sign[i];
+        const double k = chain.strike[i];
+        const double cash = chain.cash[i];
+
+        // Scenario grid: branch-free payoff so the inner loop vectorizes
+        const size_t grid = u.scenario_pnl.size();
+        const double* s = u.scenario_spots.data();
+        double* pnl = u.scenario_pnl.data();
+        for (size_t g = 0; g < grid; ++g) {
+            double payoff = lin * s[g] + (1.0 - lin) * std::max(0.0, cp * (s[g] - k));
+            pnl[g] += cash + qty * mult * payoff;
+        }
+
+        if (qty == 0.0) continue;
+
+        // Greeks at the current spot
+        const double notional = qty * mult;
+        if (lin != 0.0) {
+            u.delta += notional;
+            continue;
+        }
+        if (u.spot <= 0.0) continue;
+
+        if (!has_model || k <= 0.0) {
+            // Expired or degenerate: delta is the intrinsic indicator
+            double itm = cp * (u.spot - k) > 0.0 ? 1.0 : 0.0;
+            u.delta += notional * cp * itm;
+            continue;
+        }
+
+        double d1 = (std::log(u.spot / k) + (r + 0.5 * vol * vol) * t) / (vol * sqrt_t);
+        double d2 = d1 - vol * sqrt_t;
+        double pdf = norm_pdf(d1);
+        double discount = std::exp(-r * t);
+
+        double delta = cp > 0.0 ? norm_cdf(d1) : norm_cdf(d1) - 1.0;
+        double gamma = pdf / (u.spot * vol * sqrt_t);
+        double vega = u.spot * pdf * sqrt_t;
+        double theta = -u.spot * pdf * vol / (2.0 * sqrt_t) -
+            cp * r * k * discount * norm_cdf(cp * d2);
+
+        u.delta += notional * delta;
+        u.gamma += notional * gamma;
+        u.vega += notional * vega;
+        u.theta += notional * theta;
+    }
+}
+
+RiskReport RiskEngine::evaluate_user(UserId user_id,
+                                     const std::map<InstrumentId, double>& spots) const noexcept {
+    RiskReport report;
+    report.user_id = user_id;
+
+    auto it = users_.find(user_id);
+    if (it != users_.end()) {
+        accumulate(it->second, spots, report);
+    }
+
+    std::sort(report.underlyings.begin(), report.underlyings.end(),
+              [](const UnderlyingRisk& a, const UnderlyingRisk& b) {
+                  return a.underlying_id < b.underlying_id;
+              });
+    return report;
+}
+
+RiskReport RiskEngine::evaluate_room(const std::map<InstrumentId, double>& spots) const noexcept {
+    RiskReport report;
+    for (const auto& [user_id, chain] : users_) {
+        accumulate(chain, spots, report);
+    }
+
+    std::sort(report.underlyings.begin(), report.underlyings.end(),
+              [](const UnderlyingRisk& a, const UnderlyingRisk& b) {
+                  return a.underlying_id < b.underlying_id;
+              });
+    return report;
+}
+
+MemoryUsage RiskEngine::memory_usage() const noexcept {
+    MemoryUsage usage = memory::of(users_);
+    for (const auto& [user_id, chain] : users_) {
+        usage += memory::of(chain.instrument_id);
+        usage += memory::of(chain.underlying_id);
+        usage += memory::of(chain.strike);
+        usage += memory::of(chain.cp_sign);
+        usage += memory::of(chain.linear);
+        usage += memory::of(chain.multiplier);
+        usage += memory::of(chain.qty);
+        usage += memory::of(chain.cash);
+        usage += memory::of(chain.slot_of);
+    }
+    return usage;
+}
+
+std::vector<InstrumentId> RiskEngine::get_underlyings() const noexcept {
+    std::set<InstrumentId> ids;
+    for (const auto& [user_id, chain] : users_) {
+        ids.insert(chain.underlying_id.begin(), chain.underlying_id.end());
+    }
+    return std::vector<InstrumentId>(ids.begin(), ids.end());
+}
+
+}  // namespace mmg
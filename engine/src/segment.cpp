@@ -0,0 +1,415 @@
+#include "mmg/segment.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace mmg {
+namespace segment {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'M', 'M', 'G', 'S'};
+constexpr uint8_t kVersion = 2;  // 2: fills carry seq and the aggressor flag
+
+using Bytes = std::vector<uint8_t>;
+using Column = std::vector<uint64_t>;
+
+// Encoding
+
+uint64_t zigzag(uint64_t delta) noexcept {
+    int64_t v = static_cast<int64_t>(delta);
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+uint64_t unzigzag(uint64_t v) noexcept {
+    return (v >> 1) ^ (~(v & 1) + 1);
+}
+
+void put_varint(Bytes& out, uint64_t v) noexcept {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void put_column(Bytes& out, const Bytes& column) noexcept {
+    put_varint(out, column.size());
+    out.insert(out.end(), column.begin(), column.end());
+}
+
+// Differences from the previous row, wrapping, so any 64-bit values round trip
+void delta_column(Bytes& out, const Column& values) noexcept {
+    Bytes column;
+    uint64_t prev = 0;
+    for (uint64_t v : values) {
+        put_varint(column, zigzag(v - prev));
+        prev = v;
+    }
+    put_column(out, column);
+}
+
+void varint_column(Bytes& out, const Column& values) noexcept {
+    Bytes column;
+    for (uint64_t v : values) put_varint(column, v);
+    put_column(out, column);
+}
+
+// Distinct values in first-seen order, then one index per row
+void dict_column(Bytes& out, const Column& values) noexcept {
+    std::map<uint64_t, uint64_t> index;
+    Column dictionary;
+    Bytes rows;
+    for (uint64_t v : values) {
+        auto [it, added] = index.emplace(v, dictionary.size());
+        if (added) dictionary.push_back(v);
+        put_varint(rows, it->second);
+    }
+    Bytes column;
+    put_varint(column, dictionary.size());
+    for (uint64_t v : dictionary) put_varint(column, v);
+    column.insert(column.end(), rows.begin(), rows.end());
+    put_column(out, column);
+}
+
+void bit_column(Bytes& out, const Column& values) noexcept {
+    Bytes column((values.size() + 7) / 8, 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i]) column[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+    }
+    put_column(out, column);
+}
+
+Bytes finish(Kind kind, size_t rows, const Bytes& columns, Compression compression) noexcept {
+    Bytes out(std::begin(kMagic), std::end(kMagic));
+    out.push_back(kVersion);
+    out.push_back(static_cast<uint8_t>(kind));
+    out.push_back(static_cast<uint8_t>(compression));
+    put_varint(out, rows);
+    put_varint(out, columns.size());
+    if (compression == Compression::LZ) {
+        Bytes packed = lz_compress(columns.data(), columns.size());
+        out.insert(out.end(), packed.begin(), packed.end());
+    } else {
+        out.insert(out.end(), columns.begin(), columns.end());
+    }
+    return out;
+}
+
+// Decoding. Every read is bounds checked; a failed read poisons the reader.
+
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+    
+    size_t remaining() const noexcept { return static_cast<size_t>(end - p); }
+    
+    uint8_t byte() noexcept {
+        if (p == end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+    
+    uint64_t varint() noexcept {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+    
+    // The next length-prefixed column as its own reader
+    Reader column() noexcept {
+        uint64_t length = varint();
+        if (!ok || length > remaining()) {
+            ok = false;
+            return Reader{end, end, false};
+        }
+        Reader column{p, p + length};
+        p += length;
+        return column;
+    }
+};
+
+bool read_delta(Reader& in, size_t rows, Column& out) noexcept {
+    Reader column = in.column();
+    uint64_t prev = 0;
+    out.resize(rows);
+    for (auto& v : out) v = prev += unzigzag(column.varint());
+    return column.ok && column.p == column.end;
+}
+
+bool read_varint(Reader& in, size_t rows, Column& out) noexcept {
+    Reader column = in.column();
+    out.resize(rows);
+    for (auto& v : out) v = column.varint();
+    return column.ok && column.p == column.end;
+}
+
+bool read_dict(Reader& in, size_t rows, Column& out) noexcept {
+    Reader column = in.column();
+    uint64_t entries = column.varint();
+    if (!column.ok || entries > column.remaining()) return false;
+    Column dictionary(entries);
+    for (auto& v : dictionary) v = column.varint();
+    out.resize(rows);
+    for (auto& v : out) {
+        uint64_t index = column.varint();
+        if (index >= dictionary.size()) return false;
+        v = dictionary[index];
+    }
+    return column.ok && column.p == column.end;
+}
+
+bool read_bits(Reader& in, size_t rows, Column& out) noexcept {
+    Reader column = in.column();
+    if (column.remaining() != (rows + 7) / 8) return false;
+    out.resize(rows);
+    for (size_t i = 0; i < rows; ++i) out[i] = (column.p[i / 8] >> (i % 8)) & 1;
+    return column.ok;
+}
+
+// Checks the header and returns the (decompressed) column block
+bool open(const uint8_t* data, size_t size, Kind kind, size_t& rows, Bytes& columns) noexcept {
+    Reader in{data, data + size};
+    for (uint8_t m : kMagic) {
+        if (in.byte() != m) return false;
+    }
+    if (in.byte() != kVersion || in.byte() != static_cast<uint8_t>(kind)) return false;
+    uint8_t compression = in.byte();
+    uint64_t row_count = in.varint();
+    uint64_t raw_size = in.varint();
+    if (!in.ok || row_count > raw_size) return false;  // Every row costs at least a byte
+    rows = static_cast<size_t>(row_count);
+    
+    if (compression == static_cast<uint8_t>(Compression::LZ)) {
+        return lz_decompress(in.p, in.remaining(), raw_size, columns);
+    }
+    if (compression != static_cast<uint8_t>(Compression::NONE) || raw_size != in.remaining()) {
+        return false;
+    }
+    columns.assign(in.p, in.end);
+    return true;
+}
+
+// LZ block format: a sequence is a token (literal count high nibble, match
+// length - 4 low nibble, 15 meaning "more follows as 255-capped bytes"), the
+// literals, then a 2-byte little-endian offset. The last sequence is
+// literals only.
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 14;
+
+void put_length(Bytes& out, size_t length) noexcept {
+    for (; length >= 255; length -= 255) out.push_back(255);
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+void put_sequence(Bytes& out, const uint8_t* literals, size_t literal_count,
+                  size_t match_length, size_t offset) noexcept {
+    size_t match_code = match_length ? match_length - kMinMatch : 0;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(literal_count, 15) << 4) |
+                                       std::min<size_t>(match_code, 15)));
+    if (literal_count >= 15) put_length(out, literal_count - 15);
+    out.insert(out.end(), literals, literals + literal_count);
+    if (!match_length) return;
+    out.push_back(static_cast<uint8_t>(offset));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match_code >= 15) put_length(out, match_code - 15);
+}
+
+bool read_length(Reader& in, size_t& length) noexcept {
+    uint8_t b;
+    do {
+        b = in.byte();
+        length += b;
+    } while (b == 255 && in.ok);
+    return in.ok;
+}
+
+}  // namespace
+
+std::vector<uint8_t> encode_fills(const std::vector<Fill>& fills,
+                                  Compression compression) noexcept {
+    Column seqs, timestamps, order_ids, users, instruments, sides, aggressors, prices, quantities;
+    for (const auto& fill : fills) {
+        seqs.push_back(fill.seq);
+        timestamps.push_back(static_cast<uint64_t>(fill.timestamp_ns));
+        order_ids.push_back(fill.order_id);
+        users.push_back(fill.user_id);
+        instruments.push_back(fill.instrument_id);
+        sides.push_back(fill.side == Side::SELL);
+        aggressors.push_back(fill.aggressor);
+        prices.push_back(static_cast<uint64_t>(fill.price));
+        quantities.push_back(static_cast<uint64_t>(fill.quantity));
+    }
+    
+    Bytes columns;
+    delta_column(columns, seqs);
+    delta_column(columns, timestamps);
+    delta_column(columns, order_ids);
+    dict_column(columns, users);
+    dict_column(columns, instruments);
+    bit_column(columns, sides);
+    bit_column(columns, aggressors);
+    delta_column(columns, prices);
+    varint_column(columns, quantities);
+    return finish(Kind::FILLS, fills.size(), columns, compression);
+}
+
+std::vector<uint8_t> encode_journal(const std::vector<JournalRecord>& records,
+                                    Compression compression) noexcept {
+    Column seqs, timestamps, instruments, sides, prices, sizes;
+    for (const auto& record : records) {
+        seqs.push_back(record.seq);
+        timestamps.push_back(static_cast<uint64_t>(to_nanos(record.timestamp)));
+        instruments.push_back(record.level.instrument_id);
+        sides.push_back(record.level.side == Side::SELL);
+        prices.push_back(static_cast<uint64_t>(record.level.price));
+        sizes.push_back(static_cast<uint64_t>(record.level.size));
+    }
+    
+    Bytes columns;
+    delta_column(columns, seqs);
+    delta_column(columns, timestamps);
+    dict_column(columns, instruments);
+    bit_column(columns, sides);
+    delta_column(columns, prices);
+    varint_column(columns, sizes);
+    return finish(Kind::JOURNAL, records.size(), columns, compression);
+}
+
+bool decode_fills(const uint8_t* data, size_t size, std::vector<Fill>& out) noexcept {
+    out.clear();
+    size_t rows = 0;
+    Bytes block;
+    if (!open(data, size, Kind::FILLS, rows, block)) return false;
+    
+    Reader in{block.data(), block.data() + block.size()};
+    Column seqs, timestamps, order_ids, users, instruments, sides, aggressors, prices, quantities;
+    if (!read_delta(in, rows, seqs) || !read_delta(in, rows, timestamps) ||
+        !read_delta(in, rows, order_ids) ||
+        !read_dict(in, rows, users) || !read_dict(in, rows, instruments) ||
+        !read_bits(in, rows, sides) || !read_bits(in, rows, aggressors) ||
+        !read_delta(in, rows, prices) || !read_varint(in, rows, quantities) || in.p != in.end) {
+        return false;
+    }
+    
+    out.resize(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        Fill& fill = out[i];
+        fill.seq = seqs[i];
+        fill.timestamp_ns = static_cast<int64_t>(timestamps[i]);
+        fill.order_id = order_ids[i];
+        fill.user_id = static_cast<UserId>(users[i]);
+        fill.instrument_id = static_cast<InstrumentId>(instruments[i]);
+        fill.side = sides[i] ? Side::SELL : Side::BUY;
+        fill.aggressor = aggressors[i] != 0;
+        fill.price = static_cast<Price>(prices[i]);
+        fill.quantity = static_cast<Quantity>(quantities[i]);
+    }
+    return true;
+}
+
+bool decode_journal(const uint8_t* data, size_t size, std::vector<JournalRecord>& out) noexcept {
+    out.clear();
+    size_t rows = 0;
+    Bytes block;
+    if (!open(data, size, Kind::JOURNAL, rows, block)) return false;
+    
+    Reader in{block.data(), block.data() + block.size()};
+    Column seqs, timestamps, instruments, sides, prices, sizes;
+    if (!read_delta(in, rows, seqs) || !read_delta(in, rows, timestamps) ||
+        !read_dict(in, rows, instruments) || !read_bits(in, rows, sides) ||
+        !read_delta(in, rows, prices) || !read_varint(in, rows, sizes) || in.p != in.end) {
+        return false;
+    }
+    
+    out.resize(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        JournalRecord& record = out[i];
+        record.seq = seqs[i];
+        record.timestamp = from_nanos(static_cast<int64_t>(timestamps[i]));
+        record.level.instrument_id = static_cast<InstrumentId>(instruments[i]);
+        record.level.side = sides[i] ? Side::SELL : Side::BUY;
+        record.level.price = static_cast<Price>(prices[i]);
+        record.level.size = static_cast<Quantity>(sizes[i]);
+    }
+    return true;
+}
+
+std::vector<uint8_t> lz_compress(const uint8_t* data, size_t size) noexcept {
+    Bytes out;
+    out.reserve(size / 2 + 16);
+    std::vector<size_t> table(size_t(1) << kHashBits, SIZE_MAX);
+    
+    auto load32 = [data](size_t pos) {
+        uint32_t v;
+        std::memcpy(&v, data + pos, sizeof(v));
+        return v;
+    };
+    
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + kMinMatch <= size) {
+        uint32_t word = load32(pos);
+        size_t& slot = table[(word * 2654435761u) >> (32 - kHashBits)];
+        size_t candidate = slot;
+        slot = pos;
+        if (candidate == SIZE_MAX || pos - candidate > kMaxOffset || load32(candidate) != word) {
+            ++pos;
+            continue;
+        }
+        
+        size_t length = kMinMatch;
+        while (pos + length < size && data[candidate + length] == data[pos + length]) ++length;
+        put_sequence(out, data + anchor, pos - anchor, length, pos - candidate);
+        pos += length;
+        anchor = pos;
+    }
+    put_sequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool lz_decompress(const uint8_t* data, size_t size, size_t raw_size,
+                   std::vector<uint8_t>& out) noexcept {
+    out.clear();
+    // A sequence expands at most ~255x, so larger claims are corrupt
+    if (raw_size / 255 > size) return false;
+    out.resize(raw_size);
+    
+    Reader in{data, data + size};
+    size_t written = 0;
+    while (in.ok && in.p != in.end) {
+        uint8_t token = in.byte();
+        size_t literal_count = token >> 4;
+        if (literal_count == 15 && !read_length(in, literal_count)) break;
+        if (literal_count > in.remaining() || literal_count > raw_size - written) break;
+        std::memcpy(out.data() + written, in.p, literal_count);
+        in.p += literal_count;
+        written += literal_count;
+        if (in.p == in.end) return written == raw_size;  // Final literals-only sequence
+        
+        size_t offset = in.byte();
+        offset |= static_cast<size_t>(in.byte()) << 8;
+        size_t length = token & 15;
+        if (length == 15 && !read_length(in, length)) break;
+        length += kMinMatch;
+        if (!in.ok || offset == 0 || offset > written || length > raw_size - written) break;
+        
+        // Byte by byte: a match may overlap the bytes it produces
+        for (size_t i = 0; i < length; ++i, ++written) out[written] = out[written - offset];
+    }
+    out.clear();
+    return false;
+}
+
+}  // namespace segment
+}  // namespace mmg
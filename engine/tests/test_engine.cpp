@@ -1,5 +1,7 @@
 #include "mmg/engine.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
 
 using namespace mmg;
 
@@ -32,6 +34,22 @@ protected:
         req.post_only = false;
         return req;
     }
+    
+    // Drained events, none of which the ring dropped
+    std::vector<EngineEvent> drain() {
+        std::vector<EngineEvent> events;
+        EXPECT_TRUE(engine->drain_events(events));
+        return events;
+    }
+    
+    // Drained events minus the per-level market data deltas
+    std::vector<EngineEvent> drain_without_levels() {
+        std::vector<EngineEvent> events;
+        for (auto& event : drain()) {
+            if (event.type != EngineEventType::LEVEL_UPDATE) events.push_back(std::move(event));
+        }
+        return events;
+    }
 };
 
 TEST_F(EngineTest, AddInstrument) {
@@ -48,6 +66,21 @@ TEST_F(EngineTest, AddInstrument) {
     EXPECT_EQ(inst->symbol, "TEST2");
 }
 
+TEST_F(EngineTest, AddInstrumentRejectsNonPositiveTick) {
+    InstrumentSpec spec;
+    spec.id = 2;
+    spec.tick_size = 0;
+    EXPECT_FALSE(engine->add_instrument(spec));
+    spec.tick_size = -5;
+    EXPECT_FALSE(engine->add_instrument(spec));
+    EXPECT_EQ(engine->get_instrument(2), nullptr);
+    
+    // Orders on the refused id are rejected, not divided by a zero tick
+    auto request = create_request(1, Side::BUY, 10000, 1);
+    request.instrument_id = 2;
+    EXPECT_FALSE(engine->submit_order(request).success);
+}
+
 TEST_F(EngineTest, HaltInstrument) {
     EXPECT_TRUE(engine->halt_instrument(1, true));
     
@@ -158,7 +191,8 @@ TEST_F(EngineTest, TradeHistory) {
     engine->submit_order(create_request(1, Side::BUY, 10000, 100));
     engine->submit_order(create_request(2, Side::SELL, 10000, 100));
     
-    const auto& history = engine->get_trade_history();
+    auto history = engine->get_trade_history();
+    EXPECT_EQ(engine->trade_count(), 1);
     EXPECT_EQ(history.size(), 1);
     EXPECT_EQ(history[0].buyer_id, 1);
     EXPECT_EQ(history[0].seller_id, 2);
@@ -166,3 +200,540 @@ TEST_F(EngineTest, TradeHistory) {
     EXPECT_EQ(history[0].quantity, 100);
 }
 
+TEST_F(EngineTest, HistoryRecordsCarrySeqAndWallTime) {
+    int64_t before = to_nanos(std::chrono::system_clock::now());
+    engine->submit_order(create_request(1, Side::BUY, 10000, 100));
+    auto sell = engine->submit_order(create_request(2, Side::SELL, 10000, 100));
+    int64_t after = to_nanos(std::chrono::system_clock::now());
+    
+    // Fills carry their FILL event's seq, in the result and in history
+    std::vector<uint64_t> fill_seqs;
+    for (const auto& event : drain()) {
+        if (event.type == EngineEventType::FILL) fill_seqs.push_back(event.seq);
+    }
+    const auto& fills = engine->get_fill_history();
+    ASSERT_EQ(fills.size(), 2);
+    ASSERT_EQ(fill_seqs.size(), 2);
+    for (size_t i = 0; i < fills.size(); ++i) {
+        EXPECT_EQ(fills[i].seq, fill_seqs[i]);
+        EXPECT_EQ(sell.fills[i].seq, fill_seqs[i]);
+        EXPECT_GE(fills[i].timestamp_ns, before);
+        EXPECT_LE(fills[i].timestamp_ns, after);
+    }
+    
+    EXPECT_TRUE(fills[0].aggressor);
+    EXPECT_FALSE(fills[1].aggressor);
+    
+    // The acks carry their ORDER_ACCEPTED seq, ahead of the fills it led to
+    EXPECT_GT(sell.seq, 0);
+    EXPECT_LT(sell.seq, fills[0].seq);
+    
+    auto trade = engine->get_trade_history()[0];
+    EXPECT_EQ(trade.seq, fills[1].seq);
+    EXPECT_EQ(trade.timestamp_ns, fills[1].timestamp_ns);
+    EXPECT_EQ(trade.aggressor_side, Side::SELL);
+    
+    // Records copy out as raw bytes with no stray padding
+    std::vector<uint8_t> bytes(fills.size() * sizeof(Fill));
+    std::memcpy(bytes.data(), fills.data(), bytes.size());
+    std::vector<Fill> copied(fills.size());
+    std::memcpy(copied.data(), bytes.data(), bytes.size());
+    EXPECT_EQ(copied[1].order_id, fills[1].order_id);
+    EXPECT_EQ(copied[1].quantity, fills[1].quantity);
+    for (uint8_t b : copied[1].reserved) EXPECT_EQ(b, 0);
+}
+
+TEST_F(EngineTest, SweepAggregatesAggressorFills) {
+    Engine plain;
+    InstrumentSpec spec;
+    spec.id = 1;
+    plain.add_instrument(spec);
+    engine->set_aggregate_fills(true);
+    
+    for (Engine* e : {engine.get(), &plain}) {
+        e->submit_order(create_request(2, Side::SELL, 10000, 10));
+        e->submit_order(create_request(3, Side::SELL, 10000, 20));
+        e->submit_order(create_request(4, Side::SELL, 10100, 5));
+        e->submit_order(create_request(5, Side::SELL, 10100, 5));
+    }
+    auto sweep = engine->submit_order(create_request(1, Side::BUY, 10100, 40));
+    plain.submit_order(create_request(1, Side::BUY, 10100, 40));
+    
+    // One aggressor fill per level, each ahead of the passive fills it took
+    ASSERT_EQ(sweep.fills.size(), 6);
+    EXPECT_EQ(plain.get_fill_history().size(), 8);
+    const std::vector<std::pair<UserId, Quantity>> expected = {
+        {1, 30}, {2, 10}, {3, 20}, {1, 10}, {4, 5}, {5, 5}};
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(sweep.fills[i].user_id, expected[i].first);
+        EXPECT_EQ(sweep.fills[i].quantity, expected[i].second);
+        EXPECT_EQ(sweep.fills[i].aggressor, expected[i].first == 1);
+    }
+    EXPECT_EQ(sweep.fills[3].price, 10100);
+    for (size_t i = 1; i < sweep.fills.size(); ++i) {
+        EXPECT_LT(sweep.fills[i - 1].seq, sweep.fills[i].seq);
+    }
+    
+    // The tape, positions and order states are the same as without aggregation
+    auto trades = engine->get_trade_history();
+    auto reference_trades = plain.get_trade_history();
+    ASSERT_EQ(trades.size(), reference_trades.size());
+    for (size_t i = 0; i < trades.size(); ++i) {
+        EXPECT_EQ(trades[i].seller_id, reference_trades[i].seller_id);
+        EXPECT_EQ(trades[i].buyer_id, 1);
+        EXPECT_EQ(trades[i].price, reference_trades[i].price);
+        EXPECT_EQ(trades[i].quantity, reference_trades[i].quantity);
+    }
+    for (UserId user = 1; user <= 5; ++user) {
+        auto positions = engine->get_positions(user);
+        auto reference = plain.get_positions(user);
+        ASSERT_EQ(positions.size(), reference.size());
+        EXPECT_EQ(positions[0].net_qty, reference[0].net_qty);
+        // Fixed-point VWAP rounds per fill, so fewer fills can only move it by one
+        EXPECT_NEAR(positions[0].vwap, reference[0].vwap, 1);
+    }
+    EXPECT_TRUE(engine->get_user_orders(2).empty());
+    EXPECT_EQ(engine->get_snapshot(1).asks.size(), 0);
+}
+
+
+TEST_F(EngineTest, SubmitPackage) {
+    InstrumentSpec spec;
+    spec.id = 2;
+    spec.symbol = "HEDGE";
+    engine->add_instrument(spec);
+    
+    engine->submit_order(create_request(2, Side::SELL, 10000, 50));
+    
+    auto hedge = create_request(1, Side::SELL, 500, 20);
+    hedge.instrument_id = 2;
+    auto result = engine->submit_package({create_request(1, Side::BUY, 10000, 50), hedge});
+    
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.order_ids.size(), 2);
+    EXPECT_EQ(result.fills.size(), 2);  // Only the first leg crosses
+    EXPECT_EQ(engine->get_orders(2).size(), 1);  // Second leg rests
+    EXPECT_EQ(engine->get_stats().total_orders, 3);
+}
+
+TEST_F(EngineTest, IocPackageIsAllOrNone) {
+    InstrumentSpec spec;
+    spec.id = 2;
+    spec.symbol = "HEDGE";
+    engine->add_instrument(spec);
+    
+    engine->submit_order(create_request(2, Side::SELL, 10000, 50));
+    auto bid = create_request(3, Side::BUY, 500, 10);
+    bid.instrument_id = 2;
+    engine->submit_order(bid);
+    
+    auto leg1 = create_request(1, Side::BUY, 10000, 50);
+    auto leg2 = create_request(1, Side::SELL, 500, 20);
+    leg2.instrument_id = 2;
+    leg1.tif = leg2.tif = TimeInForce::IOC;
+    
+    // Second leg only has 10 available, so nothing executes
+    auto result = engine->submit_package({leg1, leg2});
+    EXPECT_FALSE(result.success);
+    EXPECT_TRUE(result.fills.empty());
+    EXPECT_TRUE(engine->get_positions(1).empty());
+    EXPECT_EQ(engine->get_snapshot(1).asks[0].size, 50);
+    
+    leg2.quantity = 10;
+    result = engine->submit_package({leg1, leg2});
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.fills.size(), 4);
+    EXPECT_EQ(engine->get_positions(1).size(), 2);
+}
+
+TEST_F(EngineTest, PackageValidation) {
+    InstrumentSpec spec;
+    spec.id = 2;
+    spec.symbol = "HEDGE";
+    engine->add_instrument(spec);
+    
+    auto leg1 = create_request(1, Side::BUY, 10000, 10);
+    auto leg2 = create_request(1, Side::SELL, 500, 10);
+    leg2.instrument_id = 2;
+    
+    EXPECT_FALSE(engine->submit_package({}).success);
+    EXPECT_FALSE(engine->submit_package({leg1, leg1}).success);  // Same instrument twice
+    
+    auto other_user = leg2;
+    other_user.user_id = 2;
+    EXPECT_FALSE(engine->submit_package({leg1, other_user}).success);
+    
+    // A halted leg rejects the whole package
+    engine->halt_instrument(2, true);
+    auto result = engine->submit_package({leg1, leg2});
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.error_message, "Instrument is halted");
+    EXPECT_TRUE(engine->get_orders(1).empty());
+    engine->halt_instrument(2, false);
+    
+    // Combined notional: 100.00 * 10 + 5.00 * 10 exceeds 1000
+    RiskLimits limits;
+    limits.max_notional = 1000.0;
+    engine->set_risk_limits(1, limits);
+    result = engine->submit_package({leg1, leg2});
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.error_message, "Risk limit exceeded");
+}
+
+TEST_F(EngineTest, AdminBatchSettlesChain) {
+    InstrumentSpec call;
+    call.id = 2;
+    call.symbol = "CALL";
+    call.type = InstrumentType::CALL;
+    call.reference_id = 1;
+    call.strike = 9000;
+    engine->add_instrument(call);
+    
+    engine->submit_order(create_request(1, Side::BUY, 10000, 10));
+    engine->submit_order(create_request(2, Side::SELL, 10000, 10));
+    auto call_bid = create_request(1, Side::BUY, 500, 4);
+    call_bid.instrument_id = 2;
+    engine->submit_order(call_bid);
+    auto call_ask = create_request(2, Side::SELL, 500, 4);
+    call_ask.instrument_id = 2;
+    engine->submit_order(call_ask);
+    auto resting = engine->submit_order(create_request(3, Side::BUY, 9000, 5));
+    
+    auto result = engine->apply_admin_batch({
+        AdminAction(AdminActionType::HALT, 1),
+        AdminAction(AdminActionType::SETTLE_CHAIN, 1, 11000)
+    });
+    ASSERT_TRUE(result.success);
+    
+    ASSERT_EQ(result.changes.size(), 3);  // Halt, underlying, call
+    EXPECT_EQ(result.changes[2].instrument_id, 2);
+    EXPECT_EQ(result.changes[2].value, 11000);
+    ASSERT_EQ(result.cancelled_orders.size(), 1);
+    EXPECT_EQ(result.cancelled_orders[0], resting.order_id);
+    
+    // User 1: (110 - 100) * 10 + (20 - 5) * 4
+    EXPECT_NEAR(result.settlement_pnl[1], 160.0, 1e-9);
+    EXPECT_NEAR(result.settlement_pnl[2], -160.0, 1e-9);
+    EXPECT_TRUE(engine->get_instrument(2)->is_halted);
+}
+
+TEST_F(EngineTest, AdminBatchIsAllOrNothing) {
+    auto resting = engine->submit_order(create_request(1, Side::BUY, 10000, 10));
+    
+    auto result = engine->apply_admin_batch({
+        AdminAction(AdminActionType::PULL_QUOTES, 1),
+        AdminAction(AdminActionType::SET_TICK, 1, 0)
+    });
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.failed_index, 1);
+    EXPECT_EQ(engine->get_orders(1).size(), 1);  // Nothing applied
+    
+    result = engine->apply_admin_batch({
+        AdminAction(AdminActionType::SET_TICK, 1, 5),
+        AdminAction(AdminActionType::HALT, 1),
+        AdminAction(AdminActionType::RESUME, 1)
+    });
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.cancelled_orders, std::vector<OrderId>{resting.order_id});
+    EXPECT_EQ(engine->get_instrument(1)->tick_size, 5);
+    EXPECT_FALSE(engine->get_instrument(1)->is_halted);
+    
+    result = engine->apply_admin_batch({AdminAction(AdminActionType::SETTLE_CHAIN, 99, 100)});
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.error_message, "Instrument not found");
+}
+
+TEST_F(EngineTest, SetTickSize) {
+    auto bid = engine->submit_order(create_request(1, Side::BUY, 10003, 10));
+    engine->submit_order(create_request(2, Side::SELL, 10007, 10));
+    drain();
+    
+    ASSERT_TRUE(engine->set_tick_size(1, 5, TickPolicy::REPRICE));
+    EXPECT_EQ(engine->get_instrument(1)->tick_size, 5);
+    auto snapshot = engine->get_snapshot(1);
+    EXPECT_EQ(snapshot.bids[0].price, 10000);
+    EXPECT_EQ(snapshot.asks[0].price, 10010);
+    
+    auto events = drain();
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].type, EngineEventType::BOOK_RESET);
+    EXPECT_EQ(events[0].value, 5);
+    EXPECT_EQ(events[0].order_ids.size(), 2);
+    
+    // Off-grid prices are rejected from now on
+    auto result = engine->submit_order(create_request(1, Side::BUY, 10003, 10));
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.error_message, "Price not on tick grid");
+    
+    ASSERT_TRUE(engine->set_tick_size(1, 10, TickPolicy::CANCEL));
+    EXPECT_TRUE(engine->get_orders(1).empty());
+    EXPECT_FALSE(engine->cancel_order(bid.order_id, 1));
+    events = drain_without_levels();
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(events[0].type, EngineEventType::ORDERS_CANCELLED);
+    EXPECT_EQ(events[0].order_ids.size(), 2);
+    EXPECT_EQ(events[1].type, EngineEventType::BOOK_RESET);
+    EXPECT_EQ(engine->get_stats().total_cancels, 2);
+    
+    EXPECT_FALSE(engine->set_tick_size(1, 0, TickPolicy::CANCEL));
+    EXPECT_FALSE(engine->set_tick_size(99, 5, TickPolicy::CANCEL));
+}
+
+TEST_F(EngineTest, CancelOnDisconnect) {
+    InstrumentSpec spec;
+    spec.id = 2;
+    spec.symbol = "TEST2";
+    engine->add_instrument(spec);
+    
+    engine->submit_order(create_request(1, Side::BUY, 9900, 10));
+    engine->submit_order(create_request(1, Side::SELL, 10100, 10));
+    auto other = create_request(1, Side::BUY, 500, 10);
+    other.instrument_id = 2;
+    engine->submit_order(other);
+    engine->submit_order(create_request(2, Side::BUY, 9800, 10));
+    
+    // Unflagged users keep their quotes
+    EXPECT_TRUE(engine->user_disconnected(1).empty());
+    EXPECT_EQ(engine->get_orders(1).size(), 3);
+    
+    engine->set_cancel_on_disconnect(1, true);
+    drain();
+    auto cancelled = engine->user_disconnected(1);
+    EXPECT_EQ(cancelled.size(), 3);
+    EXPECT_EQ(engine->get_orders(1).size(), 1);  // User 2's bid remains
+    EXPECT_TRUE(engine->get_orders(2).empty());
+    EXPECT_EQ(engine->get_snapshot(1).bids[0].price, 9800);
+    
+    auto events = drain_without_levels();
+    ASSERT_EQ(events.size(), 2);  // One per instrument
+    EXPECT_EQ(events[0].type, EngineEventType::ORDERS_CANCELLED);
+    EXPECT_EQ(events[0].user_id, 1);
+    EXPECT_EQ(events[0].order_ids.size(), 2);
+    EXPECT_EQ(events[1].order_ids.size(), 1);
+}
+
+TEST_F(EngineTest, HaltWithCancel) {
+    engine->submit_order(create_request(1, Side::BUY, 9900, 10));
+    engine->submit_order(create_request(2, Side::SELL, 10100, 10));
+    
+    drain();
+    
+    // Plain halt leaves orders resting
+    engine->halt_instrument(1, true);
+    EXPECT_EQ(engine->get_orders(1).size(), 2);
+    auto events = drain();
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].type, EngineEventType::INSTRUMENT_HALTED);
+    
+    engine->halt_instrument(1, true, true);
+    EXPECT_TRUE(engine->get_orders(1).empty());
+    EXPECT_TRUE(engine->get_snapshot(1).bids.empty());
+    
+    events = drain_without_levels();
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(events[1].type, EngineEventType::ORDERS_CANCELLED);
+    EXPECT_EQ(events[1].order_ids.size(), 2);
+    EXPECT_EQ(engine->get_stats().total_cancels, 2);
+}
+
+TEST_F(EngineTest, MemoryStatsTrackGrowth) {
+    auto before = engine->get_memory_stats();
+    EXPECT_GT(before.books.used, 0);  // The book object itself
+    EXPECT_EQ(before.orders.used, 0);
+    EXPECT_EQ(before.history.reserved, 0);
+    
+    for (int i = 0; i < 10; ++i) {
+        engine->submit_order(create_request(1, Side::BUY, 9900 - i, 10));
+    }
+    engine->submit_order(create_request(2, Side::SELL, 9900, 5));
+    
+    auto after = engine->get_memory_stats();
+    EXPECT_GT(after.books.used, before.books.used);
+    EXPECT_GT(after.orders.used, 0);
+    EXPECT_GT(after.positions.used, 0);
+    EXPECT_GT(after.history.used, 0);
+    EXPECT_GE(after.history.reserved, after.history.used);
+    EXPECT_EQ(after.total().used, after.books.used + after.orders.used + after.positions.used +
+                                  after.history.used + after.indexes.used + after.events.used);
+    EXPECT_EQ(engine->get_stats().memory.total().used, after.total().used);
+    
+    // Pulling the quotes releases book and order memory
+    engine->halt_instrument(1, true, true);
+    auto pulled = engine->get_memory_stats();
+    EXPECT_EQ(pulled.orders.used, 0);
+    EXPECT_EQ(pulled.books.used, before.books.used);
+    EXPECT_GT(pulled.events.used, 0);
+}
+
+TEST_F(EngineTest, EventsAreSequenced) {
+    engine->submit_order(create_request(1, Side::BUY, 10000, 10));
+    auto sell = engine->submit_order(create_request(2, Side::SELL, 10000, 4));
+    engine->submit_order(create_request(2, Side::SELL, 10100, 5));
+    ASSERT_EQ(sell.fills.size(), 2);
+    
+    auto events = drain();
+    ASSERT_EQ(events.size(), 8);
+    for (size_t i = 0; i < events.size(); ++i) {
+        EXPECT_EQ(events[i].seq, i + 1);
+    }
+    
+    // Accept, accept, two fills, accept
+    events.erase(std::remove_if(events.begin(), events.end(), [](const EngineEvent& e) {
+        return e.type == EngineEventType::LEVEL_UPDATE;
+    }), events.end());
+    ASSERT_EQ(events.size(), 5);
+    EXPECT_EQ(events[1].type, EngineEventType::ORDER_ACCEPTED);
+    EXPECT_EQ(events[1].order_id, sell.order_id);
+    EXPECT_EQ(events[2].type, EngineEventType::FILL);
+    EXPECT_EQ(events[2].user_id, 2);
+    EXPECT_EQ(events[3].type, EngineEventType::FILL);
+    EXPECT_EQ(events[3].user_id, 1);
+    EXPECT_EQ(events[3].quantity, 4);
+    EXPECT_TRUE(drain().empty());
+    
+    engine->cancel_order(sell.order_id + 1, 2);
+    engine->settle_instrument(1, 10200);
+    EXPECT_EQ(engine->last_seq(), 11);
+    
+    // Replay serves any suffix still in the ring, regardless of draining
+    std::vector<EngineEvent> replay;
+    ASSERT_TRUE(engine->replay_from(9, replay));
+    ASSERT_EQ(replay.size(), 3);
+    EXPECT_EQ(replay[0].type, EngineEventType::LEVEL_UPDATE);
+    EXPECT_EQ(replay[0].quantity, 0);
+    EXPECT_EQ(replay[1].type, EngineEventType::ORDER_CANCELLED);
+    EXPECT_EQ(replay[1].quantity, 5);
+    EXPECT_EQ(replay[2].type, EngineEventType::INSTRUMENT_SETTLED);
+    EXPECT_EQ(replay[2].value, 10200);
+    
+    ASSERT_TRUE(engine->replay_from(12, replay));
+    EXPECT_TRUE(replay.empty());  // Caught up
+}
+
+TEST_F(EngineTest, ReplayGapAfterRingWraps) {
+    Engine small(4);
+    InstrumentSpec spec;
+    spec.id = 1;
+    small.add_instrument(spec);
+    for (int i = 0; i < 6; ++i) {
+        small.submit_order(create_request(1, Side::BUY, 9900 - i, 1));
+    }
+    
+    // Each resting order is a level update plus an accept
+    std::vector<EngineEvent> replay;
+    EXPECT_FALSE(small.replay_from(8, replay));  // Overwritten; client must re-snapshot
+    EXPECT_TRUE(replay.empty());
+    ASSERT_TRUE(small.replay_from(9, replay));
+    EXPECT_EQ(replay.size(), 4);
+    EXPECT_EQ(replay.back().seq, 12);
+}
+
+TEST_F(EngineTest, SnapshotPlusDeltasTracksBook) {
+    engine->submit_order(create_request(1, Side::BUY, 9900, 10));
+    engine->submit_order(create_request(1, Side::SELL, 10100, 10));
+    auto snapshot = engine->get_snapshot(1);
+    EXPECT_EQ(snapshot.seq, engine->last_seq());
+    
+    // Traffic after the cut: new level, partial fill, cancel
+    engine->submit_order(create_request(2, Side::BUY, 9950, 5));
+    engine->submit_order(create_request(2, Side::BUY, 10100, 4));
+    auto ask = engine->submit_order(create_request(3, Side::SELL, 10200, 7));
+    engine->cancel_order(ask.order_id, 3);
+    
+    // Rebuild from the snapshot and the deltas after its seq
+    std::map<Price, Quantity> bids, asks;
+    for (const auto& level : snapshot.bids) bids[level.price] = level.size;
+    for (const auto& level : snapshot.asks) asks[level.price] = level.size;
+    std::vector<EngineEvent> deltas;
+    ASSERT_TRUE(engine->replay_from(snapshot.seq + 1, deltas));
+    for (const auto& event : deltas) {
+        if (event.type != EngineEventType::LEVEL_UPDATE) continue;
+        auto& levels = event.side == Side::BUY ? bids : asks;
+        if (event.quantity == 0) {
+            levels.erase(event.price);
+        } else {
+            levels[event.price] = event.quantity;
+        }
+    }
+    
+    auto current = engine->get_snapshot(1);
+    ASSERT_EQ(bids.size(), current.bids.size());
+    ASSERT_EQ(asks.size(), current.asks.size());
+    for (const auto& level : current.bids) EXPECT_EQ(bids[level.price], level.size);
+    for (const auto& level : current.asks) EXPECT_EQ(asks[level.price], level.size);
+    EXPECT_EQ(asks[10100], 6);
+    
+    EXPECT_EQ(engine->get_snapshot(1, 1).bids.size(), 1);  // Depth-limited
+}
+
+TEST_F(EngineTest, PerUserFillsAndOrders) {
+    auto first = engine->submit_order(create_request(1, Side::SELL, 10000, 10));
+    auto second = engine->submit_order(create_request(1, Side::SELL, 10100, 10));
+    auto third = engine->submit_order(create_request(1, Side::SELL, 10200, 10));
+    engine->submit_order(create_request(2, Side::BUY, 10000, 4));
+    engine->submit_order(create_request(3, Side::BUY, 10100, 10));  // 6 @ 10000, 4 @ 10100
+    engine->cancel_order(third.order_id, 1);
+    
+    auto orders = engine->get_user_orders(1);
+    ASSERT_EQ(orders.size(), 1);  // First filled away, third cancelled
+    EXPECT_EQ(orders[0]->id, second.order_id);
+    EXPECT_EQ(orders[0]->filled_quantity, 4);
+    EXPECT_TRUE(engine->get_user_orders(3).empty());
+    
+    auto fills = engine->get_user_fills(1);
+    ASSERT_EQ(fills.size(), 3);
+    EXPECT_EQ(fills[0].order_id, first.order_id);
+    EXPECT_EQ(fills[0].quantity, 4);
+    EXPECT_EQ(fills[2].order_id, second.order_id);
+    for (const auto& fill : fills) EXPECT_EQ(fill.user_id, 1);
+    
+    // Paging through a user's own fills
+    auto page = engine->get_user_fills(1, 1, 1);
+    ASSERT_EQ(page.size(), 1);
+    EXPECT_EQ(page[0].quantity, 6);
+    EXPECT_EQ(engine->get_user_fills(1, 2).size(), 1);
+    EXPECT_TRUE(engine->get_user_fills(1, 3).empty());
+    EXPECT_EQ(engine->get_user_fills(3).size(), 2);
+    EXPECT_TRUE(engine->get_user_fills(99).empty());
+}
+
+TEST_F(EngineTest, ReconstructsPastBooks) {
+    // Checkpoints every 4096 level changes, so cross a few
+    std::vector<std::pair<uint64_t, MarketSnapshot>> seen;
+    for (int i = 0; i < 5000; ++i) {
+        Price offset = i % 50;
+        engine->submit_order(create_request(1, Side::BUY, 9000 + offset, 1 + i % 3));
+        engine->submit_order(create_request(2, Side::SELL, 9040 - offset, 1 + i % 2));
+        if (i % 997 == 0) {
+            auto snapshot = engine->get_snapshot(1, SIZE_MAX);
+            seen.emplace_back(snapshot.seq, snapshot);
+        }
+    }
+    
+    for (const auto& [seq, expected] : seen) {
+        auto books = engine->reconstruct_at_seq(seq);
+        ASSERT_EQ(books.size(), 1);
+        ASSERT_EQ(books[0].bids.size(), expected.bids.size());
+        ASSERT_EQ(books[0].asks.size(), expected.asks.size());
+        for (size_t i = 0; i < expected.bids.size(); ++i) {
+            EXPECT_EQ(books[0].bids[i].price, expected.bids[i].price);
+            EXPECT_EQ(books[0].bids[i].size, expected.bids[i].size);
+        }
+        for (size_t i = 0; i < expected.asks.size(); ++i) {
+            EXPECT_EQ(books[0].asks[i].price, expected.asks[i].price);
+            EXPECT_EQ(books[0].asks[i].size, expected.asks[i].size);
+        }
+    }
+    
+    // Time lookups land on the same state
+    auto now = engine->reconstruct_at(std::chrono::system_clock::now());
+    ASSERT_EQ(now.size(), 1);
+    EXPECT_EQ(now[0].bids.size(), engine->get_snapshot(1, SIZE_MAX).bids.size());
+    
+    // A retick merges levels without per-level updates; the journal follows
+    engine->set_tick_size(1, 10, TickPolicy::REPRICE);
+    auto reticked = engine->reconstruct_at_seq(engine->last_seq());
+    auto current = engine->get_snapshot(1, SIZE_MAX);
+    ASSERT_EQ(reticked[0].bids.size(), current.bids.size());
+    EXPECT_EQ(reticked[0].bids[0].size, current.bids[0].size);
+}
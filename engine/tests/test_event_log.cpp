@@ -0,0 +1,62 @@
+#include "mmg/event_log.h"
+#include <gtest/gtest.h>
+
+using namespace mmg;
+
+namespace {
+
+EngineEvent event_for(InstrumentId id) {
+    return EngineEvent(EngineEventType::ORDER_ACCEPTED, id);
+}
+
+}  // namespace
+
+TEST(EventLogTest, AssignsMonotonicSequence) {
+    EventLog log(8);
+    EXPECT_EQ(log.last_seq(), 0);
+    EXPECT_EQ(log.first_cached_seq(), 1);
+    
+    EXPECT_EQ(log.append(event_for(1)), 1);
+    EXPECT_EQ(log.append(event_for(2)), 2);
+    
+    std::vector<EngineEvent> out;
+    ASSERT_TRUE(log.replay_from(0, out));  // Zero means "from the start"
+    ASSERT_EQ(out.size(), 2);
+    EXPECT_EQ(out[0].seq, 1);
+    EXPECT_EQ(out[1].instrument_id, 2);
+}
+
+TEST(EventLogTest, RingOverwritesOldest) {
+    EventLog log(3);
+    for (InstrumentId id = 1; id <= 5; ++id) log.append(event_for(id));
+    
+    EXPECT_EQ(log.first_cached_seq(), 3);
+    std::vector<EngineEvent> out;
+    EXPECT_FALSE(log.replay_from(2, out));
+    ASSERT_TRUE(log.replay_from(4, out));
+    ASSERT_EQ(out.size(), 2);
+    EXPECT_EQ(out[0].seq, 4);
+    EXPECT_EQ(out[0].instrument_id, 4);
+}
+
+TEST(EventLogTest, DrainReturnsOnlyNewEvents) {
+    EventLog log(4);
+    log.append(event_for(1));
+    std::vector<EngineEvent> drained;
+    EXPECT_TRUE(log.drain(drained));
+    EXPECT_EQ(drained.size(), 1);
+    EXPECT_TRUE(log.drain(drained));
+    EXPECT_TRUE(drained.empty());
+    
+    // A slow drainer is told it lost what the ring overwrote, and keeps the newest
+    for (InstrumentId id = 2; id <= 7; ++id) log.append(event_for(id));
+    EXPECT_FALSE(log.drain(drained));
+    ASSERT_EQ(drained.size(), 4);
+    EXPECT_EQ(drained.front().seq, 4);
+    EXPECT_EQ(drained.back().seq, 7);
+    
+    // A full ring of new events is still complete
+    for (InstrumentId id = 8; id <= 11; ++id) log.append(event_for(id));
+    EXPECT_TRUE(log.drain(drained));
+    EXPECT_EQ(drained.size(), 4);
+}
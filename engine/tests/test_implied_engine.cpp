@@ -0,0 +1,210 @@
+#include "mmg/engine.h"
+#include <gtest/gtest.h>
+
+using namespace mmg;
+
+class ImpliedEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        engine = std::make_unique<Engine>();
+
+        InstrumentSpec underlying;
+        underlying.id = 1;
+        underlying.symbol = "UND";
+        engine->add_instrument(underlying);
+
+        InstrumentSpec call_100;
+        call_100.id = 2;
+        call_100.symbol = "C100";
+        call_100.type = InstrumentType::CALL;
+        call_100.reference_id = 1;
+        call_100.strike = 10000;
+        engine->add_instrument(call_100);
+
+        InstrumentSpec call_110 = call_100;
+        call_110.id = 3;
+        call_110.symbol = "C110";
+        call_110.strike = 11000;
+        engine->add_instrument(call_110);
+
+        // Call spread: long C100, short C110
+        InstrumentSpec spread;
+        spread.id = 10;
+        spread.symbol = "C100-C110";
+        spread.type = InstrumentType::COMBO;
+        spread.legs = {ComboLeg(2, 1), ComboLeg(3, -1)};
+        ASSERT_TRUE(engine->add_instrument(spread));
+    }
+
+    std::unique_ptr<Engine> engine;
+
+    Engine::OrderResult submit(UserId user_id, InstrumentId inst, Side side, Price price,
+                               Quantity qty, TimeInForce tif = TimeInForce::GFD) {
+        OrderRequest req;
+        req.user_id = user_id;
+        req.instrument_id = inst;
+        req.side = side;
+        req.price = price;
+        req.quantity = qty;
+        req.tif = tif;
+        return engine->submit_order(req);
+    }
+
+    Quantity position(UserId user_id, InstrumentId inst) {
+        for (const auto& pos : engine->get_positions(user_id)) {
+            if (pos.instrument_id == inst) return pos.net_qty;
+        }
+        return 0;
+    }
+};
+
+TEST_F(ImpliedEngineTest, ComboValidation) {
+    InstrumentSpec combo;
+    combo.id = 20;
+    combo.type = InstrumentType::COMBO;
+
+    combo.legs = {ComboLeg(2, 1)};
+    EXPECT_FALSE(engine->add_instrument(combo));  // Single leg
+
+    combo.legs = {ComboLeg(2, 1), ComboLeg(99, -1)};
+    EXPECT_FALSE(engine->add_instrument(combo));  // Unknown leg
+
+    combo.legs = {ComboLeg(2, 1), ComboLeg(10, -1)};
+    EXPECT_FALSE(engine->add_instrument(combo));  // Nested combo
+
+    combo.legs = {ComboLeg(2, 1), ComboLeg(2, -1)};
+    EXPECT_FALSE(engine->add_instrument(combo));  // Duplicate leg
+
+    combo.legs = {ComboLeg(2, 1), ComboLeg(3, 0)};
+    EXPECT_FALSE(engine->add_instrument(combo));  // Zero ratio
+
+    combo.legs = {ComboLeg(2, 1), ComboLeg(3, -1)};
+    combo.price_decimals = 4;
+    EXPECT_FALSE(engine->add_instrument(combo));  // Mixed price scales
+}
+
+TEST_F(ImpliedEngineTest, ImpliedInFromLegBooks) {
+    submit(1, 2, Side::BUY, 500, 10);
+    submit(1, 2, Side::SELL, 520, 10);
+    submit(2, 3, Side::BUY, 200, 4);
+    submit(2, 3, Side::SELL, 210, 8);
+
+    auto quote = engine->get_implied_quote(10);
+    EXPECT_EQ(quote.bid, 500 - 210);
+    EXPECT_EQ(quote.bid_size, 8);
+    EXPECT_EQ(quote.ask, 520 - 200);
+    EXPECT_EQ(quote.ask_size, 4);
+
+    // Pulling a leg removes that implied side
+    submit(3, 3, Side::SELL, 200, 4);
+    quote = engine->get_implied_quote(10);
+    EXPECT_EQ(quote.ask_size, 0);
+    EXPECT_EQ(quote.bid_size, 8);
+}
+
+TEST_F(ImpliedEngineTest, ImpliedOutFromRestingCombo) {
+    submit(1, 10, Side::BUY, 300, 5);  // Bid for the spread
+    submit(2, 3, Side::BUY, 190, 10);   // C110 bid
+
+    // Buying the spread at 3.00 and selling C110 at 1.90 bids C100 at 4.90
+    auto quote = engine->get_implied_quote(2);
+    EXPECT_EQ(quote.bid, 490);
+    EXPECT_EQ(quote.bid_size, 5);
+    EXPECT_EQ(quote.ask_size, 0);
+}
+
+TEST_F(ImpliedEngineTest, ComboOrderTakesImpliedLiquidity) {
+    submit(1, 2, Side::SELL, 520, 10);
+    submit(2, 3, Side::BUY, 200, 10);
+
+    auto result = submit(3, 10, Side::BUY, 350, 6);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.fills.size(), 4);  // Two legs, aggressor and passive each
+
+    // Legs fill atomically at their book prices
+    EXPECT_EQ(position(3, 2), 6);
+    EXPECT_EQ(position(3, 3), -6);
+    EXPECT_EQ(position(1, 2), -6);
+    EXPECT_EQ(position(2, 3), 6);
+
+    EXPECT_TRUE(engine->get_orders(10).empty());  // Fully filled, nothing rests
+}
+
+TEST_F(ImpliedEngineTest, RestingComboMatchesWhenLegsCross) {
+    submit(1, 10, Side::BUY, 300, 5);
+    submit(2, 3, Side::BUY, 200, 10);
+
+    // C100 offered at the implied-out price fills the resting spread bid
+    auto result = submit(3, 2, Side::SELL, 500, 5);
+    EXPECT_FALSE(result.fills.empty());
+
+    EXPECT_EQ(position(1, 2), 5);
+    EXPECT_EQ(position(1, 3), -5);
+    EXPECT_EQ(position(3, 2), -5);
+    EXPECT_EQ(position(2, 3), 5);
+    EXPECT_TRUE(engine->get_orders(10).empty());
+}
+
+TEST_F(ImpliedEngineTest, DirectComboTradeBooksLegs) {
+    // Leg marks 5.00 and 2.00 imply a 3.00 spread
+    submit(1, 2, Side::BUY, 480, 1);
+    submit(1, 2, Side::SELL, 520, 1);
+    submit(1, 3, Side::BUY, 180, 1);
+    submit(1, 3, Side::SELL, 220, 1);
+
+    submit(2, 10, Side::SELL, 320, 4);
+    submit(3, 10, Side::BUY, 320, 4);
+
+    auto positions = engine->get_positions(3);
+    ASSERT_EQ(positions.size(), 2);
+    EXPECT_EQ(position(3, 2), 4);
+    EXPECT_EQ(position(3, 3), -4);
+    EXPECT_EQ(position(2, 2), -4);
+
+    // Leg prices add up to the traded spread price
+    double cost = 0.0;
+    for (const auto& pos : positions) {
+        cost += pos.vwap / 100.0 * pos.net_qty;
+    }
+    EXPECT_NEAR(cost, 3.20 * 4, 1e-9);
+}
+
+TEST_F(ImpliedEngineTest, ComboRoundingResidueIsRealized) {
+    // 2 x C100 - 3 x C110 with no unit-ratio leg: marks 5.00 and 2.00 imply
+    // 4.00, and a 4.05 trade leaves 0.01 the C100 leg's 2 cannot split
+    InstrumentSpec ratio;
+    ratio.id = 11;
+    ratio.type = InstrumentType::COMBO;
+    ratio.legs = {ComboLeg(2, 2), ComboLeg(3, -3)};
+    ASSERT_TRUE(engine->add_instrument(ratio));
+
+    submit(1, 2, Side::BUY, 480, 1);
+    submit(1, 2, Side::SELL, 520, 1);
+    submit(1, 3, Side::BUY, 180, 1);
+    submit(1, 3, Side::SELL, 220, 1);
+
+    submit(2, 11, Side::SELL, 405, 4);
+    submit(3, 11, Side::BUY, 405, 4);
+    EXPECT_EQ(position(3, 2), 8);
+    EXPECT_EQ(position(3, 3), -12);
+
+    // Booked leg cost net of realized PnL is exactly what changed hands
+    for (UserId user : {2, 3}) {
+        double cost = 0.0;
+        for (const auto& pos : engine->get_positions(user)) {
+            cost += pos.vwap / 100.0 * pos.net_qty - pos.realized_pnl;
+        }
+        EXPECT_NEAR(cost, user == 3 ? 4.05 * 4 : -4.05 * 4, 1e-9);
+    }
+}
+
+TEST_F(ImpliedEngineTest, HaltedLegBlocksImpliedMatching) {
+    submit(1, 2, Side::SELL, 520, 10);
+    submit(2, 3, Side::BUY, 200, 10);
+    engine->halt_instrument(3, true);
+
+    auto result = submit(3, 10, Side::BUY, 350, 6);
+    EXPECT_TRUE(result.success);
+    EXPECT_TRUE(result.fills.empty());
+    EXPECT_EQ(position(3, 2), 0);
+}
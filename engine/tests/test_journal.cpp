@@ -0,0 +1,62 @@
+#include "mmg/journal.h"
+#include <gtest/gtest.h>
+
+using namespace mmg;
+
+namespace {
+
+Timestamp at(int ms) {
+    return Timestamp(std::chrono::milliseconds(ms));
+}
+
+}  // namespace
+
+TEST(BookJournalTest, ReconstructsBySeqAndTime) {
+    BookJournal journal(2);
+    journal.record(1, at(10), {1, Side::BUY, 100, 5});
+    journal.record(2, at(20), {1, Side::SELL, 110, 3});
+    journal.record(3, at(30), {1, Side::BUY, 100, 0});
+    journal.record(4, at(40), {2, Side::BUY, 50, 7});
+    journal.record(5, at(50), {1, Side::BUY, 99, 2});
+    EXPECT_EQ(journal.checkpoints().size(), 2);  // After seq 2 and 4
+    
+    auto books = journal.reconstruct_at_seq(2);
+    ASSERT_EQ(books.size(), 1);
+    ASSERT_EQ(books[0].bids.size(), 1);
+    EXPECT_EQ(books[0].bids[0].size, 5);
+    EXPECT_EQ(books[0].asks[0].price, 110);
+    EXPECT_EQ(books[0].seq, 2);
+    
+    books = journal.reconstruct_at(at(45));
+    ASSERT_EQ(books.size(), 2);
+    EXPECT_TRUE(books[0].bids.empty());
+    EXPECT_EQ(books[1].instrument_id, 2);
+    EXPECT_EQ(books[1].seq, 4);
+    
+    books = journal.reconstruct_at_seq(100);
+    ASSERT_EQ(books.size(), 2);
+    EXPECT_EQ(books[0].bids[0].price, 99);
+    
+    EXPECT_TRUE(journal.reconstruct_at(at(5)).empty());
+}
+
+TEST(BookJournalTest, ResetJournalsOnlyDifferences) {
+    BookJournal journal;
+    journal.record(1, at(10), {1, Side::BUY, 101, 5});
+    journal.record(2, at(10), {1, Side::BUY, 100, 4});
+    journal.record(3, at(10), {1, Side::SELL, 110, 3});
+    
+    // Retick to 5: 101 and 100 merge into 100
+    MarketSnapshot book;
+    book.instrument_id = 1;
+    book.bids.emplace_back(100, 9);
+    book.asks.emplace_back(110, 3);
+    journal.reset_book(4, at(20), book);
+    EXPECT_EQ(journal.size(), 5);  // 101 removed, 100 resized; ask untouched
+    
+    auto books = journal.reconstruct_at_seq(4);
+    ASSERT_EQ(books.size(), 1);
+    ASSERT_EQ(books[0].bids.size(), 1);
+    EXPECT_EQ(books[0].bids[0].size, 9);
+    EXPECT_EQ(journal.reconstruct_at_seq(3)[0].bids.size(), 2);
+}
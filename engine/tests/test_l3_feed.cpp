@@ -0,0 +1,219 @@
+#include "mmg/engine.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace mmg;
+
+namespace {
+
+// A subscriber's copy of one book, built from a snapshot plus events
+struct Mirror {
+    std::map<Price, std::vector<L3Order>, std::greater<Price>> bids;
+    std::map<Price, std::vector<L3Order>> asks;
+    uint64_t seq = 0;
+    
+    explicit Mirror(const L3Snapshot& snapshot) : seq(snapshot.seq) {
+        for (const auto& level : snapshot.bids) bids[level.price] = level.orders;
+        for (const auto& level : snapshot.asks) asks[level.price] = level.orders;
+    }
+    
+    template <typename Levels>
+    static void remove(Levels& levels, OrderId id) {
+        for (auto it = levels.begin(); it != levels.end(); ++it) {
+            auto& orders = it->second;
+            for (auto o = orders.begin(); o != orders.end(); ++o) {
+                if (o->order_id != id) continue;
+                orders.erase(o);
+                if (orders.empty()) levels.erase(it);
+                return;
+            }
+        }
+    }
+    
+    template <typename Levels>
+    static void apply(Levels& levels, const L3Event& e) {
+        switch (e.type) {
+            case L3EventType::ADD: {
+                auto& orders = levels[e.price];
+                orders.insert(orders.begin() + e.position, {e.order_id, e.quantity});
+                break;
+            }
+            case L3EventType::MODIFY: {
+                remove(levels, e.order_id);
+                auto& orders = levels[e.price];
+                orders.insert(orders.begin() + e.position, {e.order_id, e.quantity});
+                break;
+            }
+            case L3EventType::EXECUTE: {
+                auto& orders = levels[e.price];
+                for (auto& order : orders) {
+                    if (order.order_id == e.order_id) order.quantity -= e.quantity;
+                }
+                orders.erase(std::remove_if(orders.begin(), orders.end(),
+                                            [](const L3Order& o) { return o.quantity == 0; }),
+                             orders.end());
+                if (orders.empty()) levels.erase(e.price);
+                break;
+            }
+            case L3EventType::DELETE:
+                remove(levels, e.order_id);
+                break;
+        }
+    }
+    
+    void apply(const L3Event& e) {
+        ASSERT_EQ(e.seq, seq + 1);
+        seq = e.seq;
+        if (e.side == Side::BUY) {
+            apply(bids, e);
+        } else {
+            apply(asks, e);
+        }
+    }
+    
+    template <typename Levels>
+    static void expect_equal(const Levels& levels, const std::vector<L3Level>& expected) {
+        ASSERT_EQ(levels.size(), expected.size());
+        size_t i = 0;
+        for (const auto& [price, orders] : levels) {
+            EXPECT_EQ(price, expected[i].price);
+            ASSERT_EQ(orders.size(), expected[i].orders.size());
+            for (size_t j = 0; j < orders.size(); ++j) {
+                EXPECT_EQ(orders[j].order_id, expected[i].orders[j].order_id);
+                EXPECT_EQ(orders[j].quantity, expected[i].orders[j].quantity);
+            }
+            ++i;
+        }
+    }
+};
+
+OrderRequest order(UserId user, Side side, Price price, Quantity qty) {
+    OrderRequest request;
+    request.user_id = user;
+    request.instrument_id = 1;
+    request.side = side;
+    request.price = price;
+    request.quantity = qty;
+    return request;
+}
+
+std::unique_ptr<Engine> make_engine() {
+    auto engine = std::make_unique<Engine>();
+    InstrumentSpec spec;
+    spec.id = 1;
+    spec.symbol = "TEST";
+    engine->add_instrument(spec);
+    return engine;
+}
+
+}  // namespace
+
+TEST(L3FeedTest, SilentWithoutSubscribers) {
+    auto engine = make_engine();
+    engine->submit_order(order(1, Side::BUY, 100, 5));
+    engine->submit_order(order(2, Side::SELL, 100, 2));
+    EXPECT_TRUE(engine->drain_l3_events().empty());
+    EXPECT_EQ(engine->get_l3_snapshot(1).seq, 0);
+    
+    EXPECT_FALSE(engine->subscribe_l3(7, 99));  // Unknown instrument
+    ASSERT_TRUE(engine->subscribe_l3(7, 1));
+    ASSERT_TRUE(engine->subscribe_l3(8, 1));
+    engine->submit_order(order(1, Side::BUY, 99, 1));
+    EXPECT_EQ(engine->drain_l3_events().size(), 1);
+    
+    // The book goes quiet again once its last subscriber leaves
+    EXPECT_TRUE(engine->unsubscribe_l3(7, 1));
+    EXPECT_FALSE(engine->unsubscribe_l3(7, 1));
+    engine->submit_order(order(1, Side::BUY, 98, 1));
+    EXPECT_EQ(engine->drain_l3_events().size(), 1);
+    engine->unsubscribe_all_l3(8);
+    EXPECT_TRUE(engine->get_l3_subscribers(1).empty());
+    engine->submit_order(order(1, Side::BUY, 97, 1));
+    EXPECT_TRUE(engine->drain_l3_events().empty());
+}
+
+TEST(L3FeedTest, EventsRebuildTheBook) {
+    auto engine = make_engine();
+    std::mt19937 rng(3);
+    std::vector<OrderId> live;
+    auto churn = [&](int count) {
+        for (int i = 0; i < count; ++i) {
+            Side side = rng() % 2 ? Side::BUY : Side::SELL;
+            Price price = side == Side::BUY ? 95 + rng() % 10 : 101 + rng() % 10;
+            if (rng() % 8 == 0) price = side == Side::BUY ? 108 : 96;  // Crosses
+            auto result = engine->submit_order(order(1 + rng() % 4, side, price, 1 + rng() % 9));
+            if (result.success) live.push_back(result.order_id);
+            if (!live.empty() && rng() % 4 == 0) {
+                size_t k = rng() % live.size();
+                engine->cancel_order(live[k], 0);
+                live.erase(live.begin() + k);
+            }
+        }
+    };
+    
+    // Bootstrap from a snapshot taken mid-session
+    churn(200);
+    engine->subscribe_l3(1, 1);
+    Mirror mirror(engine->get_l3_snapshot(1));
+    churn(500);
+    engine->set_tick_size(1, 3, TickPolicy::REPRICE);  // Merges levels
+    churn(100);
+    engine->halt_instrument(1, true, true);  // Clears the book
+    engine->halt_instrument(1, false);
+    churn(100);
+    
+    auto events = engine->drain_l3_events();
+    ASSERT_FALSE(events.empty());
+    bool saw[5] = {};
+    for (const auto& event : events) {
+        saw[static_cast<int>(event.type)] = true;
+        mirror.apply(event);
+    }
+    EXPECT_TRUE(saw[1] && saw[2] && saw[3] && saw[4]);
+    
+    auto book = engine->get_l3_snapshot(1);
+    EXPECT_EQ(mirror.seq, book.seq);
+    Mirror::expect_equal(mirror.bids, book.bids);
+    Mirror::expect_equal(mirror.asks, book.asks);
+}
+
+TEST(L3FeedTest, EncodingRoundTrips) {
+    std::vector<L3Event> events(3);
+    events[0].seq = 41;
+    events[0].instrument_id = 2;
+    events[0].order_id = 1000;
+    events[0].price = -250;  // Spreads go negative
+    events[0].quantity = 7;
+    events[0].position = 3;
+    events[1] = events[0];
+    events[1].seq = 42;
+    events[1].type = L3EventType::EXECUTE;
+    events[1].side = Side::SELL;
+    events[1].order_id = 990;  // Older order; deltas go backwards
+    events[2] = events[0];
+    events[2].instrument_id = 5;
+    events[2].seq = 1;
+    events[2].type = L3EventType::DELETE;
+    
+    auto bytes = l3::encode(events);
+    EXPECT_LT(bytes.size(), events.size() * 16);
+    
+    std::vector<L3Event> decoded;
+    ASSERT_TRUE(l3::decode(bytes.data(), bytes.size(), decoded));
+    ASSERT_EQ(decoded.size(), events.size());
+    for (size_t i = 0; i < events.size(); ++i) {
+        EXPECT_EQ(decoded[i].seq, events[i].seq);
+        EXPECT_EQ(decoded[i].instrument_id, events[i].instrument_id);
+        EXPECT_EQ(decoded[i].type, events[i].type);
+        EXPECT_EQ(decoded[i].order_id, events[i].order_id);
+        EXPECT_EQ(decoded[i].side, events[i].side);
+        EXPECT_EQ(decoded[i].price, events[i].price);
+        EXPECT_EQ(decoded[i].quantity, events[i].quantity);
+        EXPECT_EQ(decoded[i].position, events[i].position);
+    }
+    
+    EXPECT_FALSE(l3::decode(bytes.data(), bytes.size() - 1, decoded));
+    EXPECT_TRUE(decoded.empty());
+    bytes[0] = 9;  // Unknown type
+    EXPECT_FALSE(l3::decode(bytes.data(), bytes.size(), decoded));
+}
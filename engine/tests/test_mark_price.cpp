@@ -0,0 +1,135 @@
+#include "mmg/engine.h"
+#include <gtest/gtest.h>
+
+using namespace mmg;
+
+class MarkPriceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        engine = std::make_unique<Engine>();
+
+        InstrumentSpec scalar;
+        scalar.id = 1;
+        scalar.symbol = "SCALAR";
+        engine->add_instrument(scalar);
+
+        InstrumentSpec call;
+        call.id = 2;
+        call.symbol = "CALL-100";
+        call.type = InstrumentType::CALL;
+        call.reference_id = 1;
+        call.strike = 10000;
+        engine->add_instrument(call);
+    }
+
+    std::unique_ptr<Engine> engine;
+
+    OrderId submit(UserId user_id, InstrumentId inst, Side side, Price price, Quantity qty) {
+        OrderRequest req;
+        req.user_id = user_id;
+        req.instrument_id = inst;
+        req.side = side;
+        req.price = price;
+        req.quantity = qty;
+        return engine->submit_order(req).order_id;
+    }
+
+    void set_method(InstrumentId inst, MarkMethod method, double alpha = 0.2) {
+        MarkConfig config;
+        config.method = method;
+        config.ema_alpha = alpha;
+        ASSERT_TRUE(engine->set_mark_config(inst, config));
+    }
+};
+
+TEST_F(MarkPriceTest, DefaultIsLastOrMid) {
+    submit(1, 1, Side::BUY, 9900, 10);
+    submit(2, 1, Side::SELL, 10100, 10);
+    EXPECT_EQ(engine->get_mark_price(1), 10000);
+
+    submit(3, 1, Side::BUY, 10100, 5);
+    EXPECT_EQ(engine->get_mark_price(1), 10100);
+}
+
+TEST_F(MarkPriceTest, MidIgnoresLastTrade) {
+    set_method(1, MarkMethod::MID);
+    submit(1, 1, Side::BUY, 9900, 10);
+    submit(2, 1, Side::SELL, 10100, 10);
+    submit(3, 1, Side::BUY, 10100, 5);
+    EXPECT_EQ(engine->get_mark_price(1), 10000);
+}
+
+TEST_F(MarkPriceTest, MicropriceLeansTowardThinSide) {
+    set_method(1, MarkMethod::MICROPRICE);
+    submit(1, 1, Side::BUY, 9900, 30);
+    submit(2, 1, Side::SELL, 10100, 10);
+    // (9900 * 10 + 10100 * 30) / 40
+    EXPECT_EQ(engine->get_mark_price(1), 10050);
+}
+
+TEST_F(MarkPriceTest, EmaOfMidSmoothsUpdates) {
+    set_method(1, MarkMethod::EMA_MID, 0.5);
+    submit(1, 1, Side::BUY, 9900, 10);
+    auto ask = submit(2, 1, Side::SELL, 10100, 10);
+    EXPECT_EQ(engine->get_mark_price(1), 10000);
+
+    // Mid moves to 10100; EMA moves halfway
+    engine->cancel_order(ask, 2);
+    EXPECT_EQ(engine->get_mark_price(1), 10000);  // One-sided book keeps the average
+    submit(2, 1, Side::SELL, 10300, 10);
+    EXPECT_EQ(engine->get_mark_price(1), 10050);
+}
+
+TEST_F(MarkPriceTest, OptionModelFollowsUnderlying) {
+    RiskParams params;
+    params.volatility = 0.2;
+    params.time_to_expiry = 0.0;  // Marks at intrinsic
+    engine->set_risk_params(params);
+    set_method(2, MarkMethod::OPTION_MODEL);
+    EXPECT_EQ(engine->get_mark_price(2), 0);
+
+    submit(1, 1, Side::BUY, 11000, 1);
+    submit(2, 1, Side::SELL, 11000, 1);
+    EXPECT_EQ(engine->get_mark_price(2), 1000);
+
+    // With time value the call is worth more than intrinsic
+    params.time_to_expiry = 0.5;
+    engine->set_risk_params(params);
+    EXPECT_GT(engine->get_mark_price(2), 1000);
+}
+
+TEST_F(MarkPriceTest, UnrealizedPnLUpdatedOnMarkChange) {
+    submit(1, 1, Side::BUY, 10000, 10);
+    submit(2, 1, Side::SELL, 10000, 10);
+
+    // Third parties move the market; user 1's cached unrealized follows
+    submit(3, 1, Side::BUY, 10500, 1);
+    submit(4, 1, Side::SELL, 10500, 1);
+
+    auto positions = engine->get_positions(1);
+    ASSERT_EQ(positions.size(), 1);
+    EXPECT_NEAR(positions[0].unrealized_pnl, 50.0, 1e-9);
+    EXPECT_NEAR(engine->get_total_pnl(2), -50.0, 1e-9);
+}
+
+TEST_F(MarkPriceTest, OptionHoldersRevaluedFromUnderlying) {
+    RiskParams params;
+    params.time_to_expiry = 0.0;
+    engine->set_risk_params(params);
+    set_method(2, MarkMethod::OPTION_MODEL);
+
+    submit(1, 2, Side::BUY, 500, 10);
+    submit(2, 2, Side::SELL, 500, 10);
+
+    submit(3, 1, Side::BUY, 11000, 1);
+    submit(4, 1, Side::SELL, 11000, 1);
+
+    // Option marks at 10.00 intrinsic: (10 - 5) * 10
+    EXPECT_NEAR(engine->get_total_pnl(1), 50.0, 1e-9);
+}
+
+TEST_F(MarkPriceTest, UnknownInstrumentRejected) {
+    MarkConfig config;
+    EXPECT_FALSE(engine->set_mark_config(99, config));
+    EXPECT_EQ(engine->get_mark_price(99), 0);
+}
@@ -0,0 +1,78 @@
+#include "mmg/engine.h"
+#include <gtest/gtest.h>
+
+using namespace mmg;
+
+TEST(MarketDataPublisherTest, SubscriberSets) {
+    MarketDataPublisher publisher;
+    publisher.subscribe(2, 10, 5);
+    publisher.subscribe(1, 10, 3);
+    publisher.subscribe(1, 11, 10);
+    
+    const auto& subs = publisher.subscribers(10);
+    ASSERT_EQ(subs.size(), 2);
+    EXPECT_EQ(subs[0].client_id, 1);  // Sorted by client
+    EXPECT_EQ(publisher.max_depth(10), 5);
+    
+    publisher.subscribe(1, 10, 8);  // Resubscribing changes depth only
+    EXPECT_EQ(publisher.subscribers(10).size(), 2);
+    EXPECT_EQ(publisher.max_depth(10), 8);
+    
+    EXPECT_TRUE(publisher.unsubscribe(2, 10));
+    EXPECT_FALSE(publisher.unsubscribe(2, 10));
+    EXPECT_EQ(publisher.subscriptions(1), (std::vector<InstrumentId>{10, 11}));
+    
+    publisher.unsubscribe_all(1);
+    EXPECT_TRUE(publisher.subscribers(10).empty());
+    EXPECT_TRUE(publisher.subscriptions(1).empty());
+    EXPECT_EQ(publisher.max_depth(11), 0);
+}
+
+TEST(MarketDataPublisherTest, UpdatesQueuedOnlyForSubscribers) {
+    MarketDataPublisher publisher;
+    publisher.subscribe(1, 10, 5);
+    publisher.subscribe(2, 11, 5);
+    
+    // A new subscription starts with the current book
+    EXPECT_EQ(publisher.take_updates(1), std::vector<InstrumentId>{10});
+    EXPECT_TRUE(publisher.take_updates(1).empty());
+    publisher.take_updates(2);
+    
+    publisher.on_book_changed(10);
+    publisher.on_book_changed(10);
+    publisher.on_book_changed(12);  // Nobody watches this one
+    EXPECT_EQ(publisher.take_updates(1), std::vector<InstrumentId>{10});
+    EXPECT_TRUE(publisher.take_updates(2).empty());
+}
+
+TEST(MarketDataPublisherTest, EngineQueuesChangedBooks) {
+    Engine engine;
+    for (InstrumentId id : {1, 2}) {
+        InstrumentSpec spec;
+        spec.id = id;
+        engine.add_instrument(spec);
+    }
+    EXPECT_FALSE(engine.subscribe_market_data(7, 99, 5));  // Unknown book
+    EXPECT_FALSE(engine.subscribe_market_data(7, 1, 0));
+    ASSERT_TRUE(engine.subscribe_market_data(7, 1, 5));
+    engine.take_market_data_updates(7);
+    
+    OrderRequest req;
+    req.user_id = 1;
+    req.instrument_id = 2;
+    req.side = Side::BUY;
+    req.price = 100;
+    req.quantity = 1;
+    engine.submit_order(req);
+    EXPECT_TRUE(engine.take_market_data_updates(7).empty());
+    
+    req.instrument_id = 1;
+    auto result = engine.submit_order(req);
+    EXPECT_EQ(engine.take_market_data_updates(7), std::vector<InstrumentId>{1});
+    engine.cancel_order(result.order_id, 1);
+    EXPECT_EQ(engine.take_market_data_updates(7), std::vector<InstrumentId>{1});
+    
+    EXPECT_TRUE(engine.unsubscribe_market_data(7, 1));
+    engine.submit_order(req);
+    EXPECT_TRUE(engine.take_market_data_updates(7).empty());
+}
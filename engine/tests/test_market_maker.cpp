@@ -0,0 +1,150 @@
+#include "mmg/engine.h"
+#include <gtest/gtest.h>
+
+using namespace mmg;
+
+namespace {
+
+constexpr UserId kHouse = 1000;
+
+MarketMakerConfig make_config(uint64_t seed = 7) {
+    MarketMakerConfig config;
+    config.instrument_id = 1;
+    config.user_id = kHouse;
+    config.fair_value = 10000;
+    config.half_spread = 50;
+    config.size = 10;
+    config.max_inventory = 25;
+    config.skew = 2.0;
+    config.fair_step_ticks = 3;
+    config.seed = seed;
+    return config;
+}
+
+}  // namespace
+
+class MarketMakerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        engine = std::make_unique<Engine>();
+        InstrumentSpec spec;
+        spec.id = 1;
+        spec.symbol = "TEST";
+        spec.tick_size = 5;
+        engine->add_instrument(spec);
+    }
+    
+    std::unique_ptr<Engine> engine;
+    
+    Engine::OrderResult submit(UserId user_id, Side side, Price price, Quantity qty) {
+        OrderRequest req;
+        req.user_id = user_id;
+        req.instrument_id = 1;
+        req.side = side;
+        req.price = price;
+        req.quantity = qty;
+        return engine->submit_order(req);
+    }
+};
+
+TEST(MarketMakerQuoteTest, SkewsAgainstInventory) {
+    MarketMaker maker(make_config());
+    
+    Quote flat = maker.quote(0, 5);
+    EXPECT_EQ(flat.bid_price, 9950);
+    EXPECT_EQ(flat.ask_price, 10050);
+    EXPECT_EQ(flat.bid_size, 10);
+    
+    // Long 10: reservation drops 20, bid snaps down and ask up onto the grid
+    Quote long_quote = maker.quote(10, 5);
+    EXPECT_EQ(long_quote.bid_price, 9930);
+    EXPECT_EQ(long_quote.ask_price, 10030);
+    
+    // Near the limit only the reducing side keeps full size
+    Quote capped = maker.quote(20, 5);
+    EXPECT_EQ(capped.bid_size, 5);
+    EXPECT_EQ(capped.ask_size, 10);
+    EXPECT_EQ(maker.quote(-25, 5).ask_size, 0);
+}
+
+TEST(MarketMakerQuoteTest, SeededWalkIsDeterministic) {
+    MarketMaker a(make_config(42)), b(make_config(42)), c(make_config(43));
+    bool diverged = false;
+    for (int i = 0; i < 50; ++i) {
+        a.step(5);
+        b.step(5);
+        c.step(5);
+        EXPECT_EQ(a.fair_value(), b.fair_value());
+        EXPECT_EQ(a.fair_value() % 5, 0);
+        diverged |= a.fair_value() != c.fair_value();
+    }
+    EXPECT_TRUE(diverged);
+}
+
+TEST_F(MarketMakerTest, MassQuoteReplacesPreviousQuotes) {
+    Quote quote;
+    quote.instrument_id = 1;
+    quote.bid_price = 9900;
+    quote.bid_size = 5;
+    quote.ask_price = 10100;
+    quote.ask_size = 5;
+    auto first = engine->mass_quote(1, {quote});
+    ASSERT_TRUE(first.success);
+    EXPECT_EQ(first.order_ids.size(), 2);
+    
+    quote.bid_price = 9950;
+    quote.ask_size = 0;
+    auto second = engine->mass_quote(1, {quote});
+    ASSERT_TRUE(second.success);
+    auto orders = engine->get_orders(1);
+    ASSERT_EQ(orders.size(), 1);
+    EXPECT_EQ(orders[0]->price, 9950);
+    
+    quote.ask_size = 5;
+    quote.ask_price = 9950;
+    EXPECT_EQ(engine->mass_quote(1, {quote}).error_message, "Crossed quote");
+    quote.ask_price = 10003;
+    EXPECT_EQ(engine->mass_quote(1, {quote}).error_message, "Price not on tick grid");
+    EXPECT_EQ(engine->get_orders(1).size(), 1);  // Rejected batches change nothing
+}
+
+TEST_F(MarketMakerTest, BotRequotesAfterBeingHit) {
+    ASSERT_TRUE(engine->enable_market_maker(make_config()));
+    auto snapshot = engine->get_snapshot(1);
+    ASSERT_EQ(snapshot.bids.size(), 1);
+    EXPECT_EQ(snapshot.bids[0].price, 9950);
+    EXPECT_EQ(snapshot.asks[0].price, 10050);
+    
+    // Lifting the offer leaves the bot short; it requotes higher straight away
+    auto result = submit(1, Side::BUY, 10050, 10);
+    EXPECT_EQ(result.fills.size(), 2);
+    snapshot = engine->get_snapshot(1);
+    EXPECT_EQ(snapshot.bids[0].price, 9970);
+    EXPECT_EQ(snapshot.asks[0].price, 10070);
+    EXPECT_EQ(snapshot.asks[0].size, 10);
+    
+    // Steps move the fair value and requote; the walk replays identically
+    Engine replay;
+    InstrumentSpec spec;
+    spec.id = 1;
+    spec.tick_size = 5;
+    replay.add_instrument(spec);
+    replay.enable_market_maker(make_config());
+    OrderRequest req;
+    req.user_id = 1;
+    req.instrument_id = 1;
+    req.side = Side::BUY;
+    req.price = 10050;
+    req.quantity = 10;
+    replay.submit_order(req);
+    for (int i = 0; i < 20; ++i) {
+        engine->step_market_makers();
+        replay.step_market_makers();
+    }
+    EXPECT_EQ(engine->get_market_maker(1)->fair_value(), replay.get_market_maker(1)->fair_value());
+    EXPECT_EQ(engine->get_snapshot(1).bids[0].price, replay.get_snapshot(1).bids[0].price);
+    
+    EXPECT_TRUE(engine->disable_market_maker(1));
+    EXPECT_TRUE(engine->get_snapshot(1).asks.empty());
+    EXPECT_EQ(engine->get_market_maker(1), nullptr);
+}
@@ -1,5 +1,7 @@
 #include "mmg/order_book.h"
 #include <gtest/gtest.h>
+#include <random>
+#include <tuple>
 
 using namespace mmg;
 
@@ -167,3 +169,111 @@ TEST_F(OrderBookTest, Snapshot) {
     EXPECT_EQ(snapshot.asks[0].size, 150);
 }
 
+
+TEST_F(OrderBookTest, RetickKeepsTimePriority) {
+    auto early = create_order(Side::BUY, 10020, 100);
+    auto late = create_order(Side::BUY, 10040, 100);  // Better price, arrives later
+    book->add_order(early);
+    book->add_order(late);
+    book->add_order(create_order(Side::SELL, 10060, 50));
+    
+    auto repriced = book->retick(50);
+    EXPECT_EQ(repriced.size(), 3);
+    EXPECT_EQ(book->get_best_bid(), 10000);  // Rounded down
+    EXPECT_EQ(book->get_best_ask(), 10100);  // Rounded up
+    
+    auto snapshot = book->get_snapshot(10);
+    ASSERT_EQ(snapshot.bids.size(), 1);
+    EXPECT_EQ(snapshot.bids[0].size, 200);
+    
+    // Merged level fills in arrival order
+    book->add_order(create_order(Side::SELL, 10000, 100));
+    EXPECT_EQ(early->status, OrderStatus::FILLED);
+    EXPECT_EQ(late->status, OrderStatus::PENDING);
+}
+
+TEST_F(OrderBookTest, ClearRemovesEverything) {
+    auto bid = create_order(Side::BUY, 10000, 100);
+    book->add_order(bid);
+    book->add_order(create_order(Side::SELL, 10100, 100));
+    
+    auto removed = book->clear();
+    EXPECT_EQ(removed.size(), 2);
+    EXPECT_EQ(bid->status, OrderStatus::CANCELLED);
+    EXPECT_EQ(book->get_best_bid(), 0);
+    EXPECT_FALSE(book->cancel_order(bid->id));
+}
+
+TEST_F(OrderBookTest, LevelListenerReportsAggregates) {
+    std::vector<std::tuple<Side, Price, Quantity>> updates;
+    book->set_level_listener([&](Side side, Price price, Quantity size) {
+        updates.emplace_back(side, price, size);
+    });
+    
+    book->add_order(create_order(Side::SELL, 10000, 5));
+    auto second = create_order(Side::SELL, 10000, 3);
+    book->add_order(second);
+    book->add_order(create_order(Side::SELL, 10100, 2));
+    
+    // Sweeping one level and part of the next reports each level once
+    updates.clear();
+    book->add_order(create_order(Side::BUY, 10100, 9));
+    ASSERT_EQ(updates.size(), 2);
+    EXPECT_EQ(updates[0], std::make_tuple(Side::SELL, Price(10000), Quantity(0)));
+    EXPECT_EQ(updates[1], std::make_tuple(Side::SELL, Price(10100), Quantity(1)));
+    EXPECT_EQ(book->get_top_of_book().ask_size, 1);
+    
+    updates.clear();
+    book->add_order(create_order(Side::BUY, 9900, 4));
+    book->add_order(create_order(Side::BUY, 9900, 6));
+    book->clear();
+    ASSERT_EQ(updates.size(), 4);
+    EXPECT_EQ(updates[1], std::make_tuple(Side::BUY, Price(9900), Quantity(10)));
+    EXPECT_EQ(std::get<2>(updates[2]), 0);
+    EXPECT_EQ(std::get<2>(updates[3]), 0);
+}
+
+TEST_F(OrderBookTest, CachedTopFollowsEveryMutation) {
+    std::mt19937 rng(11);
+    std::vector<std::shared_ptr<Order>> resting;
+    auto check = [&] {
+        auto snapshot = book->get_snapshot(1);
+        auto tob = book->get_top_of_book();
+        ASSERT_EQ(tob.bid, snapshot.bids.empty() ? 0 : snapshot.bids[0].price);
+        ASSERT_EQ(tob.bid_size, snapshot.bids.empty() ? 0 : snapshot.bids[0].size);
+        ASSERT_EQ(tob.ask, snapshot.asks.empty() ? 0 : snapshot.asks[0].price);
+        ASSERT_EQ(tob.ask_size, snapshot.asks.empty() ? 0 : snapshot.asks[0].size);
+        ASSERT_EQ(book->get_best_bid(), tob.bid);
+        ASSERT_EQ(book->get_best_ask(), tob.ask);
+    };
+    
+    for (int i = 0; i < 2000; ++i) {
+        Side side = rng() % 2 ? Side::BUY : Side::SELL;
+        Price price = 100 + rng() % 21;  // Overlapping ranges cross often
+        auto order = create_order(side, price, 1 + rng() % 5,
+                                  rng() % 5 ? TimeInForce::GFD : TimeInForce::IOC);
+        book->add_order(order);
+        if (order->status == OrderStatus::PENDING || order->status == OrderStatus::PARTIAL) {
+            resting.push_back(order);
+        }
+        check();
+        
+        switch (rng() % 8) {
+            case 0:
+                if (!resting.empty()) book->cancel_order(resting[rng() % resting.size()]->id);
+                break;
+            case 1:
+                if (auto front = book->get_front_order(Side::BUY)) {
+                    book->fill_resting(front->id, 1, front->price);
+                }
+                break;
+            case 2:
+                if (i % 100 == 2) book->retick(1 + rng() % 4);
+                break;
+            case 3:
+                if (i % 500 == 3) book->clear();
+                break;
+        }
+        check();
+    }
+}
@@ -190,3 +190,42 @@ TEST_F(PnLTest, MultipleUsers) {
     EXPECT_NEAR(pnl1 + pnl2, 0.0, 0.01);
 }
 
+
+TEST_F(PnLTest, PriceScaleResolvedOnAdd) {
+    InstrumentSpec spec;
+    spec.id = 4;
+    spec.symbol = "FINE";
+    spec.price_decimals = 4;
+    spec.price_scale = 0;  // Ignored, resolved from decimals
+    ASSERT_TRUE(engine->add_instrument(spec));
+    
+    auto* inst = engine->get_instrument(4);
+    ASSERT_NE(inst, nullptr);
+    EXPECT_EQ(inst->price_scale, 10000);
+    
+    InstrumentSpec too_fine;
+    too_fine.id = 5;
+    too_fine.price_decimals = kMaxPriceDecimals + 1;
+    EXPECT_FALSE(engine->add_instrument(too_fine));
+}
+
+TEST_F(PnLTest, FourDecimalInstrumentPnL) {
+    InstrumentSpec spec;
+    spec.id = 4;
+    spec.symbol = "FINE";
+    spec.tick_size = 1;  // 0.0001
+    spec.price_decimals = 4;
+    engine->add_instrument(spec);
+    
+    // User 1 buys 100 @ 1.2345, sells 100 @ 1.2350
+    engine->submit_order(create_request(1, 4, Side::BUY, 12345, 100));
+    engine->submit_order(create_request(2, 4, Side::SELL, 12345, 100));
+    engine->submit_order(create_request(3, 4, Side::BUY, 12350, 100));
+    engine->submit_order(create_request(1, 4, Side::SELL, 12350, 100));
+    
+    EXPECT_NEAR(engine->get_total_pnl(1), 0.05, 1e-9);  // 0.0005 * 100
+    
+    // User 2 is short 100 @ 1.2345 and settles at 1.2000
+    engine->settle_instrument(4, 12000);
+    EXPECT_NEAR(engine->get_total_pnl(2), 3.45, 1e-9);
+}
@@ -0,0 +1,261 @@
+#include "mmg/replication.h"
+#include "mmg/command_log.h"
+#include <gtest/gtest.h>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace mmg;
+
+namespace {
+
+OrderRequest order(UserId user, Side side, Price price, Quantity qty) {
+    OrderRequest request;
+    request.user_id = user;
+    request.instrument_id = 1;
+    request.side = side;
+    request.price = price;
+    request.quantity = qty;
+    return request;
+}
+
+// Exercises every kind of nested command: replace (cancel + submit),
+// market maker requotes (mass quotes) and fills against the house
+void run_script(Engine& engine) {
+    InstrumentSpec spec;
+    spec.id = 1;
+    spec.symbol = "TEST";
+    engine.add_instrument(spec);
+    engine.annotate("session-start");
+    
+    MarketMakerConfig mm;
+    mm.instrument_id = 1;
+    mm.user_id = 99;
+    mm.fair_value = 10000;
+    mm.half_spread = 20;
+    mm.size = 5;
+    mm.max_inventory = 50;
+    mm.skew = 0.5;
+    mm.fair_step_ticks = 3;
+    mm.seed = 42;
+    engine.enable_market_maker(mm);
+    
+    for (int i = 0; i < 300; ++i) {
+        Price offset = i % 40;
+        auto bid = engine.submit_order(order(1, Side::BUY, 9990 + offset, 1 + i % 4));
+        engine.submit_order(order(2, Side::SELL, 10010 - offset, 1 + i % 3));
+        if (i % 7 == 0) engine.cancel_order(bid.order_id, 1);
+        if (i % 11 == 0) {
+            Price price = 9995 + offset;
+            engine.replace_order(bid.order_id, 1, &price, nullptr);
+        }
+        if (i % 5 == 0) engine.step_market_makers();
+        if (i == 150) engine.set_aggregate_fills(true);
+    }
+    engine.cancel_all(2);
+}
+
+void expect_same_state(const Engine& a, const Engine& b) {
+    EXPECT_EQ(a.command_count(), b.command_count());
+    EXPECT_EQ(a.last_seq(), b.last_seq());
+    
+    const auto& fills_a = a.get_fill_history();
+    const auto& fills_b = b.get_fill_history();
+    ASSERT_EQ(fills_a.size(), fills_b.size());
+    for (size_t i = 0; i < fills_a.size(); ++i) {
+        EXPECT_EQ(fills_a[i].order_id, fills_b[i].order_id);
+        EXPECT_EQ(fills_a[i].user_id, fills_b[i].user_id);
+        EXPECT_EQ(fills_a[i].price, fills_b[i].price);
+        EXPECT_EQ(fills_a[i].quantity, fills_b[i].quantity);
+    }
+    
+    auto book_a = a.get_snapshot(1, SIZE_MAX);
+    auto book_b = b.get_snapshot(1, SIZE_MAX);
+    EXPECT_EQ(book_a.seq, book_b.seq);
+    ASSERT_EQ(book_a.bids.size(), book_b.bids.size());
+    ASSERT_EQ(book_a.asks.size(), book_b.asks.size());
+    for (size_t i = 0; i < book_a.bids.size(); ++i) {
+        EXPECT_EQ(book_a.bids[i].price, book_b.bids[i].price);
+        EXPECT_EQ(book_a.bids[i].size, book_b.bids[i].size);
+    }
+    for (size_t i = 0; i < book_a.asks.size(); ++i) {
+        EXPECT_EQ(book_a.asks[i].price, book_b.asks[i].price);
+        EXPECT_EQ(book_a.asks[i].size, book_b.asks[i].size);
+    }
+    
+    for (UserId user : {1, 2, 99}) {
+        auto positions_a = a.get_positions(user);
+        auto positions_b = b.get_positions(user);
+        ASSERT_EQ(positions_a.size(), positions_b.size());
+        for (size_t i = 0; i < positions_a.size(); ++i) {
+            EXPECT_EQ(positions_a[i].net_qty, positions_b[i].net_qty);
+            EXPECT_EQ(positions_a[i].vwap, positions_b[i].vwap);
+            EXPECT_DOUBLE_EQ(positions_a[i].realized_pnl, positions_b[i].realized_pnl);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(ReplicationTest, CommandStreamReplaysExactly) {
+    Engine primary;
+    std::vector<std::vector<uint8_t>> frames;
+    primary.set_command_sink([&](const uint8_t* frame, size_t size) {
+        frames.emplace_back(frame, frame + size);
+    });
+    run_script(primary);
+    ASSERT_EQ(frames.size(), primary.command_count());
+    
+    Engine replica;
+    for (const auto& frame : frames) ASSERT_TRUE(replica.apply_command(frame.data(), frame.size()));
+    expect_same_state(primary, replica);
+    
+    // The primary's clock comes along, down to fill and journal timestamps
+    const auto& fills = replica.get_fill_history();
+    ASSERT_FALSE(fills.empty());
+    EXPECT_EQ(fills.back().timestamp_ns, primary.get_fill_history().back().timestamp_ns);
+    EXPECT_EQ(fills.back().seq, primary.get_fill_history().back().seq);
+    EXPECT_EQ(replica.get_journal().records().back().timestamp,
+              primary.get_journal().records().back().timestamp);
+    
+    // Replaying, skipping or truncating frames is refused without effect
+    uint64_t seq = replica.last_seq();
+    EXPECT_FALSE(replica.apply_command(frames.back().data(), frames.back().size()));
+    Engine fresh;
+    EXPECT_FALSE(fresh.apply_command(frames[1].data(), frames[1].size()));
+    EXPECT_FALSE(fresh.apply_command(frames[0].data(), frames[0].size() - 1));
+    EXPECT_FALSE(fresh.apply_command(frames[0].data(), kCommandHeaderSize - 1));
+    EXPECT_EQ(replica.last_seq(), seq);
+    EXPECT_EQ(fresh.command_count(), 0);
+}
+
+// Primary in a child process, standby here; the child is SIGKILLed mid-session
+TEST(ReplicationTest, StandbyTakesOverAfterPrimaryKilled) {
+    std::string path = "/tmp/mmg_replication_" + std::to_string(getpid()) + ".sock";
+    int ready[2];
+    ASSERT_EQ(pipe(ready), 0);
+    
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        close(ready[0]);
+        Engine primary;
+        ReplicationServer server(path);
+        server.attach(primary);
+        char ok = server.listening() ? 1 : 0;
+        (void)!write(ready[1], &ok, 1);
+        while (server.replicas() == 0) {
+            server.flush();
+            usleep(1000);
+        }
+        run_script(primary);
+        while (true) {
+            server.flush();
+            usleep(1000);
+        }
+    }
+    
+    close(ready[1]);
+    char ok = 0;
+    ASSERT_EQ(read(ready[0], &ok, 1), 1);
+    close(ready[0]);
+    ASSERT_EQ(ok, 1);
+    
+    Engine standby;
+    ReplicationClient client(standby, path);
+    ASSERT_TRUE(client.connect());
+    
+    Engine reference;
+    run_script(reference);
+    for (int i = 0; i < 5000 && client.applied() < reference.command_count(); ++i) {
+        ASSERT_TRUE(client.poll(10));
+    }
+    ASSERT_EQ(client.applied(), reference.command_count());
+    auto annotations = client.take_annotations();
+    ASSERT_EQ(annotations.size(), 1);
+    EXPECT_EQ(annotations[0], "session-start");
+    
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    bool following = true;
+    for (int i = 0; i < 500 && following; ++i) following = client.poll(10);
+    EXPECT_FALSE(following);
+    EXPECT_FALSE(client.diverged());
+    
+    // Takeover: new orders get the ids the primary would have issued
+    expect_same_state(reference, standby);
+    for (int i = 0; i < 20; ++i) {
+        auto expected = reference.submit_order(order(3, Side::BUY, 10100, 2));
+        auto actual = standby.submit_order(order(3, Side::BUY, 10100, 2));
+        EXPECT_EQ(actual.order_id, expected.order_id);
+        EXPECT_EQ(actual.fills.size(), expected.fills.size());
+    }
+    expect_same_state(reference, standby);
+}
+
+// Past its limit the log keeps only what the connected replica has not had; a
+// replica connecting after that cannot rebuild the room and says so
+TEST(ReplicationTest, LogIsTrimmedBehindConnectedReplicas) {
+    std::string path = "/tmp/mmg_replication_trim_" + std::to_string(getpid()) + ".sock";
+    Engine primary;
+    ReplicationServer server(path, 4096);
+    ASSERT_TRUE(server.listening());
+    server.attach(primary);
+    
+    Engine standby;
+    ReplicationClient client(standby, path);
+    ASSERT_TRUE(client.connect());
+    server.flush();
+    ASSERT_EQ(server.replicas(), 1);
+    
+    run_script(primary);
+    for (int i = 0; i < 5000 && client.applied() < primary.command_count(); ++i) {
+        server.flush();
+        ASSERT_TRUE(client.poll(10));
+    }
+    server.flush();
+    expect_same_state(primary, standby);
+    EXPECT_GT(server.log_start(), 0);
+    EXPECT_LE(server.log_size(), 4096);
+    EXPECT_LE(server.memory_usage().used, 4096);
+    
+    Engine late;
+    ReplicationClient late_client(late, path);
+    ASSERT_TRUE(late_client.connect());
+    primary.annotate("after-trim");
+    bool following = true;
+    for (int i = 0; i < 500 && following; ++i) {
+        server.flush();
+        following = late_client.poll(10);
+    }
+    EXPECT_FALSE(following);
+    EXPECT_TRUE(late_client.diverged());
+    EXPECT_EQ(late.command_count(), 0);
+    
+    ASSERT_TRUE(client.poll(10));
+    EXPECT_EQ(client.applied(), primary.command_count());
+}
+
+// A length past kMaxCommandFrameSize is corruption, not a frame to wait for
+TEST(ReplicationTest, OversizedFrameDiverges) {
+    std::string path = "/tmp/mmg_replication_big_" + std::to_string(getpid()) + ".sock";
+    ReplicationServer server(path);
+    ASSERT_TRUE(server.listening());
+    
+    Engine standby;
+    ReplicationClient client(standby, path);
+    ASSERT_TRUE(client.connect());
+    server.flush();
+    
+    std::vector<uint8_t> frame(kCommandHeaderSize, 0);
+    uint32_t body = static_cast<uint32_t>(kMaxCommandFrameSize);
+    std::memcpy(frame.data(), &body, sizeof(body));
+    server.publish(frame.data(), frame.size());
+    
+    bool following = true;
+    for (int i = 0; i < 100 && following; ++i) following = client.poll(10);
+    EXPECT_FALSE(following);
+    EXPECT_TRUE(client.diverged());
+}
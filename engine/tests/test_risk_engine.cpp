@@ -0,0 +1,128 @@
+#include "mmg/engine.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace mmg;
+
+class RiskEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        engine = std::make_unique<Engine>();
+
+        InstrumentSpec scalar;
+        scalar.id = 1;
+        scalar.symbol = "SCALAR";
+        scalar.type = InstrumentType::SCALAR;
+        engine->add_instrument(scalar);
+
+        InstrumentSpec call;
+        call.id = 2;
+        call.symbol = "CALL-100";
+        call.type = InstrumentType::CALL;
+        call.reference_id = 1;
+        call.strike = 10000;
+        engine->add_instrument(call);
+
+        InstrumentSpec put;
+        put.id = 3;
+        put.symbol = "PUT-100";
+        put.type = InstrumentType::PUT;
+        put.reference_id = 1;
+        put.strike = 10000;
+        engine->add_instrument(put);
+
+        RiskParams params;
+        params.volatility = 0.2;
+        params.time_to_expiry = 0.5;
+        params.rate = 0.0;
+        params.scenario_moves = {-0.2, 0.0, 0.2};
+        engine->set_risk_params(params);
+    }
+
+    std::unique_ptr<Engine> engine;
+
+    void trade(UserId buyer, UserId seller, InstrumentId inst, Price price, Quantity qty) {
+        OrderRequest req;
+        req.instrument_id = inst;
+        req.price = price;
+        req.quantity = qty;
+        req.user_id = buyer;
+        req.side = Side::BUY;
+        engine->submit_order(req);
+        req.user_id = seller;
+        req.side = Side::SELL;
+        engine->submit_order(req);
+    }
+};
+
+TEST_F(RiskEngineTest, ScenarioPnLMatchesSettlement) {
+    trade(1, 2, 2, 500, 10);     // User 1 long 10 calls @ 5.00
+    trade(3, 4, 1, 10000, 1);    // Underlying marks at 100.00
+
+    auto report = engine->get_user_risk(1);
+    ASSERT_EQ(report.underlyings.size(), 1);
+    const auto& u = report.underlyings[0];
+    EXPECT_EQ(u.underlying_id, 1);
+    EXPECT_NEAR(u.spot, 100.0, 1e-9);
+
+    ASSERT_EQ(u.scenario_pnl.size(), 3);
+    EXPECT_NEAR(u.scenario_spots[0], 80.0, 1e-9);
+    EXPECT_NEAR(u.scenario_pnl[0], -50.0, 1e-9);   // Expires worthless
+    EXPECT_NEAR(u.scenario_pnl[1], -50.0, 1e-9);   // At the money
+    EXPECT_NEAR(u.scenario_pnl[2], 150.0, 1e-9);   // (20 - 5) * 10
+
+    // ATM call delta is a bit above one half
+    EXPECT_GT(u.delta, 5.0);
+    EXPECT_LT(u.delta, 6.0);
+    EXPECT_GT(u.gamma, 0.0);
+    EXPECT_GT(u.vega, 0.0);
+    EXPECT_LT(u.theta, 0.0);
+}
+
+TEST_F(RiskEngineTest, SyntheticForwardHasUnitDelta) {
+    trade(1, 2, 2, 500, 10);     // Long calls
+    trade(2, 1, 3, 500, 10);     // Short puts
+    trade(3, 4, 1, 10500, 1);
+
+    auto report = engine->get_user_risk(1);
+    ASSERT_EQ(report.underlyings.size(), 1);
+    const auto& u = report.underlyings[0];
+    EXPECT_NEAR(u.delta, 10.0, 1e-9);   // Put-call parity with r = 0
+    EXPECT_NEAR(u.gamma, 0.0, 1e-9);
+}
+
+TEST_F(RiskEngineTest, RoomRiskIsZeroSum) {
+    trade(1, 2, 2, 500, 10);
+    trade(2, 3, 3, 300, 5);
+    trade(3, 1, 1, 10000, 7);
+
+    auto room = engine->get_room_risk();
+    ASSERT_EQ(room.underlyings.size(), 1);
+    const auto& u = room.underlyings[0];
+    EXPECT_NEAR(u.delta, 0.0, 1e-9);
+    for (double pnl : u.scenario_pnl) {
+        EXPECT_NEAR(pnl, 0.0, 1e-9);
+    }
+}
+
+TEST_F(RiskEngineTest, SettlementMovesPositionToCash) {
+    trade(1, 2, 2, 500, 10);
+    trade(3, 4, 1, 10000, 1);
+
+    engine->settle_instrument(2, 12000);
+
+    auto u = engine->get_user_risk(1).underlyings[0];
+    EXPECT_NEAR(u.delta, 0.0, 1e-9);
+    for (double pnl : u.scenario_pnl) {
+        EXPECT_NEAR(pnl, 150.0, 1e-9);  // Locked in regardless of scenario
+    }
+}
+
+TEST_F(RiskEngineTest, NoSpotMeansNoGrid) {
+    trade(1, 2, 2, 500, 10);  // Underlying never traded
+
+    auto u = engine->get_user_risk(1).underlyings[0];
+    EXPECT_EQ(u.spot, 0.0);
+    EXPECT_TRUE(u.scenario_pnl.empty());
+    EXPECT_EQ(u.delta, 0.0);
+}
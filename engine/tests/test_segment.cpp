@@ -0,0 +1,112 @@
+#include "mmg/segment.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace mmg;
+
+namespace {
+
+std::vector<Fill> random_fills(size_t count) {
+    std::mt19937_64 rng(7);
+    std::vector<Fill> fills(count);
+    int64_t t = to_nanos(std::chrono::system_clock::now());
+    uint64_t seq = 1;
+    for (size_t i = 0; i < count; ++i) {
+        t += rng() % 5000;
+        seq += 1 + rng() % 4;  // Other events interleave
+        fills[i].seq = seq;
+        fills[i].timestamp_ns = t;
+        fills[i].order_id = 1 + i / 2 + rng() % 3;
+        fills[i].user_id = 1 + rng() % 12;
+        fills[i].instrument_id = 1 + rng() % 4;
+        fills[i].side = rng() % 2 ? Side::BUY : Side::SELL;
+        fills[i].aggressor = rng() % 3 == 0;
+        fills[i].price = static_cast<Price>(rng() % 200) - 100;  // Spreads go negative
+        fills[i].quantity = 1 + rng() % 50;
+    }
+    return fills;
+}
+
+}  // namespace
+
+TEST(SegmentTest, FillsRoundTrip) {
+    auto fills = random_fills(5000);
+    fills[17].order_id = UINT64_MAX;  // Deltas wrap
+    
+    for (auto compression : {segment::Compression::NONE, segment::Compression::LZ}) {
+        auto bytes = segment::encode_fills(fills, compression);
+        EXPECT_LT(bytes.size(), fills.size() * sizeof(Fill) / 4);
+        
+        std::vector<Fill> decoded;
+        ASSERT_TRUE(segment::decode_fills(bytes.data(), bytes.size(), decoded));
+        ASSERT_EQ(decoded.size(), fills.size());
+        for (size_t i = 0; i < fills.size(); ++i) {
+            EXPECT_EQ(decoded[i].seq, fills[i].seq);
+            EXPECT_EQ(decoded[i].timestamp_ns, fills[i].timestamp_ns);
+            EXPECT_EQ(decoded[i].order_id, fills[i].order_id);
+            EXPECT_EQ(decoded[i].user_id, fills[i].user_id);
+            EXPECT_EQ(decoded[i].instrument_id, fills[i].instrument_id);
+            EXPECT_EQ(decoded[i].side, fills[i].side);
+            EXPECT_EQ(decoded[i].aggressor, fills[i].aggressor);
+            EXPECT_EQ(decoded[i].price, fills[i].price);
+            EXPECT_EQ(decoded[i].quantity, fills[i].quantity);
+        }
+    }
+    
+    std::vector<Fill> empty;
+    auto bytes = segment::encode_fills(empty);
+    ASSERT_TRUE(segment::decode_fills(bytes.data(), bytes.size(), empty));
+    EXPECT_TRUE(empty.empty());
+}
+
+TEST(SegmentTest, JournalRoundTrip) {
+    BookJournal journal;
+    Timestamp t = std::chrono::system_clock::now();
+    for (uint64_t seq = 1; seq <= 1000; ++seq) {
+        Side side = seq % 3 ? Side::BUY : Side::SELL;
+        journal.record(seq, t + std::chrono::microseconds(seq),
+                       {static_cast<InstrumentId>(1 + seq % 2), side,
+                        static_cast<Price>(9990 + seq % 20), static_cast<Quantity>(seq % 7)});
+    }
+    
+    auto bytes = segment::encode_journal(journal.records());
+    std::vector<JournalRecord> decoded;
+    ASSERT_TRUE(segment::decode_journal(bytes.data(), bytes.size(), decoded));
+    ASSERT_EQ(decoded.size(), journal.size());
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        const auto& expected = journal.records()[i];
+        EXPECT_EQ(decoded[i].seq, expected.seq);
+        EXPECT_EQ(decoded[i].timestamp, expected.timestamp);
+        EXPECT_EQ(decoded[i].level.instrument_id, expected.level.instrument_id);
+        EXPECT_EQ(decoded[i].level.side, expected.level.side);
+        EXPECT_EQ(decoded[i].level.price, expected.level.price);
+        EXPECT_EQ(decoded[i].level.size, expected.level.size);
+    }
+    
+    // Kinds are not interchangeable
+    std::vector<Fill> fills;
+    EXPECT_FALSE(segment::decode_fills(bytes.data(), bytes.size(), fills));
+}
+
+TEST(SegmentTest, LzRoundTripAndRejectsCorruption) {
+    std::mt19937_64 rng(3);
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 20000; ++i) data.push_back(i % 1000 < 600 ? 'a' + i % 7 : rng() % 256);
+    
+    auto packed = segment::lz_compress(data.data(), data.size());
+    EXPECT_LT(packed.size(), data.size());
+    std::vector<uint8_t> unpacked;
+    ASSERT_TRUE(segment::lz_decompress(packed.data(), packed.size(), data.size(), unpacked));
+    EXPECT_EQ(unpacked, data);
+    
+    EXPECT_FALSE(segment::lz_decompress(packed.data(), packed.size() - 1, data.size(), unpacked));
+    EXPECT_TRUE(unpacked.empty());
+    EXPECT_FALSE(segment::lz_decompress(packed.data(), packed.size(), data.size() + 1, unpacked));
+    
+    // Every truncation of a segment fails cleanly
+    auto bytes = segment::encode_fills(random_fills(200));
+    std::vector<Fill> fills;
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        EXPECT_FALSE(segment::decode_fills(bytes.data(), size, fills));
+    }
+}
@@ -6,6 +6,7 @@ import '../models/models.dart';
 
 class WebSocketService extends ChangeNotifier {
   WebSocketChannel? _channel;
+  String? _url;
   final _messageController = StreamController<Map<String, dynamic>>.broadcast();
   final _marketDataController = StreamController<MarketData>.broadcast();
   final _fillController = StreamController<Fill>.broadcast();
@@ -36,22 +37,26 @@ class WebSocketService extends ChangeNotifier {
   void connect(String url) {
     try {
       debugPrint('🔌 Connecting to WebSocket: $url');
-      _channel = WebSocketChannel.connect(Uri.parse(url));
+      final channel = WebSocketChannel.connect(Uri.parse(url));
+      _channel = channel;
+      _url = url;
       _isConnected = true;
       notifyListeners();
       debugPrint('✅ WebSocket connected, notifying listeners');
       
-      _channel!.stream.listen(
+      channel.stream.listen(
         (message) {
           final data = jsonDecode(message as String) as Map<String, dynamic>;
           _handleMessage(data);
         },
         onDone: () {
+          if (!identical(channel, _channel)) return;  // Replaced by _routeToRoom
           debugPrint('❌ WebSocket connection closed');
           _isConnected = false;
           notifyListeners();
         },
         onError: (error) {
+          if (!identical(channel, _channel)) return;
           debugPrint('❌ WebSocket error: $error');
           _isConnected = false;
           notifyListeners();
@@ -258,7 +263,20 @@ class WebSocketService extends ChangeNotifier {
     });
   }
   
+  // Sharded gateways route a connection by its ?room= parameter, so move to
+  // the worker hosting the room before joining it
+  void _routeToRoom(String roomCode) {
+    final url = _url;
+    if (url == null) return;
+    final uri = Uri.parse(url);
+    if (uri.queryParameters['room'] == roomCode) return;
+    final previous = _channel;
+    connect(uri.replace(queryParameters: {...uri.queryParameters, 'room': roomCode}).toString());
+    previous?.sink.close();
+  }
+  
   void joinRoom(String roomCode, String name, String role, {String? passcode}) {
+    _routeToRoom(roomCode);
     send({
       'op': 'join',
       'room': roomCode,
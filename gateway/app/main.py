@@ -7,11 +7,14 @@ from fastapi import FastAPI, WebSocket, WebSocketDisconnect
 from fastapi.middleware.cors import CORSMiddleware
 from contextlib import asynccontextmanager
 import uvicorn
+import asyncio
 import logging
+import os
 from typing import Dict
 
 from .session_manager import SessionManager
 from .ws_handler import WebSocketHandler
+from .standby import Standby
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
@@ -23,7 +26,17 @@ session_manager = SessionManager()
 async def lifespan(app: FastAPI):
     """Startup and shutdown logic"""
     logger.info("Starting Market Making Game Gateway")
+    
+    # As a hot standby, follow a primary's rooms and take them over if it dies
+    standby_task = None
+    standby_dir = os.environ.get("MMG_STANDBY_DIR")
+    if standby_dir:
+        standby_task = asyncio.create_task(Standby(session_manager, standby_dir).run())
+    
     yield
+    
+    if standby_task:
+        standby_task.cancel()
     logger.info("Shutting down and exporting session data")
     await session_manager.shutdown()
 
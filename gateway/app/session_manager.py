@@ -4,13 +4,16 @@ Manages trading sessions, room codes, and engine instances
 """
 
 import asyncio
+import contextlib
 import logging
 import secrets
+import struct
 import time
 from typing import Dict, Optional, Set, List
 from dataclasses import dataclass, field
 from datetime import datetime
 import csv
+import json
 import os
 
 # Import will work after engine is built
@@ -23,6 +26,20 @@ except ImportError:
 
 logger = logging.getLogger(__name__)
 
+# Engine memory accounting areas reported per room on /stats
+MEMORY_AREAS = ("books", "orders", "positions", "history", "indexes", "events")
+
+# Room codes shard on their first hex digit, so at most 16 workers get rooms
+MAX_SHARDS = 16
+
+def shard_of(room_code: str, shard_count: int) -> int:
+    """Gateway worker hosting a room: its first hex digit modulo the worker count.
+    docker/nginx.conf routes ?room= with the same rule."""
+    try:
+        return int(room_code[:1], 16) % shard_count
+    except ValueError:
+        return 0
+
 @dataclass
 class User:
     user_id: int
@@ -33,6 +50,10 @@ class User:
     joined_at: float = field(default_factory=time.time)
     order_count: int = 0
     last_order_time: float = 0.0
+    md_deltas: bool = False  # Snapshot-plus-delta market data instead of periodic full books
+    md_all: bool = True  # Follow every book until the client subscribes explicitly
+    md_depth: int = 5
+    l3_binary: bool = False  # L3 events as encoded batches instead of JSON rows
 
 @dataclass
 class Session:
@@ -45,53 +66,102 @@ class Session:
     instruments: Dict[int, dict] = field(default_factory=dict)
     next_instrument_id: int = 1
     is_active: bool = True
+    house_user_id: Optional[int] = None  # Account the built-in market makers quote from
+    replication: Optional[object] = None  # mmg_engine.ReplicationServer feeding standbys
+    replicated_metadata: str = ""
+    # Serializes this room's joins, leaves and engine commands
+    lock: asyncio.Lock = field(default_factory=asyncio.Lock, repr=False, compare=False)
 
 class SessionManager:
     def __init__(self):
         self.sessions: Dict[str, Session] = {}
+        # Registry updates never await, so they are atomic on the event loop and
+        # lookups need no lock; each room serializes its own work on session.lock
         self.user_to_session: Dict[int, str] = {}
-        self.lock = asyncio.Lock()
         self.broadcast_tasks: Dict[str, asyncio.Task] = {}
+        # Rooms are sharded across worker processes; each hosts its own engines
+        self.configure_shards(int(os.environ.get("MMG_SHARD_INDEX", 0)),
+                              int(os.environ.get("MMG_SHARD_COUNT", 1)))
+        # Set when worker i listens on base port + i (scripts/run_shards.sh)
+        base_port = os.environ.get("MMG_SHARD_BASE_PORT")
+        self.shard_base_port = int(base_port) if base_port else None
+        # Rooms publish their engine commands to {dir}/{room}.sock for standbys
+        self.replication_dir = os.environ.get("MMG_REPLICATION_DIR")
+        # Sweeps report one aggressor fill per price level, not per resting order
+        self.aggregate_fills = os.environ.get("MMG_AGGREGATE_FILLS") == "1"
         
+    def configure_shards(self, shard_index: int, shard_count: int):
+        """Host shard shard_index of shard_count. Refused up front when this
+        worker could never own a room, as generate_room_code would spin forever"""
+        if not 1 <= shard_count <= MAX_SHARDS:
+            raise ValueError(f"MMG_SHARD_COUNT must be 1..{MAX_SHARDS}, got {shard_count}: "
+                             f"rooms shard on one hex digit")
+        if not 0 <= shard_index < shard_count:
+            raise ValueError(f"MMG_SHARD_INDEX must be 0..{shard_count - 1}, got {shard_index}")
+        self.shard_index = shard_index
+        self.shard_count = shard_count
+    
     def generate_room_code(self) -> str:
-        """Generate a unique 6-character room code"""
+        """Generate a unique 6-character room code that routes to this worker"""
         while True:
             code = secrets.token_hex(3).upper()
-            if code not in self.sessions:
+            if code not in self.sessions and self.owns_room(code):
                 return code
     
+    def owns_room(self, room_code: str) -> bool:
+        """Whether rooms with this code are hosted by this worker"""
+        return shard_of(room_code, self.shard_count) == self.shard_index
+    
+    def room_host(self, room_code: str) -> str:
+        """The worker hosting a room, as named in wrong-worker errors"""
+        shard = shard_of(room_code, self.shard_count)
+        if self.shard_base_port is None:
+            return f"gateway worker {shard} of {self.shard_count}"
+        return f"gateway worker {shard} of {self.shard_count} (port {self.shard_base_port + shard})"
+    
     async def create_session(self, passcode: Optional[str] = None) -> str:
         """Create a new trading session"""
-        async with self.lock:
-            room_code = self.generate_room_code()
-            
-            if ENGINE_AVAILABLE:
-                engine = mmg_engine.Engine()
-            else:
-                engine = MockEngine()
-            
-            session = Session(
-                room_code=room_code,
-                engine=engine,
-                passcode=passcode
-            )
-            
-            self.sessions[room_code] = session
-            logger.info(f"Created session {room_code}")
-            
-            return room_code
+        room_code = self.generate_room_code()
+        
+        if ENGINE_AVAILABLE:
+            engine = mmg_engine.Engine()
+        else:
+            engine = MockEngine()
+        
+        session = Session(
+            room_code=room_code,
+            engine=engine,
+            passcode=passcode
+        )
+        
+        self.sessions[room_code] = session
+        self.start_replication(session)
+        if self.aggregate_fills:
+            engine.set_aggregate_fills(True)  # After attach, so standbys follow
+        logger.info(f"Created session {room_code}")
+        
+        return room_code
     
     async def join_session(self, room_code: str, name: str, role: str,
-                          passcode: Optional[str] = None) -> Optional[User]:
-        """Join an existing session"""
-        async with self.lock:
-            session = self.sessions.get(room_code)
-            if not session:
-                return None
-            
+                          passcode: Optional[str] = None,
+                          resume_token: Optional[str] = None) -> Optional[User]:
+        """Join an existing session, or take back a seat by its resume token"""
+        session = self.sessions.get(room_code)
+        if not session:
+            return None
+        
+        async with session.lock:
             if session.passcode and session.passcode != passcode:
                 return None
             
+            if resume_token:
+                for user in session.users.values():
+                    if secrets.compare_digest(user.resume_token, resume_token):
+                        session.is_active = True
+                        self.user_to_session[user.user_id] = room_code
+                        logger.info(f"User {user.user_id} resumed in session {room_code}")
+                        return user
+            
             if not session.is_active:
                 return None
             
@@ -123,6 +193,7 @@ class SessionManager:
                 session.engine.set_risk_limits(user_id, limits)
             
             logger.info(f"User {user_id} ({name}) joined session {room_code} as {role}")
+            self.replicate(session)
             
             return user
     
@@ -130,6 +201,11 @@ class SessionManager:
         """Get session by room code"""
         return self.sessions.get(room_code)
     
+    def command_lock(self, room_code: Optional[str]):
+        """Lock serializing a room's engine commands; unknown rooms get a no-op"""
+        session = self.sessions.get(room_code) if room_code else None
+        return session.lock if session else contextlib.nullcontext()
+    
     def get_user_session(self, user_id: int) -> Optional[Session]:
         """Get session for a user"""
         room_code = self.user_to_session.get(user_id)
@@ -139,35 +215,135 @@ class SessionManager:
     
     async def leave_session(self, user_id: int):
         """Remove user from session"""
-        async with self.lock:
-            session = self.get_user_session(user_id)
-            if session:
-                if user_id in session.users:
-                    del session.users[user_id]
-                    logger.info(f"User {user_id} left session {session.room_code}")
-                
-                if user_id in self.user_to_session:
-                    del self.user_to_session[user_id]
-                
-                # If no users left, mark for cleanup
-                if not session.users:
-                    session.is_active = False
+        session = self.get_user_session(user_id)
+        if not session:
+            return
+        
+        async with session.lock:
+            if user_id in session.users:
+                del session.users[user_id]
+                logger.info(f"User {user_id} left session {session.room_code}")
+            
+            if user_id in self.user_to_session:
+                del self.user_to_session[user_id]
+            
+            # If no users left, mark for cleanup
+            if not session.users:
+                session.is_active = False
     
     async def broadcast_to_session(self, room_code: str, message: dict, exclude_user: Optional[int] = None):
-        """Broadcast message to all users in a session"""
+        """Broadcast message to all users in a session, stamped with the engine's last seq"""
         session = self.sessions.get(room_code)
         if not session:
             return
         
-        tasks = []
-        for user_id, user in session.users.items():
-            if user_id == exclude_user:
-                continue
-            if user.websocket:
-                tasks.append(user.websocket.send_json(message))
+        await self.deliver(self.outgoing(
+            room_code, [user_id for user_id in session.users if user_id != exclude_user], message))
+    
+    async def send_to_users(self, room_code: str, user_ids, message: dict):
+        """Send one encoded message to some users of a session, stamped like broadcasts"""
+        await self.deliver(self.outgoing(room_code, user_ids, message))
+    
+    def outgoing(self, room_code: str, user_ids, message: dict) -> list:
+        """(websocket, message) pairs for some users of a session. A message
+        without its own event seq is stamped with the engine's last seq now,
+        not when it is delivered"""
+        session = self.sessions.get(room_code)
+        if not session:
+            return []
+        
+        if "seq" not in message:
+            message = {**message, "seq": session.engine.last_seq}
+        
+        pairs = []
+        for user_id in user_ids:
+            user = session.users.get(user_id)
+            if user and user.websocket:
+                pairs.append((user.websocket, message))
+        return pairs
+    
+    @staticmethod
+    async def deliver(pairs: list):
+        """Send (websocket, message) pairs, bytes as binary frames. Sockets are
+        written concurrently, each one's messages in order; a failed socket
+        only loses its own messages"""
+        by_socket = {}
+        for websocket, message in pairs:
+            by_socket.setdefault(websocket, []).append(message)
+        
+        async def send_all(websocket, messages):
+            for message in messages:
+                if isinstance(message, bytes):
+                    await websocket.send_bytes(message)
+                else:
+                    await websocket.send_json(message)
         
-        if tasks:
-            await asyncio.gather(*tasks, return_exceptions=True)
+        if by_socket:
+            await asyncio.gather(*(send_all(websocket, messages)
+                                   for websocket, messages in by_socket.items()),
+                                 return_exceptions=True)
+    
+    def start_replication(self, session: Session):
+        """Publish a room's engine commands for standbys, when a directory is configured"""
+        if not self.replication_dir or not ENGINE_AVAILABLE:
+            return
+        os.makedirs(self.replication_dir, exist_ok=True)
+        server = mmg_engine.ReplicationServer(
+            os.path.join(self.replication_dir, f"{session.room_code}.sock"))
+        if not server.listening():
+            logger.warning(f"Replication unavailable for session {session.room_code}")
+            return
+        server.attach(session.engine)
+        session.replication = server
+    
+    def session_metadata(self, session: Session) -> dict:
+        """Gateway-side room state a standby needs besides the engine"""
+        return {
+            "room_code": session.room_code,
+            "passcode": session.passcode,
+            "users": [
+                {"user_id": u.user_id, "name": u.name, "role": u.role,
+                 "resume_token": u.resume_token}
+                for u in session.users.values()
+            ],
+            "instruments": list(session.instruments.values()),
+            "next_user_id": session.next_user_id,
+            "next_instrument_id": session.next_instrument_id,
+            "house_user_id": session.house_user_id
+        }
+    
+    def replicate(self, session: Session):
+        """Send changed room metadata in order with the engine commands, then flush"""
+        if not session.replication:
+            return
+        metadata = json.dumps(self.session_metadata(session), sort_keys=True)
+        if metadata != session.replicated_metadata:
+            session.engine.annotate(metadata)
+            session.replicated_metadata = metadata
+        session.replication.flush()
+    
+    async def adopt_session(self, engine, metadata: dict) -> Session:
+        """Serve a room whose primary was lost, from a standby engine and its metadata"""
+        room_code = metadata["room_code"]
+        session = Session(
+            room_code=room_code,
+            engine=engine,
+            passcode=metadata.get("passcode"),
+            next_user_id=metadata["next_user_id"],
+            next_instrument_id=metadata["next_instrument_id"],
+            house_user_id=metadata.get("house_user_id")
+        )
+        for inst in metadata["instruments"]:
+            session.instruments[inst["id"]] = inst
+        for u in metadata["users"]:
+            # Users reconnect and reclaim their seats with their resume tokens
+            session.users[u["user_id"]] = User(
+                user_id=u["user_id"], name=u["name"], role=u["role"],
+                resume_token=u["resume_token"])
+            self.user_to_session[u["user_id"]] = room_code
+        self.sessions[room_code] = session
+        logger.info(f"Took over session {room_code} at command {engine.command_count()}")
+        return session
     
     def get_session_count(self) -> int:
         """Get number of active sessions"""
@@ -179,6 +355,8 @@ class SessionManager:
         total_users = sum(len(s.users) for s in active_sessions)
         
         return {
+            "shard": self.shard_index,
+            "shard_count": self.shard_count,
             "active_sessions": len(active_sessions),
             "total_users": total_users,
             "sessions": [
@@ -186,12 +364,30 @@ class SessionManager:
                     "room_code": s.room_code,
                     "users": len(s.users),
                     "instruments": len(s.instruments),
-                    "age_seconds": time.time() - s.created_at
+                    "age_seconds": time.time() - s.created_at,
+                    "memory": self.engine_memory(s.engine, s.replication)
                 }
                 for s in active_sessions
             ]
         }
     
+    def engine_memory(self, engine, replication=None) -> dict:
+        """Engine memory by area in bytes, as {area: {used, reserved}} plus a total;
+        a room's replication log counts as one more area"""
+        memory = engine.get_stats().memory
+        areas = {
+            area: {"used": getattr(memory, area).used, "reserved": getattr(memory, area).reserved}
+            for area in MEMORY_AREAS
+        }
+        if replication:
+            usage = replication.memory_usage()
+            areas["replication"] = {"used": usage.used, "reserved": usage.reserved}
+        areas["total"] = {
+            "used": sum(a["used"] for a in areas.values()),
+            "reserved": sum(a["reserved"] for a in areas.values())
+        }
+        return areas
+    
     async def export_session_data(self, room_code: str):
         """Export session data to CSV files"""
         session = self.sessions.get(room_code)
@@ -203,43 +399,62 @@ class SessionManager:
         
         timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
         
-        # Export trades
+        # Trades and fills are unpacked from the engine's raw records rather
+        # than one wrapped object per row; times are ns since the Unix epoch
         trade_file = f"{export_dir}/trades_{timestamp}.csv"
         with open(trade_file, 'w', newline='') as f:
             writer = csv.writer(f)
-            writer.writerow(['timestamp', 'instrument_id', 'buyer_id', 'seller_id', 
-                           'price', 'quantity', 'buy_order_id', 'sell_order_id'])
+            writer.writerow(['timestamp_ns', 'instrument_id', 'buyer_id', 'seller_id', 
+                           'price', 'quantity', 'buy_order_id', 'sell_order_id',
+                           'seq', 'aggressor_side'])
             
-            for trade in session.engine.get_trade_history():
+            records = session.engine.get_trade_history_bytes()
+            for (seq, ts, buy_order_id, sell_order_id, price, quantity,
+                 buyer_id, seller_id, instrument_id, aggressor) in struct.iter_unpack(
+                    mmg_engine.TRADE_RECORD_FORMAT, records):
                 writer.writerow([
-                    trade.timestamp,
-                    trade.instrument_id,
-                    trade.buyer_id,
-                    trade.seller_id,
-                    trade.price,
-                    trade.quantity,
-                    trade.buy_order_id,
-                    trade.sell_order_id
+                    ts,
+                    instrument_id,
+                    buyer_id,
+                    seller_id,
+                    price,
+                    quantity,
+                    buy_order_id,
+                    sell_order_id,
+                    seq,
+                    'BUY' if aggressor == 0 else 'SELL'
                 ])
         
         # Export fills
         fill_file = f"{export_dir}/fills_{timestamp}.csv"
         with open(fill_file, 'w', newline='') as f:
             writer = csv.writer(f)
-            writer.writerow(['timestamp', 'order_id', 'user_id', 'instrument_id', 
-                           'side', 'price', 'quantity'])
+            writer.writerow(['timestamp_ns', 'order_id', 'user_id', 'instrument_id', 
+                           'side', 'price', 'quantity', 'seq', 'aggressor'])
             
-            for fill in session.engine.get_fill_history():
+            records = session.engine.get_fill_history_bytes()
+            for (seq, ts, order_id, price, quantity,
+                 user_id, instrument_id, side, aggressor) in struct.iter_unpack(
+                    mmg_engine.FILL_RECORD_FORMAT, records):
                 writer.writerow([
-                    fill.timestamp,
-                    fill.order_id,
-                    fill.user_id,
-                    fill.instrument_id,
-                    'BUY' if fill.side == mmg_engine.Side.BUY else 'SELL',
-                    fill.price,
-                    fill.quantity
+                    ts,
+                    order_id,
+                    user_id,
+                    instrument_id,
+                    'BUY' if side == 0 else 'SELL',
+                    price,
+                    quantity,
+                    seq,
+                    int(aggressor)
                 ])
         
+        # Columnar segments of the fills and book journal, several times smaller
+        # than the CSV; read back with mmg_engine.decode_*_segment
+        with open(f"{export_dir}/fills_{timestamp}.seg", 'wb') as f:
+            f.write(session.engine.export_fill_segment())
+        with open(f"{export_dir}/journal_{timestamp}.seg", 'wb') as f:
+            f.write(session.engine.export_journal_segment())
+        
         # Export final PnL
         pnl_file = f"{export_dir}/pnl_{timestamp}.csv"
         with open(pnl_file, 'w', newline='') as f:
@@ -269,6 +484,8 @@ class MockEngine:
         self.instruments = {}
         self.orders = {}
         self.next_order_id = 1
+        self.last_seq = 0
+        self._aggregate_fills = False
     
     def add_instrument(self, spec):
         self.instruments[spec.id] = spec
@@ -281,6 +498,19 @@ class MockEngine:
         result.success = True
         result.error_message = ""
         result.fills = []
+        self.last_seq += 1
+        result.seq = self.last_seq
+        return result
+    
+    def submit_package(self, user_id, instrument_ids, sides, prices, quantities, tif=None):
+        result = type('PackageResult', (), {})()
+        result.success = True
+        result.error_message = ""
+        result.order_ids = list(range(self.next_order_id, self.next_order_id + len(instrument_ids)))
+        self.next_order_id += len(instrument_ids)
+        result.seqs = list(range(self.last_seq + 1, self.last_seq + 1 + len(instrument_ids)))
+        self.last_seq += len(instrument_ids)
+        result.fills = []
         return result
     
     def cancel_order(self, order_id, user_id):
@@ -289,14 +519,89 @@ class MockEngine:
     def cancel_all(self, user_id):
         return True
     
-    def get_snapshot(self, inst_id):
+    def set_cancel_on_disconnect(self, user_id, enabled):
+        pass
+    
+    def set_aggregate_fills(self, enabled):
+        self._aggregate_fills = enabled
+    
+    def aggregate_fills(self):
+        return self._aggregate_fills
+    
+    def user_disconnected(self, user_id):
+        return []
+    
+    def get_snapshot(self, inst_id, depth=10):
         snap = type('Snapshot', (), {})()
         snap.instrument_id = inst_id
         snap.bids = []
         snap.asks = []
         snap.last_price = 0
+        snap.seq = self.last_seq
         return snap
     
+    def subscribe_market_data(self, client_id, inst_id, depth):
+        return inst_id in self.instruments and depth > 0
+    
+    def unsubscribe_market_data(self, client_id, inst_id):
+        return False
+    
+    def unsubscribe_all_market_data(self, client_id):
+        pass
+    
+    def get_market_data_subscribers(self, inst_id):
+        return []
+    
+    def get_market_data_subscriptions(self, client_id):
+        return []
+    
+    def take_market_data_updates(self, client_id):
+        return []
+    
+    def subscribe_l3(self, client_id, inst_id):
+        return inst_id in self.instruments
+    
+    def unsubscribe_l3(self, client_id, inst_id):
+        return False
+    
+    def unsubscribe_all_l3(self, client_id):
+        pass
+    
+    def get_l3_subscribers(self, inst_id):
+        return set()
+    
+    def get_l3_subscriptions(self, client_id):
+        return []
+    
+    def drain_l3_events(self):
+        return []
+    
+    def mass_quote(self, user_id, quotes):
+        result = type('MassQuoteResult', (), {})()
+        result.success = True
+        result.error_message = ""
+        result.order_ids = []
+        result.fills = []
+        return result
+    
+    def enable_market_maker(self, config):
+        return config.instrument_id in self.instruments
+    
+    def disable_market_maker(self, inst_id):
+        return False
+    
+    def step_market_makers(self):
+        return []
+    
+    def get_market_maker(self, inst_id):
+        return None
+    
+    def get_implied_quote(self, inst_id):
+        quote = type('ImpliedQuote', (), {})()
+        quote.bid = quote.ask = 0
+        quote.bid_size = quote.ask_size = 0
+        return quote
+    
     def get_positions(self, user_id):
         return []
     
@@ -306,9 +611,34 @@ class MockEngine:
     def settle_instrument(self, inst_id, value):
         return True
     
-    def halt_instrument(self, inst_id, halted):
+    def halt_instrument(self, inst_id, halted, cancel_orders=False):
+        return True
+    
+    def set_tick_size(self, inst_id, tick_size, policy):
         return True
     
+    def drain_events(self):
+        return True, []
+    
+    def replay_from(self, from_seq):
+        return True, []
+    
+    def reconstruct_at(self, timestamp):
+        return []
+    
+    def reconstruct_at_seq(self, seq):
+        return []
+    
+    def apply_admin_batch(self, actions):
+        result = type('AdminResult', (), {})()
+        result.success = True
+        result.error_message = ""
+        result.failed_index = 0
+        result.changes = []
+        result.cancelled_orders = []
+        result.settlement_pnl = {}
+        return result
+    
     def set_risk_limits(self, user_id, limits):
         pass
     
@@ -318,6 +648,11 @@ class MockEngine:
         stats.total_fills = 0
         stats.total_cancels = 0
         stats.total_rejects = 0
+        stats.memory = type('MemoryStats', (), {})()
+        for area in MEMORY_AREAS:
+            usage = type('MemoryUsage', (), {})()
+            usage.used = usage.reserved = 0
+            setattr(stats.memory, area, usage)
         return stats
     
     def get_trade_history(self):
@@ -325,4 +660,28 @@ class MockEngine:
     
     def get_fill_history(self):
         return []
+    
+    def get_trade_history_bytes(self):
+        return b""
+    
+    def get_fill_history_bytes(self):
+        return b""
+    
+    def export_fill_segment(self, compress=True):
+        return b""
+    
+    def export_journal_segment(self, compress=True):
+        return b""
+    
+    def get_user_fills(self, user_id, since=0, limit=None):
+        return []
+    
+    def annotate(self, data):
+        pass
+    
+    def command_count(self):
+        return 0
+    
+    def get_user_orders(self, user_id):
+        return []
 
@@ -0,0 +1,96 @@
+"""
+Hot standby
+Follows the rooms a primary gateway publishes under MMG_REPLICATION_DIR and
+takes them over, with the same engine state and order ids, when it is lost
+"""
+
+import asyncio
+import json
+import logging
+import os
+from typing import Dict, Optional, Set
+
+from .session_manager import SessionManager
+
+try:
+    import mmg_engine
+    ENGINE_AVAILABLE = True
+except ImportError:
+    ENGINE_AVAILABLE = False
+
+logger = logging.getLogger(__name__)
+
+
+class Follower:
+    """One room being replicated into a local engine"""
+    
+    def __init__(self, room_code: str, path: str):
+        self.room_code = room_code
+        self.engine = mmg_engine.Engine()
+        self.client = mmg_engine.ReplicationClient(self.engine, path)
+        self.metadata: Optional[dict] = None
+    
+    def poll(self) -> bool:
+        """Apply whatever arrived; False once the stream has ended"""
+        following = self.client.poll(0)
+        for annotation in self.client.take_annotations():
+            self.metadata = json.loads(annotation)
+        # Nobody reads this engine's events until it takes over
+        self.engine.drain_events()
+        return following
+
+
+class Standby:
+    def __init__(self, session_manager: SessionManager, directory: str):
+        self.session_manager = session_manager
+        self.directory = directory
+        self.followers: Dict[str, Follower] = {}
+        self.lost: Set[str] = set()  # Diverged; the primary's trimmed log cannot rebuild them
+    
+    def discover(self):
+        """Connect to rooms published since the last scan"""
+        try:
+            names = os.listdir(self.directory)
+        except FileNotFoundError:
+            return
+        
+        for name in names:
+            room_code, ext = os.path.splitext(name)
+            if ext != ".sock" or room_code in self.followers:
+                continue
+            if room_code in self.session_manager.sessions or room_code in self.lost:
+                continue
+            follower = Follower(room_code, os.path.join(self.directory, name))
+            if follower.client.connect():
+                self.followers[room_code] = follower
+                logger.info(f"Following session {room_code}")
+    
+    async def step(self):
+        self.discover()
+        for room_code, follower in list(self.followers.items()):
+            if follower.poll():
+                continue
+            
+            del self.followers[room_code]
+            if follower.client.diverged():
+                logger.error(f"Standby for session {room_code} diverged; dropped")
+                self.lost.add(room_code)
+            elif follower.metadata is None:
+                logger.warning(f"Primary for session {room_code} lost before any metadata")
+            else:
+                await self.session_manager.adopt_session(follower.engine, follower.metadata)
+    
+    async def run(self):
+        """Follow until cancelled"""
+        if not ENGINE_AVAILABLE:
+            logger.warning("mmg_engine not available, standby disabled")
+            return
+        
+        while True:
+            try:
+                await self.step()
+                await asyncio.sleep(0.05)
+            except asyncio.CancelledError:
+                break
+            except Exception as e:
+                logger.error(f"Error in standby: {e}", exc_info=True)
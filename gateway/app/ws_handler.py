@@ -4,9 +4,12 @@ Handles incoming WebSocket messages and broadcasts updates
 """
 
 import asyncio
+import contextlib
+import contextvars
 import logging
 import time
 import json
+from datetime import datetime
 from typing import Optional, Dict, Any
 from fastapi import WebSocket
 
@@ -20,6 +23,9 @@ except ImportError:
 
 logger = logging.getLogger(__name__)
 
+# Messages held back while the current task has its room's lock
+_outbox: contextvars.ContextVar = contextvars.ContextVar("outbox", default=None)
+
 class WebSocketHandler:
     def __init__(self, websocket: WebSocket, session_manager: SessionManager):
         self.websocket = websocket
@@ -48,48 +54,77 @@ class WebSocketHandler:
             await self.handle_join(data)
         elif op == "ping":
             await self.handle_ping(data)
-        elif self.user:  # Require authentication for other operations
-            if op == "add_instrument":
-                await self.handle_add_instrument(data)
-            elif op == "order_new":
-                await self.handle_order_new(data)
-            elif op == "cancel":
-                await self.handle_cancel(data)
-            elif op == "cancel_all":
-                await self.handle_cancel_all(data)
-            elif op == "cancel_inst":
-                await self.handle_cancel_inst(data)
-            elif op == "replace":
-                await self.handle_replace(data)
-            elif op == "settle":
-                await self.handle_settle(data)
-            elif op == "halt":
-                await self.handle_halt(data)
-            elif op == "update_tick_size":
-                await self.handle_update_tick_size(data)
-            elif op == "expire_option":
-                await self.handle_expire_option(data)
-            elif op == "pull_quotes":
-                await self.handle_pull_quotes(data)
-            elif op == "get_snapshot":
-                await self.handle_get_snapshot(data)
-            elif op == "get_positions":
-                await self.handle_get_positions(data)
-            elif op == "get_pnl":
-                await self.handle_get_pnl(data)
-            elif op == "export_data":
-                await self.handle_export_data(data)
-            else:
-                await self.send_error(f"Unknown operation: {op}")
-        else:
+        elif not self.user:  # Require authentication for other operations
             await self.send_error("Not authenticated")
+        # Reads run between commands (engine calls never yield) and take no lock
+        elif op == "replay":
+            await self.handle_replay(data)
+        elif op == "reconstruct":
+            await self.handle_reconstruct(data)
+        elif op == "get_snapshot":
+            await self.handle_get_snapshot(data)
+        elif op == "get_positions":
+            await self.handle_get_positions(data)
+        elif op == "get_orders":
+            await self.handle_get_orders(data)
+        elif op == "get_fills":
+            await self.handle_get_fills(data)
+        elif op == "get_pnl":
+            await self.handle_get_pnl(data)
+        elif op == "get_risk":
+            await self.handle_get_risk(data)
+        elif op == "export_data":
+            await self.handle_export_data(data)
+        else:
+            # One command at a time per room; what it sends goes out once the lock is released
+            async with self.holding(self.session_manager.command_lock(self.room_code)):
+                if op == "add_instrument":
+                    await self.handle_add_instrument(data)
+                elif op == "order_new":
+                    await self.handle_order_new(data)
+                elif op == "cancel":
+                    await self.handle_cancel(data)
+                elif op == "cancel_all":
+                    await self.handle_cancel_all(data)
+                elif op == "package_new":
+                    await self.handle_package_new(data)
+                elif op == "cancel_inst":
+                    await self.handle_cancel_inst(data)
+                elif op == "replace":
+                    await self.handle_replace(data)
+                elif op == "settle":
+                    await self.handle_settle(data)
+                elif op == "halt":
+                    await self.handle_halt(data)
+                elif op == "update_tick_size":
+                    await self.handle_update_tick_size(data)
+                elif op == "market_maker":
+                    await self.handle_market_maker(data)
+                elif op == "admin_batch":
+                    await self.handle_admin_batch(data)
+                elif op == "expire_option":
+                    await self.handle_expire_option(data)
+                elif op == "pull_quotes":
+                    await self.handle_pull_quotes(data)
+                elif op == "subscribe":
+                    await self.handle_subscribe(data)
+                elif op == "unsubscribe":
+                    await self.handle_unsubscribe(data)
+                elif op == "md_mode":
+                    await self.handle_md_mode(data)
+                elif op == "l3_subscribe":
+                    await self.handle_l3_subscribe(data)
+                elif op == "l3_unsubscribe":
+                    await self.handle_l3_unsubscribe(data)
+                else:
+                    await self.send_error(f"Unknown operation: {op}")
     
     async def handle_create_room(self, data: dict):
         """Create a new room"""
         passcode = data.get("passcode")
         room_code = await self.session_manager.create_session(passcode)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "room_created",
             "room_code": room_code
         })
@@ -100,12 +135,20 @@ class WebSocketHandler:
         name = data.get("name")
         role = data.get("role", "trader")
         passcode = data.get("passcode")
+        resume_token = data.get("resume_token")
         
         if not room_code or not name:
             await self.send_error("Missing room or name")
             return
         
-        user = await self.session_manager.join_session(room_code, name, role, passcode)
+        if not self.session_manager.owns_room(room_code):
+            await self.send_error(f"Room {room_code} is hosted by "
+                                  f"{self.session_manager.room_host(room_code)}; "
+                                  f"connect with ?room={room_code}")
+            return
+        
+        user = await self.session_manager.join_session(room_code, name, role, passcode,
+                                                       resume_token)
         
         if not user:
             await self.send_error("Failed to join session")
@@ -118,18 +161,31 @@ class WebSocketHandler:
         # Get session info
         session = self.session_manager.get_session(room_code)
         
-        await self.websocket.send_json({
+        # Traders' quotes are pulled when they drop unless they opt out
+        if session and ENGINE_AVAILABLE:
+            async with session.lock:
+                session.engine.set_cancel_on_disconnect(
+                    user.user_id, bool(data.get("cancel_on_disconnect", role == "trader")))
+                
+                # Follow every book unless the client names the ones it wants
+                user.md_depth = int(data.get("depth", user.md_depth))
+                if "subscribe" in data:
+                    user.md_all = False
+                for inst_id in data.get("subscribe", list(session.instruments.keys())):
+                    session.engine.subscribe_market_data(user.user_id, inst_id, user.md_depth)
+        
+        await self.reply({
             "type": "join_ack",
             "user_id": user.user_id,
             "role": user.role,
             "resume_token": user.resume_token,
             "room_code": room_code,
-            "instruments": list(session.instruments.values()) if session else []
+            "instruments": list(session.instruments.values()) if session else [],
+            "seq": session.engine.last_seq if session else 0
         })
         
         # Notify other users
-        await self.session_manager.broadcast_to_session(
-            room_code,
+        await self.broadcast(
             {
                 "type": "user_joined",
                 "user_id": user.user_id,
@@ -145,7 +201,7 @@ class WebSocketHandler:
     
     async def handle_ping(self, data: dict):
         """Handle ping for latency measurement"""
-        await self.websocket.send_json({
+        await self.reply({
             "type": "pong",
             "timestamp": data.get("timestamp"),
             "server_time": time.time()
@@ -168,14 +224,26 @@ class WebSocketHandler:
             spec.symbol = data.get("symbol", "")
             spec.type = self.parse_instrument_type(data.get("type", "SCALAR"))
             spec.reference_id = data.get("reference_id") or 0  # Handle None
-            spec.strike = int((data.get("strike") or 0) * 100)  # Convert to cents
-            spec.tick_size = int((data.get("tick_size") or 0.01) * 100)
+            spec.price_decimals = int(data.get("decimals", 2))
+            scale = 10 ** spec.price_decimals
+            spec.strike = round((data.get("strike") or 0) * scale)  # Convert to fixed-point
+            spec.tick_size = max(1, round((data.get("tick_size") or 0.01) * scale))
             spec.lot_size = data.get("lot_size") or 1
             spec.tick_value = data.get("tick_value") or 1.0
             spec.is_halted = False
+            # Combo legs as [[instrument_id, ratio], ...]
+            spec.legs = [mmg_engine.ComboLeg(int(leg[0]), int(leg[1]))
+                         for leg in (data.get("legs") or [])]
             
             success = session.engine.add_instrument(spec)
             
+            mark_method = data.get("mark_method")
+            if success and mark_method:
+                config = mmg_engine.MarkConfig()
+                config.method = getattr(mmg_engine.MarkMethod, mark_method.upper(),
+                                        mmg_engine.MarkMethod.LAST_OR_MID)
+                session.engine.set_mark_config(spec.id, config)
+            
             if success:
                 # Store instrument info
                 inst_info = {
@@ -186,14 +254,20 @@ class WebSocketHandler:
                     "strike": data.get("strike", 0),
                     "tick_size": data.get("tick_size", 1),
                     "lot_size": spec.lot_size,
-                    "tick_value": spec.tick_value
+                    "tick_value": spec.tick_value,
+                    "decimals": spec.price_decimals
                 }
+                if spec.legs:
+                    inst_info["legs"] = [[leg.instrument_id, leg.ratio] for leg in spec.legs]
                 session.instruments[spec.id] = inst_info
                 session.next_instrument_id += 1
+                self.session_manager.replicate(session)
+                for user_id, user in session.users.items():
+                    if user.md_all:
+                        session.engine.subscribe_market_data(user_id, spec.id, user.md_depth)
                 
                 # Broadcast to all users
-                await self.session_manager.broadcast_to_session(
-                    self.room_code,
+                await self.broadcast(
                     {
                         "type": "instrument_added",
                         "instrument": inst_info
@@ -211,24 +285,15 @@ class WebSocketHandler:
             await self.send_error("Session or engine not available")
             return
         
-        # Rate limiting
-        now = time.time()
-        if now - self.user.last_order_time < 0.02:  # 50 orders/sec max
-            if self.user.order_count > 50:
-                await self.send_error("Rate limit exceeded")
-                return
-        else:
-            self.user.order_count = 0
-            self.user.last_order_time = now
-        
-        self.user.order_count += 1
+        if not await self.check_rate_limit(1):
+            return
         
         # Parse order
         req = mmg_engine.OrderRequest()
         req.user_id = self.user.user_id
         req.instrument_id = data.get("inst", 0)
         req.side = mmg_engine.Side.BUY if data.get("side") == "buy" else mmg_engine.Side.SELL
-        req.price = int(data.get("price", 0) * 100)  # Convert to cents
+        req.price = round(data.get("price", 0) * self.price_scale(session, req.instrument_id))
         req.quantity = data.get("qty", 0)
         req.tif = mmg_engine.TimeInForce.IOC if data.get("tif") == "IOC" else mmg_engine.TimeInForce.GFD
         req.post_only = data.get("post_only", False)
@@ -238,80 +303,472 @@ class WebSocketHandler:
         
         if result.success:
             # Send ack to user
-            await self.websocket.send_json({
+            await self.reply({
                 "type": "order_ack",
                 "order_id": result.order_id,
                 "inst": req.instrument_id,
                 "side": data.get("side"),
-                "price": data.get("price", 0)
+                "price": data.get("price", 0),
+                "seq": result.seq  # Its ORDER_ACCEPTED event; its fills follow
             })
             
-            # Broadcast fills and update positions/PnL
-            affected_users = set()
-            for fill in result.fills:
-                fill_msg = {
-                    "type": "fill",
-                    "order_id": fill.order_id,
-                    "user_id": fill.user_id,
-                    "inst": fill.instrument_id,
-                    "side": "buy" if fill.side == mmg_engine.Side.BUY else "sell",
-                    "price": fill.price / 100.0,
-                    "qty": fill.quantity
-                }
-                
-                # Send to specific user
-                user = session.users.get(fill.user_id)
-                if user and user.websocket:
-                    await user.websocket.send_json(fill_msg)
-                    affected_users.add(fill.user_id)
-            
-            # Send updated positions and PnL to affected users
-            for user_id in affected_users:
-                user = session.users.get(user_id)
-                if user and user.websocket:
-                    # Get positions
-                    positions = session.engine.get_positions(user_id)
-                    position_list = []
-                    for pos in positions:
-                        inst = session.instruments.get(pos.instrument_id, {})
-                        position_list.append({
-                            "inst": pos.instrument_id,
-                            "symbol": inst.get("symbol", ""),
-                            "qty": pos.net_qty,
-                            "vwap": pos.vwap / 100.0,
-                            "realized_pnl": pos.realized_pnl,
-                            "unrealized_pnl": pos.unrealized_pnl
-                        })
-                    
-                    # Get total PnL
-                    total_pnl = session.engine.get_total_pnl(user_id)
-                    
-                    # Send updates
-                    await user.websocket.send_json({
-                        "type": "positions",
-                        "positions": position_list
-                    })
-                    await user.websocket.send_json({
-                        "type": "pnl",
-                        "pnl": total_pnl
-                    })
-            
-            # CRITICAL: Broadcast updated market data to ALL users
-            snapshot = session.engine.get_snapshot(req.instrument_id)
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "md_inc",
-                    "inst": req.instrument_id,
-                    "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-                    "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-                    "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                    "ts": time.time()
-                }
-            )
+            await self.publish_fills(session, result.fills, {req.instrument_id})
         else:
             await self.send_error(result.error_message)
     
+    async def handle_package_new(self, data: dict):
+        """Submit orders on several instruments as one atomic package"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            await self.send_error("Session or engine not available")
+            return
+        
+        legs = data.get("legs") or []
+        if not await self.check_rate_limit(len(legs)):
+            return
+        
+        inst_ids = [leg.get("inst", 0) for leg in legs]
+        result = session.engine.submit_package(
+            self.user.user_id,
+            inst_ids,
+            [mmg_engine.Side.BUY if leg.get("side") == "buy" else mmg_engine.Side.SELL for leg in legs],
+            [round(leg.get("price", 0) * self.price_scale(session, leg.get("inst", 0))) for leg in legs],
+            [leg.get("qty", 0) for leg in legs],
+            mmg_engine.TimeInForce.IOC if data.get("tif") == "IOC" else mmg_engine.TimeInForce.GFD
+        )
+        
+        if result.success:
+            await self.reply({
+                "type": "package_ack",
+                "order_ids": list(result.order_ids),
+                "legs": legs,
+                "seqs": list(result.seqs),  # Each leg's ORDER_ACCEPTED event
+                "seq": max(result.seqs, default=session.engine.last_seq)
+            })
+            await self.publish_fills(session, result.fills, set(inst_ids))
+        else:
+            await self.send_error(result.error_message)
+    
+    async def check_rate_limit(self, num_orders: int) -> bool:
+        """Count orders against the per-user rate limit; sends an error when exceeded"""
+        now = time.time()
+        if now - self.user.last_order_time < 0.02:  # 50 orders/sec max
+            if self.user.order_count > 50:
+                await self.send_error("Rate limit exceeded")
+                return False
+        else:
+            self.user.order_count = 0
+            self.user.last_order_time = now
+        
+        self.user.order_count += num_orders
+        return True
+    
+    async def publish_fills(self, session, fills, inst_ids: set):
+        """Send fills and position/PnL updates to affected users and broadcast market data"""
+        # Broadcast fills and update positions/PnL
+        affected_users = set()
+        for fill in fills:
+            fill_msg = {
+                "type": "fill",
+                "order_id": fill.order_id,
+                "user_id": fill.user_id,
+                "inst": fill.instrument_id,
+                "side": "buy" if fill.side == mmg_engine.Side.BUY else "sell",
+                "price": fill.price / self.price_scale(session, fill.instrument_id),
+                "qty": fill.quantity,
+                "aggressor": fill.aggressor,  # Per price level when the room aggregates fills
+                "seq": fill.seq  # Its own FILL event, as replay would show it
+            }
+            
+            # Send to specific user
+            user = session.users.get(fill.user_id)
+            if user and user.websocket:
+                await self.send([(user.websocket, fill_msg)])
+                affected_users.add(fill.user_id)
+        
+        # Send updated positions and PnL to affected users
+        for user_id in affected_users:
+            await self.send_positions_and_pnl(session, user_id)
+        
+        # CRITICAL: Broadcast updated market data to ALL users
+        for inst_id in sorted(inst_ids | {fill.instrument_id for fill in fills}):
+            await self.broadcast_market_data(session, inst_id)
+    
+    async def broadcast_engine_events(self, session) -> set:
+        """Broadcast drained engine events: level deltas go to delta clients as one
+        md_delta message, bulk-path events to everyone. Returns the instruments
+        whose book a bulk path changed."""
+        books_changed = set()
+        deltas = []
+        complete, events = session.engine.drain_events()
+        for event in events:
+            inst_id = event.instrument_id
+            if event.type == mmg_engine.EngineEventType.LEVEL_UPDATE:
+                if not complete:
+                    continue  # The snapshots below supersede them
+                deltas.append([
+                    event.seq,
+                    inst_id,
+                    "bid" if event.side == mmg_engine.Side.BUY else "ask",
+                    event.price / self.price_scale(session, inst_id),
+                    event.quantity
+                ])
+                continue
+            if event.type == mmg_engine.EngineEventType.BOOK_RESET:
+                await self.broadcast(
+                    {
+                        "type": "book_reset",
+                        "inst": inst_id,
+                        "tick_size": event.value / self.price_scale(session, inst_id),
+                        "repriced": list(event.order_ids),
+                        "seq": event.seq
+                    }
+                )
+            elif event.type == mmg_engine.EngineEventType.ORDERS_CANCELLED:
+                await self.broadcast(
+                    {
+                        "type": "quotes_pulled",
+                        "inst": inst_id,
+                        "order_ids": list(event.order_ids),
+                        "seq": event.seq
+                    }
+                )
+            else:
+                continue  # Order flow is already published by the handler that caused it
+            books_changed.add(inst_id)
+        
+        # The ring overwrote events before this drain, so deltas would leave
+        # gaps: every client gets fresh snapshots of the books it follows
+        if not complete:
+            logger.warning(f"Engine events lost before drain in session {self.room_code}; "
+                           f"resending snapshots")
+            for user_id, user in session.users.items():
+                for inst_id in session.engine.get_market_data_subscriptions(user_id):
+                    await self.send_to([user_id],
+                                       self.snapshot_message(session, inst_id, user.md_depth))
+        
+        # Each delta client gets only the books it subscribes to
+        if deltas:
+            for user_id, user in session.users.items():
+                if not user.md_deltas:
+                    continue
+                watched = set(session.engine.get_market_data_subscriptions(user_id))
+                updates = [update for update in deltas if update[1] in watched]
+                if updates:
+                    await self.send_to(
+                        [user_id],
+                        {"type": "md_delta", "updates": updates, "seq": updates[-1][0]})
+        
+        l3_events = session.engine.drain_l3_events()
+        if l3_events:
+            await self.publish_l3(session, l3_events)
+        return books_changed
+    
+    async def publish_l3(self, session, events):
+        """Send each L3 subscriber the order-level events of the books it follows,
+        as one l3 message of rows or, for binary clients, one encoded batch"""
+        subscribers = {}
+        batches = {}
+        for event in events:
+            inst_id = event.instrument_id
+            if inst_id not in subscribers:
+                subscribers[inst_id] = session.engine.get_l3_subscribers(inst_id)
+            for user_id in subscribers[inst_id]:
+                batches.setdefault(user_id, []).append(event)
+        
+        pairs = []
+        for user_id, batch in batches.items():
+            user = session.users.get(user_id)
+            if not user or not user.websocket:
+                continue
+            if user.l3_binary:
+                pairs.append((user.websocket, mmg_engine.encode_l3_events(batch)))
+            else:
+                pairs.append((user.websocket,
+                              {"type": "l3", "events": [self.l3_row(session, e) for e in batch]}))
+        
+        await self.send(pairs)
+    
+    def l3_row(self, session, event) -> list:
+        """[seq, inst, type, order_id, side, price, qty, position]; seq counts per instrument"""
+        return [
+            event.seq,
+            event.instrument_id,
+            event.type.name.lower(),
+            event.order_id,
+            "bid" if event.side == mmg_engine.Side.BUY else "ask",
+            event.price / self.price_scale(session, event.instrument_id),
+            event.quantity,
+            event.position
+        ]
+    
+    def l3_snapshot_message(self, session, inst_id: int) -> dict:
+        """Every resting order as [[price, [[order_id, qty], ...]], ...] per side,
+        best level first and time priority within a level"""
+        snapshot = session.engine.get_l3_snapshot(inst_id)
+        scale = self.price_scale(session, inst_id)
+        
+        def levels(side):
+            return [[lvl.price / scale, [[o.order_id, o.quantity] for o in lvl.orders]]
+                    for lvl in side]
+        
+        return {
+            "inst": inst_id,
+            "seq": snapshot.seq,
+            "bids": levels(snapshot.bids),
+            "asks": levels(snapshot.asks)
+        }
+    
+    async def handle_l3_subscribe(self, data: dict):
+        """Follow books order by order.
+        
+        The ack carries one snapshot per book stamped with that book's L3 seq;
+        later l3 events with a higher seq apply on top. Events: add (rests
+        qty at position), modify (moves to price at position), execute
+        (trades qty; the order goes once nothing remains) and delete. With
+        format "binary" events arrive as mmg_engine.encode_l3_events batches
+        with raw fixed-point prices instead.
+        """
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        # Publish what is pending first so snapshots and events line up
+        await self.broadcast_engine_events(session)
+        self.user.l3_binary = data.get("format") == "binary"
+        snapshots = []
+        for inst_id in data.get("insts", []):
+            if session.engine.subscribe_l3(self.user.user_id, inst_id):
+                snapshots.append(self.l3_snapshot_message(session, inst_id))
+        
+        await self.reply({
+            "type": "l3_subscribe_ack",
+            "subscriptions": list(session.engine.get_l3_subscriptions(self.user.user_id)),
+            "snapshots": snapshots
+        })
+    
+    async def handle_l3_unsubscribe(self, data: dict):
+        """Stop following books order by order"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        for inst_id in data.get("insts", []):
+            session.engine.unsubscribe_l3(self.user.user_id, inst_id)
+        
+        await self.reply({
+            "type": "l3_unsubscribe_ack",
+            "subscriptions": list(session.engine.get_l3_subscriptions(self.user.user_id))
+        })
+    
+    async def handle_md_mode(self, data: dict):
+        """Switch this client between periodic full books and snapshot-plus-delta.
+        
+        In delta mode the client gets one snapshot per instrument stamped with
+        seq S and afterwards only md_delta updates ([seq, inst, side, price,
+        qty], qty 0 removes the level). It should buffer deltas until the
+        snapshots arrive, drop those with seq <= S, and re-request a snapshot
+        after a book_reset.
+        """
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        self.user.md_deltas = data.get("mode") == "delta"
+        if not self.user.md_deltas:
+            await self.reply({"type": "md_mode_ack", "mode": "snapshot"})
+            return
+        
+        # Publish what is pending first, then cut every book at one seq
+        await self.broadcast_engine_events(session)
+        depth = int(data.get("depth", self.user.md_depth))
+        snapshots = [self.snapshot_message(session, inst_id, depth)
+                     for inst_id in session.engine.get_market_data_subscriptions(self.user.user_id)]
+        await self.reply({
+            "type": "md_mode_ack",
+            "mode": "delta",
+            "seq": session.engine.last_seq,
+            "snapshots": snapshots
+        })
+    
+    async def handle_replay(self, data: dict):
+        """Resend sequenced engine events from a client's last seen seq.
+        
+        When the requested seq has left the retransmit cache the reply has
+        complete=False and the client must reload snapshots and positions.
+        """
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        from_seq = max(int(data.get("from_seq", 0)), 0)
+        complete, events = session.engine.replay_from(from_seq)
+        
+        await self.reply({
+            "type": "replay",
+            "from_seq": from_seq,
+            "last_seq": session.engine.last_seq,
+            "complete": complete,
+            "events": [self.event_message(session, event) for event in events
+                       if self.can_see_event(event)]
+        })
+    
+    async def handle_reconstruct(self, data: dict):
+        """Books as they stood at a past `seq`, or at a past wall-clock `time`
+        (epoch seconds), for disputes and post-game review"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        depth = max(int(data.get("depth", 10)), 1)
+        if "seq" in data:
+            books = session.engine.reconstruct_at_seq(max(int(data["seq"]), 0))
+        elif "time" in data:
+            books = session.engine.reconstruct_at(datetime.fromtimestamp(float(data["time"])))
+        else:
+            await self.send_error("reconstruct needs seq or time")
+            return
+        
+        snapshots = []
+        for book in books:
+            scale = self.price_scale(session, book.instrument_id)
+            snapshots.append({
+                "inst": book.instrument_id,
+                "bids": [[lvl.price / scale, lvl.size] for lvl in book.bids[:depth]],
+                "asks": [[lvl.price / scale, lvl.size] for lvl in book.asks[:depth]],
+                "seq": book.seq
+            })
+        
+        await self.reply({
+            "type": "book_history",
+            "seq": data.get("seq"),
+            "time": data.get("time"),
+            "books": snapshots
+        })
+    
+    def can_see_event(self, event) -> bool:
+        """Other users' order flow stays private; instrument-wide events are public"""
+        private = (mmg_engine.EngineEventType.ORDER_ACCEPTED,
+                   mmg_engine.EngineEventType.ORDER_CANCELLED,
+                   mmg_engine.EngineEventType.FILL)
+        return (event.type not in private or event.user_id == self.user.user_id
+                or self.user.role == "exchange")
+    
+    def event_message(self, session, event) -> dict:
+        """JSON form of one engine event"""
+        inst_id = event.instrument_id
+        scale = self.price_scale(session, inst_id)
+        message = {
+            "seq": event.seq,
+            "event": event.type.name.lower(),
+            "inst": inst_id
+        }
+        if event.type in (mmg_engine.EngineEventType.ORDER_ACCEPTED,
+                          mmg_engine.EngineEventType.ORDER_CANCELLED,
+                          mmg_engine.EngineEventType.FILL):
+            message.update({
+                "user_id": event.user_id,
+                "order_id": event.order_id,
+                "side": "buy" if event.side == mmg_engine.Side.BUY else "sell",
+                "price": event.price / scale,
+                "qty": event.quantity
+            })
+        elif event.type == mmg_engine.EngineEventType.BOOK_RESET:
+            message.update({"tick_size": event.value / scale, "repriced": list(event.order_ids)})
+        elif event.type == mmg_engine.EngineEventType.ORDERS_CANCELLED:
+            message["order_ids"] = list(event.order_ids)
+        elif event.type == mmg_engine.EngineEventType.INSTRUMENT_HALTED:
+            message["halted"] = bool(event.value)
+        elif event.type == mmg_engine.EngineEventType.INSTRUMENT_SETTLED:
+            message["value"] = event.value / scale
+        return message
+    
+    async def send_positions_and_pnl(self, session, user_id: int):
+        """Send a user their current positions and total PnL"""
+        user = session.users.get(user_id)
+        if not user or not user.websocket:
+            return
+        
+        positions = session.engine.get_positions(user_id)
+        position_list = []
+        for pos in positions:
+            inst = session.instruments.get(pos.instrument_id, {})
+            position_list.append({
+                "inst": pos.instrument_id,
+                "symbol": inst.get("symbol", ""),
+                "qty": pos.net_qty,
+                "vwap": pos.vwap / self.price_scale(session, pos.instrument_id),
+                "realized_pnl": pos.realized_pnl,
+                "unrealized_pnl": pos.unrealized_pnl
+            })
+        
+        await self.send([
+            (user.websocket, {"type": "positions", "positions": position_list}),
+            (user.websocket, {"type": "pnl", "pnl": session.engine.get_total_pnl(user_id)})
+        ])
+    
+    async def broadcast_market_data(self, session, inst_id: int):
+        """Publish pending level deltas, then send an instrument's current book to
+        its snapshot-mode subscribers, encoded once per requested depth"""
+        await self.broadcast_engine_events(session)
+        
+        by_depth = {}
+        for sub in session.engine.get_market_data_subscribers(inst_id):
+            user = session.users.get(sub.client_id)
+            if user and not user.md_deltas:
+                by_depth.setdefault(sub.depth, []).append(sub.client_id)
+        
+        for depth, user_ids in sorted(by_depth.items()):
+            await self.send_to(
+                user_ids, self.md_inc_message(session, inst_id, depth))
+    
+    def md_inc_message(self, session, inst_id: int, depth: int) -> dict:
+        """Full book update at a depth"""
+        snapshot = session.engine.get_snapshot(inst_id, depth)
+        scale = self.price_scale(session, inst_id)
+        return {
+            "type": "md_inc",
+            "inst": inst_id,
+            "bids": [[lvl.price / scale, lvl.size] for lvl in snapshot.bids],
+            "asks": [[lvl.price / scale, lvl.size] for lvl in snapshot.asks],
+            "last": snapshot.last_price / scale if snapshot.last_price else None,
+            "ts": time.time()
+        }
+    
+    async def handle_subscribe(self, data: dict):
+        """Subscribe to books at a depth and get their current snapshots"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        depth = int(data.get("depth", self.user.md_depth))
+        self.user.md_all = False
+        snapshots = []
+        for inst_id in data.get("insts", []):
+            if session.engine.subscribe_market_data(self.user.user_id, inst_id, depth):
+                snapshots.append(self.snapshot_message(session, inst_id, depth))
+        
+        await self.reply({
+            "type": "subscribe_ack",
+            "subscriptions": list(session.engine.get_market_data_subscriptions(self.user.user_id)),
+            "snapshots": snapshots
+        })
+    
+    async def handle_unsubscribe(self, data: dict):
+        """Stop receiving books"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        self.user.md_all = False
+        for inst_id in data.get("insts", []):
+            session.engine.unsubscribe_market_data(self.user.user_id, inst_id)
+        
+        await self.reply({
+            "type": "unsubscribe_ack",
+            "subscriptions": list(session.engine.get_market_data_subscriptions(self.user.user_id))
+        })
+    
     async def handle_cancel(self, data: dict):
         """Handle order cancellation"""
         session = self.session_manager.get_session(self.room_code)
@@ -322,7 +779,7 @@ class WebSocketHandler:
         inst_id = data.get("inst", 0)
         success = session.engine.cancel_order(order_id, self.user.user_id)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "cancel_ack",
             "order_id": order_id,
             "success": success
@@ -330,18 +787,7 @@ class WebSocketHandler:
         
         # Broadcast updated market data if cancel succeeded
         if success and inst_id:
-            snapshot = session.engine.get_snapshot(inst_id)
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "md_inc",
-                    "inst": inst_id,
-                    "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-                    "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-                    "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                    "ts": time.time()
-                }
-            )
+            await self.broadcast_market_data(session, inst_id)
     
     async def handle_cancel_all(self, data: dict):
         """Handle cancel all orders"""
@@ -351,7 +797,7 @@ class WebSocketHandler:
         
         success = session.engine.cancel_all(self.user.user_id)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "cancel_all_ack",
             "success": success
         })
@@ -359,18 +805,7 @@ class WebSocketHandler:
         # Broadcast updated market data for all instruments
         if success:
             for inst_id in session.instruments.keys():
-                snapshot = session.engine.get_snapshot(inst_id)
-                await self.session_manager.broadcast_to_session(
-                    self.room_code,
-                    {
-                        "type": "md_inc",
-                        "inst": inst_id,
-                        "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-                        "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-                        "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                        "ts": time.time()
-                    }
-                )
+                await self.broadcast_market_data(session, inst_id)
     
     async def handle_cancel_inst(self, data: dict):
         """Handle cancel all orders for a specific instrument - client sends order_ids"""
@@ -391,25 +826,14 @@ class WebSocketHandler:
             if session.engine.cancel_order(order_id, self.user.user_id):
                 cancelled_count += 1
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "cancel_inst_ack",
             "inst": inst_id,
             "cancelled": cancelled_count
         })
         
         # Broadcast updated market data for this instrument
-        snapshot = session.engine.get_snapshot(inst_id)
-        await self.session_manager.broadcast_to_session(
-            self.room_code,
-            {
-                "type": "md_inc",
-                "inst": inst_id,
-                "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-                "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-                "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                "ts": time.time()
-            }
-        )
+        await self.broadcast_market_data(session, inst_id)
     
     async def handle_replace(self, data: dict):
         """Handle order replacement"""
@@ -418,12 +842,20 @@ class WebSocketHandler:
             return
         
         order_id = data.get("order_id", 0)
-        new_price = int(data.get("price", 0) * 100) if "price" in data else None
+        # The new price scales by the order's own instrument, whatever the client says
+        order = next((o for o in session.engine.get_user_orders(self.user.user_id)
+                      if o.id == order_id), None)
+        if order is None:
+            await self.reply({"type": "replace_ack", "order_id": order_id, "success": False})
+            await self.send_error(f"Unknown order {order_id}")
+            return
+        
+        new_price = round(data["price"] * self.price_scale(session, order.instrument_id)) if "price" in data else None
         new_qty = data.get("qty") if "qty" in data else None
         
         success = session.engine.replace_order(order_id, self.user.user_id, new_price, new_qty)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "replace_ack",
             "order_id": order_id,
             "success": success
@@ -444,74 +876,17 @@ class WebSocketHandler:
             return
         
         inst_id = data.get("inst", 0)
-        value = int(data.get("value", 0) * 100)
-        logger.info(f"Settling instrument {inst_id} at value {value} (cents)")
+        scale = self.price_scale(session, inst_id)
+        value = round(data.get("value", 0) * scale)
+        logger.info(f"Settling instrument {inst_id} at value {value} (fixed-point, scale {scale})")
         
-        success = session.engine.settle_instrument(inst_id, value)
+        # Settling a SCALAR also expires every option referencing it
+        inst_type = session.instruments.get(inst_id, {}).get("type")
+        action_type = (mmg_engine.AdminActionType.SETTLE_CHAIN if inst_type == "SCALAR"
+                       else mmg_engine.AdminActionType.SETTLE)
         
-        if success:
-            # Check if this is a SCALAR - if so, expire all related options
-            if inst_id in session.instruments:
-                inst_info = session.instruments[inst_id]
-                if inst_info.get('type') == 'SCALAR':
-                    spot_value = value / 100.0
-                    
-                    # Find and expire all options referencing this instrument
-                    for other_id, other_inst in session.instruments.items():
-                        if other_inst.get('reference_id') == inst_id and other_inst.get('type') in ['CALL', 'PUT']:
-                            # Expire this option at the spot price
-                            session.engine.settle_instrument(other_id, value)
-                            await self.session_manager.broadcast_to_session(
-                                self.room_code,
-                                {
-                                    "type": "option_expired",
-                                    "inst": other_id,
-                                    "spot_price": spot_value,
-                                    "reason": "underlying_settled"
-                                }
-                            )
-                            logger.info(f"Auto-expired option {other_id} due to underlying settlement at {spot_value}")
-            
-            # Broadcast settlement to all users
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "settlement",
-                    "inst": inst_id,
-                    "value": value / 100.0
-                }
-            )
-            
-            # Broadcast updated positions and PnL to all users after settlement
-            for user_id, user in session.users.items():
-                if user.websocket:
-                    # Get positions
-                    positions = session.engine.get_positions(user_id)
-                    position_list = []
-                    for pos in positions:
-                        inst = session.instruments.get(pos.instrument_id, {})
-                        position_list.append({
-                            "inst": pos.instrument_id,
-                            "symbol": inst.get("symbol", ""),
-                            "qty": pos.net_qty,
-                            "vwap": pos.vwap / 100.0,
-                            "realized_pnl": pos.realized_pnl,
-                            "unrealized_pnl": pos.unrealized_pnl
-                        })
-                    
-                    # Get total PnL
-                    pnl = session.engine.get_total_pnl(user_id)
-                    
-                    # Send updates
-                    await user.websocket.send_json({
-                        "type": "positions",
-                        "positions": position_list
-                    })
-                    await user.websocket.send_json({
-                        "type": "pnl",
-                        "pnl": pnl
-                    })
-                    
+        result = await self.run_admin_batch(session, [mmg_engine.AdminAction(action_type, inst_id, value)])
+        if result:
             logger.info(f"Settlement complete for instrument {inst_id}, broadcasted to all users")
     
     async def handle_halt(self, data: dict):
@@ -526,21 +901,17 @@ class WebSocketHandler:
         
         inst_id = data.get("inst", 0)
         halted = data.get("on", True)
+        action_type = mmg_engine.AdminActionType.HALT if halted else mmg_engine.AdminActionType.RESUME
+        actions = [mmg_engine.AdminAction(action_type, inst_id)]
         
-        success = session.engine.halt_instrument(inst_id, halted)
+        # Optionally pull every resting order in the same engine step
+        if halted and data.get("cancel", False):
+            actions.append(mmg_engine.AdminAction(mmg_engine.AdminActionType.PULL_QUOTES, inst_id))
         
-        if success:
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "halt",
-                    "inst": inst_id,
-                    "halted": halted
-                }
-            )
+        await self.run_admin_batch(session, actions)
     
     async def handle_update_tick_size(self, data: dict):
-        """Update instrument tick size (exchange only) - pulls all quotes first"""
+        """Update instrument tick size (exchange only) - pulls or re-prices resting quotes"""
         if self.user.role != "exchange":
             await self.send_error("Only exchange can update tick size")
             return
@@ -553,52 +924,17 @@ class WebSocketHandler:
         inst_id = data.get("instrument_id", 0)
         new_tick_size = data.get("tick_size", 0.01)
         
-        if inst_id in session.instruments:
-            # Pull all orders before changing tick size
-            orders = session.engine.get_orders(inst_id)
-            for order in orders:
-                session.engine.cancel_order(order.id, order.user_id)
-            
-            logger.info(f"Cancelled {len(orders)} orders for instrument {inst_id}, updating tick to {new_tick_size}")
-            
-            # Update tick size
-            session.instruments[inst_id]['tick_size'] = new_tick_size
-            
-            # Broadcast quotes pulled
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "quotes_pulled",
-                    "inst": inst_id,
-                    "reason": "tick_size_change"
-                }
-            )
-            
-            # Broadcast tick size update to all users
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "tick_size_updated",
-                    "instrument_id": inst_id,
-                    "tick_size": new_tick_size
-                }
-            )
-            
-            # Broadcast empty book
-            snapshot = session.engine.get_snapshot(inst_id)
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "md_inc",
-                    "inst": inst_id,
-                    "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-                    "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-                    "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                    "ts": time.time()
-                }
-            )
-        else:
+        if inst_id not in session.instruments:
             await self.send_error(f"Instrument {inst_id} not found")
+            return
+        
+        tick = max(1, round(new_tick_size * self.price_scale(session, inst_id)))
+        result = await self.run_admin_batch(
+            session, [mmg_engine.AdminAction(mmg_engine.AdminActionType.SET_TICK, inst_id, tick,
+                                             self.parse_tick_policy(data.get("policy")))])
+        if result:
+            logger.info(f"Cancelled {len(result.cancelled_orders)} orders for instrument {inst_id}, "
+                        f"updated tick to {new_tick_size}")
     
     async def handle_expire_option(self, data: dict):
         """Handle option expiry (exchange only)"""
@@ -614,17 +950,10 @@ class WebSocketHandler:
         spot_price = data.get("spot_price", 0.0)
         
         # Settle with spot price for ITM calculation
-        success = session.engine.settle_instrument(inst_id, int(spot_price * 100))
-        
-        if success:
-            await self.session_manager.broadcast_to_session(
-                self.room_code,
-                {
-                    "type": "option_expired",
-                    "inst": inst_id,
-                    "spot_price": spot_price
-                }
-            )
+        value = round(spot_price * self.price_scale(session, inst_id))
+        result = await self.run_admin_batch(
+            session, [mmg_engine.AdminAction(mmg_engine.AdminActionType.SETTLE, inst_id, value)])
+        if result:
             logger.info(f"Option {inst_id} expired at spot {spot_price}")
     
     async def handle_pull_quotes(self, data: dict):
@@ -638,50 +967,159 @@ class WebSocketHandler:
             return
         
         inst_id = data.get("inst", 0)
+        result = await self.run_admin_batch(
+            session, [mmg_engine.AdminAction(mmg_engine.AdminActionType.PULL_QUOTES, inst_id)])
+        if result:
+            logger.info(f"Pulled {len(result.cancelled_orders)} quotes from instrument {inst_id}")
+    
+    async def handle_admin_batch(self, data: dict):
+        """Apply several admin actions at once (exchange only), e.g. a full round-end settlement"""
+        if self.user.role != "exchange":
+            await self.send_error("Only exchange can run admin actions")
+            return
+        
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
         
-        orders = session.engine.get_orders(inst_id)
-        for order in orders:
-            session.engine.cancel_order(order.id, order.user_id)
+        # Each action: {"action": "halt"|"resume"|"set_tick"|"pull_quotes"|"settle"|"settle_chain",
+        #               "inst": id, "value": decimal tick size or settlement value,
+        #               "policy": "cancel"|"reprice" for set_tick}
+        actions = []
+        for item in data.get("actions") or []:
+            action_type = getattr(mmg_engine.AdminActionType, str(item.get("action", "")).upper(), None)
+            if action_type is None:
+                await self.send_error(f"Unknown admin action: {item.get('action')}")
+                return
+            inst_id = item.get("inst", 0)
+            value = round((item.get("value") or 0) * self.price_scale(session, inst_id))
+            actions.append(mmg_engine.AdminAction(action_type, inst_id, value,
+                                                  self.parse_tick_policy(item.get("policy"))))
+        
+        result = await self.run_admin_batch(session, actions)
+        if result:
+            await self.reply({
+                "type": "admin_batch_ack",
+                "applied": len(result.changes),
+                "cancelled": len(result.cancelled_orders)
+            })
+    
+    async def run_admin_batch(self, session, actions: list):
+        """Apply admin actions in one engine step and broadcast the consolidated result"""
+        result = session.engine.apply_admin_batch(actions)
+        if not result.success:
+            await self.send_error(f"Admin action {result.failed_index} failed: {result.error_message}")
+            return None
         
-        logger.info(f"Pulled {len(orders)} quotes from instrument {inst_id}")
+        AdminActionType = mmg_engine.AdminActionType
+        books_changed = set()
+        settled = set()
+        for change in result.changes:
+            inst_id = change.instrument_id
+            scale = self.price_scale(session, inst_id)
+            
+            if change.type in (AdminActionType.HALT, AdminActionType.RESUME):
+                message = {"type": "halt", "inst": inst_id, "halted": change.type == AdminActionType.HALT}
+            elif change.type == AdminActionType.SET_TICK:
+                tick_size = change.value / scale
+                if inst_id in session.instruments:
+                    session.instruments[inst_id]["tick_size"] = tick_size
+                message = {"type": "tick_size_updated", "instrument_id": inst_id, "tick_size": tick_size}
+            elif change.type == AdminActionType.PULL_QUOTES:
+                books_changed.add(inst_id)
+                continue  # Cancels are broadcast from the engine's events
+            else:
+                inst_info = session.instruments.get(inst_id, {})
+                if inst_info.get("type") in ["CALL", "PUT"]:
+                    message = {"type": "option_expired", "inst": inst_id, "spot_price": change.value / scale}
+                    if inst_info.get("reference_id") in settled:
+                        message["reason"] = "underlying_settled"
+                else:
+                    message = {"type": "settlement", "inst": inst_id, "value": change.value / scale}
+                settled.add(inst_id)
+                books_changed.add(inst_id)
+            
+            await self.broadcast(message)
         
-        await self.session_manager.broadcast_to_session(
-            self.room_code,
-            {
-                "type": "quotes_pulled",
-                "inst": inst_id
-            }
-        )
+        books_changed |= await self.broadcast_engine_events(session)
+        for inst_id in sorted(books_changed):
+            await self.broadcast_market_data(session, inst_id)
         
-        snapshot = session.engine.get_snapshot(inst_id)
-        await self.session_manager.broadcast_to_session(
-            self.room_code,
-            {
-                "type": "md_inc",
-                "inst": inst_id,
-                "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-                "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-                "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                "ts": time.time()
-            }
-        )
+        # Settlement moves positions to realized PnL for everyone holding them
+        if settled:
+            for user_id, user in session.users.items():
+                if user.websocket:
+                    await self.send_positions_and_pnl(session, user_id)
+        
+        return result
     
-    async def handle_get_snapshot(self, data: dict):
-        """Get market snapshot"""
+    async def handle_market_maker(self, data: dict):
+        """Start, reconfigure or stop the built-in market maker on an instrument (exchange only)"""
+        if self.user.role != "exchange":
+            await self.send_error("Only exchange can run market makers")
+            return
+        
         session = self.session_manager.get_session(self.room_code)
         if not session or not ENGINE_AVAILABLE:
+            await self.send_error("Session or engine not available")
             return
         
         inst_id = data.get("inst", 0)
-        snapshot = session.engine.get_snapshot(inst_id)
+        if not data.get("enabled", True):
+            success = session.engine.disable_market_maker(inst_id)
+        else:
+            # Bots share one house account that never connects
+            if session.house_user_id is None:
+                session.house_user_id = session.next_user_id
+                session.next_user_id += 1
+            
+            scale = self.price_scale(session, inst_id)
+            config = mmg_engine.MarketMakerConfig()
+            config.instrument_id = inst_id
+            config.user_id = session.house_user_id
+            config.fair_value = round(data.get("fair", 0) * scale)
+            config.half_spread = round(data.get("spread", 0) * scale / 2)
+            config.size = int(data.get("size", 10))
+            config.max_inventory = int(data.get("max_inventory", 10 * config.size))
+            config.skew = float(data.get("skew", 0)) * scale
+            config.fair_step_ticks = int(data.get("step_ticks", 0))
+            config.seed = int(data.get("seed", 0))
+            success = session.engine.enable_market_maker(config)
+        
+        await self.reply({
+            "type": "market_maker_ack",
+            "inst": inst_id,
+            "enabled": bool(data.get("enabled", True)) and success,
+            "success": success
+        })
+        if success:
+            # The first quotes may have traded against resting orders
+            await self.broadcast_market_data(session, inst_id)
+            for user_id in list(session.users.keys()):
+                await self.send_positions_and_pnl(session, user_id)
+    
+    async def handle_get_snapshot(self, data: dict):
+        """Get market snapshot"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
         
-        await self.websocket.send_json({
+        await self.reply(
+            self.snapshot_message(session, data.get("inst", 0), int(data.get("depth", 10))))
+    
+    def snapshot_message(self, session, inst_id: int, depth: int = 10) -> dict:
+        """Book snapshot message stamped with the engine seq it reflects"""
+        snapshot = session.engine.get_snapshot(inst_id, depth)
+        scale = self.price_scale(session, inst_id)
+        return {
             "type": "snapshot",
             "inst": inst_id,
-            "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids],
-            "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks],
-            "last": snapshot.last_price / 100.0 if snapshot.last_price else None
-        })
+            "bids": [[lvl.price / scale, lvl.size] for lvl in snapshot.bids],
+            "asks": [[lvl.price / scale, lvl.size] for lvl in snapshot.asks],
+            "last": snapshot.last_price / scale if snapshot.last_price else None,
+            "implied": self.implied_quote(session, inst_id),
+            "seq": snapshot.seq
+        }
     
     async def handle_get_positions(self, data: dict):
         """Get user positions"""
@@ -691,13 +1129,13 @@ class WebSocketHandler:
         
         positions = session.engine.get_positions(self.user.user_id)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "positions",
             "positions": [
                 {
                     "inst": pos.instrument_id,
                     "qty": pos.net_qty,
-                    "vwap": pos.vwap / 100.0,
+                    "vwap": pos.vwap / self.price_scale(session, pos.instrument_id),
                     "realized_pnl": pos.realized_pnl,
                     "unrealized_pnl": pos.unrealized_pnl
                 }
@@ -705,6 +1143,57 @@ class WebSocketHandler:
             ]
         })
     
+    async def handle_get_orders(self, data: dict):
+        """Get the user's open orders, oldest first"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        orders = session.engine.get_user_orders(self.user.user_id)
+        
+        await self.reply({
+            "type": "orders",
+            "orders": [
+                {
+                    "order_id": order.id,
+                    "inst": order.instrument_id,
+                    "side": "buy" if order.side == mmg_engine.Side.BUY else "sell",
+                    "price": order.price / self.price_scale(session, order.instrument_id),
+                    "qty": order.quantity,
+                    "filled": order.filled_quantity
+                }
+                for order in orders
+            ],
+            "seq": session.engine.last_seq
+        })
+    
+    async def handle_get_fills(self, data: dict):
+        """Get the user's fills after the first `since` of them (a page of at most `limit`)"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        since = max(int(data.get("since", 0)), 0)
+        limit = max(int(data.get("limit", 500)), 0)
+        fills = session.engine.get_user_fills(self.user.user_id, since, limit)
+        
+        await self.reply({
+            "type": "fills",
+            "since": since,
+            "fills": [
+                {
+                    "order_id": fill.order_id,
+                    "inst": fill.instrument_id,
+                    "side": "buy" if fill.side == mmg_engine.Side.BUY else "sell",
+                    "price": fill.price / self.price_scale(session, fill.instrument_id),
+                    "qty": fill.quantity,
+                    "aggressor": fill.aggressor
+                }
+                for fill in fills
+            ],
+            "seq": session.engine.last_seq
+        })
+    
     async def handle_get_pnl(self, data: dict):
         """Get user PnL"""
         session = self.session_manager.get_session(self.room_code)
@@ -713,11 +1202,39 @@ class WebSocketHandler:
         
         pnl = session.engine.get_total_pnl(self.user.user_id)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "pnl",
             "pnl": pnl
         })
     
+    async def handle_get_risk(self, data: dict):
+        """Get greeks and scenario PnL (room-wide for the exchange)"""
+        session = self.session_manager.get_session(self.room_code)
+        if not session or not ENGINE_AVAILABLE:
+            return
+        
+        if data.get("room") and self.user.role == "exchange":
+            report = session.engine.get_room_risk()
+        else:
+            report = session.engine.get_user_risk(self.user.user_id)
+        
+        await self.reply({
+            "type": "risk",
+            "user_id": report.user_id,
+            "underlyings": [
+                {
+                    "inst": u.underlying_id,
+                    "spot": u.spot,
+                    "delta": u.delta,
+                    "gamma": u.gamma,
+                    "vega": u.vega,
+                    "theta": u.theta,
+                    "scenarios": [[s, pnl] for s, pnl in zip(u.scenario_spots, u.scenario_pnl)]
+                }
+                for u in report.underlyings
+            ]
+        })
+    
     async def handle_export_data(self, data: dict):
         """Export session data (exchange only)"""
         if self.user.role != "exchange":
@@ -726,16 +1243,18 @@ class WebSocketHandler:
         
         await self.session_manager.export_session_data(self.room_code)
         
-        await self.websocket.send_json({
+        await self.reply({
             "type": "export_complete",
             "room_code": self.room_code
         })
     
     async def market_data_broadcast(self):
         """Broadcast market data updates periodically"""
+        ticks = 0
         while True:
             try:
                 await asyncio.sleep(0.05)  # 20Hz
+                ticks += 1
                 
                 if not self.room_code or not ENGINE_AVAILABLE:
                     continue
@@ -744,33 +1263,98 @@ class WebSocketHandler:
                 if not session:
                     break
                 
-                # Broadcast snapshots for all instruments
-                for inst_id in session.instruments.keys():
-                    snapshot = session.engine.get_snapshot(inst_id)
+                async with self.holding(session.lock):
+                    # The exchange's connection drives the market makers' fair values at 1Hz
+                    if self.user.role == "exchange" and ticks % 20 == 0:
+                        fills = session.engine.step_market_makers()
+                        if fills:
+                            await self.publish_fills(session, fills, set())
                     
-                    msg = {
-                        "type": "md_inc",
-                        "inst": inst_id,
-                        "bids": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.bids[:5]],
-                        "asks": [[lvl.price / 100.0, lvl.size] for lvl in snapshot.asks[:5]],
-                        "last": snapshot.last_price / 100.0 if snapshot.last_price else None,
-                        "ts": time.time()
-                    }
+                    # Standbys get this room's commands and metadata changes
+                    self.session_manager.replicate(session)
                     
-                    await self.session_manager.broadcast_to_session(self.room_code, msg)
+                    # Deltas first, then this client's changed books if it is on snapshots
+                    await self.broadcast_engine_events(session)
+                    books = [
+                        self.md_inc_message(session, inst_id, self.user.md_depth)
+                        for inst_id in session.engine.take_market_data_updates(self.user.user_id)
+                    ]
+                
+                # Only this client waits on its own socket
+                if not self.user.md_deltas:
+                    for message in books:
+                        await self.reply(message)
             
             except asyncio.CancelledError:
                 break
             except Exception as e:
                 logger.error(f"Error in market data broadcast: {e}", exc_info=True)
     
+    @contextlib.asynccontextmanager
+    async def holding(self, lock):
+        """Hold a room lock; messages sent meanwhile are delivered once it is
+        released, so a slow socket never stalls the room"""
+        outbox = []
+        token = _outbox.set(outbox)
+        try:
+            async with lock:
+                yield
+        finally:
+            _outbox.reset(token)
+            await self.session_manager.deliver(outbox)
+    
+    async def send(self, pairs: list):
+        """Send (websocket, message) pairs, or queue them while holding the room lock"""
+        outbox = _outbox.get()
+        if outbox is None:
+            await self.session_manager.deliver(pairs)
+        else:
+            outbox.extend(pairs)
+    
+    async def reply(self, message: dict):
+        """Send a message to this client"""
+        await self.send([(self.websocket, message)])
+    
+    async def broadcast(self, message: dict, exclude_user: Optional[int] = None):
+        """Send a message to everyone in this client's room, stamped with the engine's last seq"""
+        session = self.session_manager.get_session(self.room_code)
+        if session:
+            await self.send_to([user_id for user_id in session.users if user_id != exclude_user],
+                               message)
+    
+    async def send_to(self, user_ids, message: dict):
+        """Send one encoded message to some users of this client's room"""
+        await self.send(self.session_manager.outgoing(self.room_code, user_ids, message))
+    
     async def send_error(self, message: str):
         """Send error message to client"""
-        await self.websocket.send_json({
+        await self.reply({
             "type": "error",
             "message": message
         })
     
+    def price_scale(self, session, inst_id: int) -> int:
+        """Fixed-point scale of an instrument's prices (10 ** decimals)"""
+        inst = session.instruments.get(inst_id, {})
+        return 10 ** inst.get("decimals", 2)
+    
+    def implied_quote(self, session, inst_id: int):
+        """Implied top of book as {bid, bid_size, ask, ask_size}; absent sides are None"""
+        quote = session.engine.get_implied_quote(inst_id)
+        scale = self.price_scale(session, inst_id)
+        return {
+            "bid": quote.bid / scale if quote.bid_size else None,
+            "bid_size": quote.bid_size,
+            "ask": quote.ask / scale if quote.ask_size else None,
+            "ask_size": quote.ask_size
+        }
+    
+    def parse_tick_policy(self, policy: Optional[str]):
+        """Parse a tick-change policy; cancelling resting orders is the default"""
+        if policy and policy.upper() == "REPRICE":
+            return mmg_engine.TickPolicy.REPRICE
+        return mmg_engine.TickPolicy.CANCEL
+    
     def parse_instrument_type(self, type_str: str):
         """Parse instrument type string"""
         if not ENGINE_AVAILABLE:
@@ -780,6 +1364,8 @@ class WebSocketHandler:
             return mmg_engine.InstrumentType.CALL
         elif type_str == "PUT":
             return mmg_engine.InstrumentType.PUT
+        elif type_str == "COMBO":
+            return mmg_engine.InstrumentType.COMBO
         else:
             return mmg_engine.InstrumentType.SCALAR
     
@@ -789,12 +1375,21 @@ class WebSocketHandler:
             self.broadcast_task.cancel()
         
         if self.user:
+            # Bulk-cancel resting orders for users flagged cancel-on-disconnect
+            session = self.session_manager.get_session(self.room_code) if self.room_code else None
+            if session and ENGINE_AVAILABLE:
+                async with self.holding(session.lock):
+                    session.engine.unsubscribe_all_market_data(self.user.user_id)
+                    session.engine.unsubscribe_all_l3(self.user.user_id)
+                    if session.engine.user_disconnected(self.user.user_id):
+                        for inst_id in sorted(await self.broadcast_engine_events(session)):
+                            await self.broadcast_market_data(session, inst_id)
+            
             await self.session_manager.leave_session(self.user.user_id)
             
             # Notify other users
             if self.room_code:
-                await self.session_manager.broadcast_to_session(
-                    self.room_code,
+                await self.broadcast(
                     {
                         "type": "user_left",
                         "user_id": self.user.user_id,
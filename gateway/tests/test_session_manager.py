@@ -4,7 +4,10 @@ Unit tests for session manager
 
 import pytest
 import asyncio
-from app.session_manager import SessionManager, User, Session
+from types import SimpleNamespace
+from app.session_manager import SessionManager, User, Session, shard_of
+from app import ws_handler
+from app.ws_handler import WebSocketHandler
 
 
 @pytest.mark.asyncio
@@ -103,3 +106,163 @@ async def test_get_stats():
     assert stats["active_sessions"] == 2
     assert stats["total_users"] == 3
 
+    
+    # Engine memory is reported per room
+    memory = stats["sessions"][0]["memory"]
+    assert set(memory) == {"books", "orders", "positions", "history", "indexes", "events", "total"}
+    assert memory["total"]["reserved"] >= memory["total"]["used"]
+
+
+@pytest.mark.asyncio
+async def test_resume_and_adopt_session():
+    """A standby adopts a room from its metadata and users reclaim their seats"""
+    manager = SessionManager()
+    
+    room_code = await manager.create_session(passcode="pw")
+    alice = await manager.join_session(room_code, "Alice", "trader", passcode="pw")
+    metadata = manager.session_metadata(manager.get_session(room_code))
+    
+    standby = SessionManager()
+    session = await standby.adopt_session(manager.get_session(room_code).engine, metadata)
+    assert session.next_user_id == 2
+    
+    resumed = await standby.join_session(room_code, "Alice", "trader", passcode="pw",
+                                         resume_token=alice.resume_token)
+    assert resumed.user_id == alice.user_id
+    
+    # A wrong token joins as a new user
+    other = await standby.join_session(room_code, "Eve", "trader", passcode="pw",
+                                       resume_token="nope")
+    assert other.user_id == 2
+
+
+@pytest.mark.asyncio
+async def test_sharded_room_codes():
+    """A worker only issues room codes that route to itself"""
+    manager = SessionManager()
+    manager.configure_shards(3, 4)
+    
+    for _ in range(20):
+        room_code = await manager.create_session()
+        assert shard_of(room_code, 4) == 3
+        assert manager.owns_room(room_code)
+    assert not manager.owns_room("000000")
+    assert shard_of("F00000", 2) == 1
+    
+    # Wrong-worker errors name the owner, with its port when workers share a host
+    assert manager.room_host("100000") == "gateway worker 1 of 4"
+    manager.shard_base_port = 8000
+    assert manager.room_host("E00000") == "gateway worker 2 of 4 (port 8002)"
+    
+    # Workers that could never own a room are refused rather than spinning
+    for index, count in ((16, 20), (0, 17), (0, 0), (4, 4), (-1, 2)):
+        with pytest.raises(ValueError):
+            manager.configure_shards(index, count)
+
+
+@pytest.mark.asyncio
+async def test_aggregate_fills_option():
+    """Rooms created with fill aggregation configured turn it on in their engine"""
+    manager = SessionManager()
+    manager.aggregate_fills = True
+    
+    room_code = await manager.create_session()
+    assert manager.get_session(room_code).engine.aggregate_fills()
+
+
+@pytest.mark.asyncio
+async def test_rooms_lock_independently():
+    """A busy room holds up its own joins but never another room's"""
+    manager = SessionManager()
+    
+    busy = await manager.create_session()
+    idle = await manager.create_session()
+    
+    async with manager.command_lock(busy):
+        user = await asyncio.wait_for(manager.join_session(idle, "Alice", "trader"), 1)
+        assert user is not None
+        
+        pending = asyncio.ensure_future(manager.join_session(busy, "Bob", "trader"))
+        await asyncio.sleep(0.01)
+        assert not pending.done()
+    
+    assert (await pending) is not None
+
+
+class RecordingSocket:
+    """Stand-in websocket that records messages, optionally blocking until released"""
+    def __init__(self, release: asyncio.Event = None):
+        self.release = release
+        self.sent = []
+    
+    async def send_json(self, message):
+        if self.release:
+            await self.release.wait()
+        self.sent.append(message)
+
+
+@pytest.mark.asyncio
+async def test_command_sends_after_lock_release():
+    """What a command sends goes out once the room lock is released, so a slow
+    socket holds up neither the room nor the other sockets"""
+    manager = SessionManager()
+    room_code = await manager.create_session()
+    slow = await manager.join_session(room_code, "Slow", "trader")
+    fast = await manager.join_session(room_code, "Fast", "trader")
+    release = asyncio.Event()
+    slow.websocket = RecordingSocket(release)
+    fast.websocket = RecordingSocket()
+    
+    handler = WebSocketHandler(fast.websocket, manager)
+    handler.room_code = room_code
+    lock = manager.command_lock(room_code)
+    
+    async def command():
+        async with handler.holding(lock):
+            await handler.broadcast({"type": "instrument_added"})
+            await handler.reply({"type": "order_ack"})
+            assert fast.websocket.sent == []
+    
+    pending = asyncio.ensure_future(command())
+    await asyncio.sleep(0.01)
+    assert not lock.locked()
+    assert [m["type"] for m in fast.websocket.sent] == ["instrument_added", "order_ack"]
+    assert "seq" in fast.websocket.sent[0]
+    assert not pending.done()
+    
+    release.set()
+    await pending
+    assert [m["type"] for m in slow.websocket.sent] == ["instrument_added"]
+
+
+@pytest.mark.asyncio
+async def test_sweep_fills_carry_their_own_seq(monkeypatch):
+    """Each fill goes out with its FILL event's seq, so a sweep's fills are
+    distinct and increasing rather than all stamped with the latest seq"""
+    monkeypatch.setattr(ws_handler, "mmg_engine",
+                        SimpleNamespace(Side=SimpleNamespace(BUY=0, SELL=1)), raising=False)
+    manager = SessionManager()
+    room_code = await manager.create_session()
+    taker = await manager.join_session(room_code, "Taker", "trader")
+    maker = await manager.join_session(room_code, "Maker", "trader")
+    taker.websocket = RecordingSocket()
+    maker.websocket = RecordingSocket()
+    
+    session = manager.get_session(room_code)
+    session.engine.last_seq = 9
+    handler = WebSocketHandler(taker.websocket, manager)
+    handler.room_code = room_code
+    
+    def fill(seq, user, side, aggressor):
+        return SimpleNamespace(seq=seq, order_id=seq, user_id=user.user_id, instrument_id=1,
+                               side=side, price=10000, quantity=5, aggressor=aggressor)
+    
+    fills = [fill(5, taker, 0, True), fill(6, maker, 1, False),
+             fill(7, taker, 0, True), fill(8, maker, 1, False)]
+    async with handler.holding(manager.command_lock(room_code)):
+        await handler.publish_fills(session, fills, set())
+    
+    for user in (taker, maker):
+        seqs = [m["seq"] for m in user.websocket.sent if m["type"] == "fill"]
+        assert len(seqs) == 2
+        assert seqs[0] < seqs[1] < session.engine.last_seq
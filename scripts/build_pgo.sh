@@ -0,0 +1,87 @@
+#!/bin/bash
+set -e
+
+# Market Making Game - Profile-guided + link-time optimized engine build
+# 1. Plain Release build; the benchmark suite is timed as the baseline
+# 2. Instrumented build, trained on the benchmarks and the journal replay
+# 3. Rebuild of mmg_engine (and mmg_engine_py) from the profiles with LTO,
+#    then the suite is timed again and compared with the baseline
+#
+# Usage: scripts/build_pgo.sh
+#   PYTHON_BINDINGS=OFF  skip the Python module
+#   SKIP_BASELINE=1      only build the optimized engine
+#   ROUNDS=3             suite repetitions; the report keeps each best p50
+
+PYTHON_BINDINGS=${PYTHON_BINDINGS:-ON}
+ROUNDS=${ROUNDS:-3}
+JOBS=$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4)
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+cd "$SCRIPT_DIR/../engine"
+
+BASE_DIR="build-baseline"
+PGO_DIR="build-pgo"
+PROFILE_DIR="$PWD/$PGO_DIR/pgo-profiles"
+
+configure() {
+    cmake -S . -B "$1" -DCMAKE_BUILD_TYPE=Release -DBUILD_TESTS=OFF -DBUILD_BENCHMARKS=ON \
+        -DBUILD_PYTHON_BINDINGS=$PYTHON_BINDINGS -DPGO_PROFILE_DIR="$PROFILE_DIR" "${@:2}" > /dev/null
+    cmake --build "$1" -j"$JOBS"
+}
+
+# Full-size suite, as used for the report
+run_suite() {
+    for ((round = 0; round < ROUNDS; round++)); do
+        for bench in bench_book bench_market_maker bench_implied bench_journal bench_segment; do
+            "$1/$bench"
+        done
+    done
+}
+
+# Smaller sizes of the same workloads; instrumented code runs a lot slower
+train() {
+    "$1/bench_book" 500
+    "$1/bench_market_maker" 20 5000
+    "$1/bench_implied" 40 500
+    "$1/bench_journal" 10 200000
+    "$1/bench_segment" 10 100000
+}
+
+if [ -z "$SKIP_BASELINE" ]; then
+    echo "📦 Baseline Release build..."
+    configure "$BASE_DIR" -DPGO_MODE= -DENABLE_LTO=OFF
+    run_suite "$BASE_DIR" > "$BASE_DIR/bench.txt"
+fi
+
+echo "📈 Instrumented build and training run..."
+rm -rf "$PROFILE_DIR"
+configure "$PGO_DIR" -DPGO_MODE=GENERATE -DENABLE_LTO=OFF
+train "$PGO_DIR" > /dev/null
+
+if [ -n "$(ls "$PROFILE_DIR"/*.profraw 2>/dev/null)" ]; then
+    llvm-profdata merge -output="$PROFILE_DIR/default.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+echo "🚀 Optimized build (PGO + LTO)..."
+configure "$PGO_DIR" -DPGO_MODE=USE -DENABLE_LTO=ON
+run_suite "$PGO_DIR" > "$PGO_DIR/bench.txt"
+
+if [ -z "$SKIP_BASELINE" ]; then
+    echo ""
+    echo "Best p50 of $ROUNDS rounds per benchmark (lower is better)"
+    awk '$5 !~ /^[0-9.]+$/ { next }
+         FNR == NR { if (!($1 in base) || $4 < base[$1]) base[$1] = $4; next }
+         !($1 in pgo) { order[++n] = $1 }
+         !($1 in pgo) || $4 < pgo[$1] { pgo[$1] = $4 }
+         END {
+             printf "%-40s %12s %12s %9s\n", "benchmark", "baseline", "pgo+lto", "speedup"
+             for (i = 1; i <= n; ++i) {
+                 name = order[i]
+                 if ((name in base) && pgo[name] > 0)
+                     printf "%-40s %12.0f %12.0f %8.2fx\n", name, base[name], pgo[name], base[name] / pgo[name]
+             }
+         }' "$BASE_DIR/bench.txt" "$PGO_DIR/bench.txt"
+fi
+
+echo ""
+echo "✅ Optimized engine in engine/$PGO_DIR"
@@ -0,0 +1,56 @@
+#!/bin/bash
+set -e
+
+# Market Making Game - Gateway shard routing for docker/nginx.conf
+# Rewrites the upstreams and the ?room= map between the shard markers for N
+# workers named gateway-0..gateway-N-1, with the gateway's rule: the first
+# hex digit of the room code modulo N (session_manager.py shard_of).
+# docker-compose.yml then needs a gateway-i service per worker, each with
+# MMG_SHARD_INDEX=i and MMG_SHARD_COUNT=N.
+#
+# Usage: scripts/gen_nginx_shards.sh [workers]
+
+WORKERS=${1:-2}
+if ! [[ "$WORKERS" =~ ^[0-9]+$ ]] || [ "$WORKERS" -lt 1 ] || [ "$WORKERS" -gt 16 ]; then
+    echo "❌ Workers must be 1..16: room codes shard on one hex digit" >&2
+    exit 1
+fi
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+CONF="$SCRIPT_DIR/../docker/nginx.conf"
+HEX=(0 1 2 3 4 5 6 7 8 9 aA bB cC dD eE fF)
+
+block() {
+    echo "    upstream gateway {"
+    for ((i = 0; i < WORKERS; i++)); do
+        echo "        server gateway-$i:8000;"
+    done
+    echo "    }"
+    for ((i = 0; i < WORKERS; i++)); do
+        echo "    upstream gateway_$i {"
+        echo "        server gateway-$i:8000;"
+        echo "    }"
+    done
+    echo "    "
+    echo "    map \$arg_room \$gateway_shard {"
+    echo "        default              gateway;"
+    for ((i = 0; i < WORKERS; i++)); do
+        digits=""
+        for ((d = i; d < 16; d += WORKERS)); do
+            digits="$digits${HEX[$d]}"
+        done
+        printf '        %-20s %s;\n' "\"~^[$digits]\"" "gateway_$i"
+    done
+    echo "    }"
+}
+
+block > "$CONF.shards"
+awk -v shards="$CONF.shards" '
+    /# END shards/ { skip = 0 }
+    !skip { print }
+    /# BEGIN shards/ { while ((getline line < shards) > 0) print line; skip = 1 }
+' "$CONF" > "$CONF.tmp"
+mv "$CONF.tmp" "$CONF"
+rm "$CONF.shards"
+
+echo "✅ docker/nginx.conf routes rooms across $WORKERS gateway workers"
@@ -0,0 +1,42 @@
+#!/bin/bash
+set -e
+
+# Market Making Game - Sharded gateway without Docker
+# Starts N gateway workers on ports 8000..8000+N-1, each hosting the rooms
+# whose code maps to it. Clients connect to the worker for their room
+# (a wrong worker answers a join with an error naming the right one and its
+# port), or put docker/nginx.conf in front to route on ?room=, after
+# scripts/gen_nginx_shards.sh with the same worker count.
+#
+# Usage: scripts/run_shards.sh [workers]
+
+WORKERS=${1:-2}
+BASE_PORT=${BASE_PORT:-8000}
+
+if ! [[ "$WORKERS" =~ ^[0-9]+$ ]] || [ "$WORKERS" -lt 1 ] || [ "$WORKERS" -gt 16 ]; then
+    echo "❌ Workers must be 1..16: room codes shard on one hex digit" >&2
+    exit 1
+fi
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+cd "$SCRIPT_DIR/../gateway"
+
+if [ -d "venv" ]; then
+    source venv/bin/activate
+fi
+
+cleanup() {
+    kill $(jobs -p) 2>/dev/null || true
+    exit
+}
+trap cleanup SIGINT SIGTERM
+
+for ((i = 0; i < WORKERS; i++)); do
+    PORT=$((BASE_PORT + i))
+    MMG_SHARD_INDEX=$i MMG_SHARD_COUNT=$WORKERS MMG_SHARD_BASE_PORT=$BASE_PORT \
+        python -m uvicorn app.main:app --host 0.0.0.0 --port $PORT > "gateway-$i.log" 2>&1 &
+    echo "Worker $i on port $PORT (log: gateway/gateway-$i.log)"
+done
+
+echo "Room codes starting with hex digit d live on worker d % $WORKERS"
+wait